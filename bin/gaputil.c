@@ -38,24 +38,236 @@ int main (int argc, char **argv) {
    *  @D: total number of Nyquist grid dimensions.
    *  @N: tuple holding the Nyquist grid sizes.
    *  @d: effective sampling density, in (0,1).
+   *  @opt: options of schedule generation.
+   *  @ctx: evaluation context of the gap equation.
+   *  @arg: integer value of an option argument.
    */
   unsigned int D;
   tuple_t N;
   double d;
+  seqopt_t opt;
+  evalctx_t ctx;
+  int arg;
 
   /* declare variables to hold schedule values:
    *  @xlst: tuple of linear indices in the schedule.
-   *  @xt: tuple to hold unpacked linear indices.
    */
-  tuple_t xlst, xt;
+  tuple_t xlst;
+
+  /* declare variables used to extend schedules:
+   *  @afile: name of the schedule file to extend, or NULL.
+   *  @pre: tuple of the linear indices already sampled.
+   *  @fh: input file handle of the schedule to extend.
+   */
+  const char *afile;
+  tuple_t pre;
+  FILE *fh;
+
+  /* declare variables used to build batches of schedules:
+   *  @bfile: name of the batch job file, or NULL.
+   *  @prefix: prefix of the numbered output file names.
+   *  @bopt: options of the batch.
+   */
+  const char *bfile, *prefix;
+  batopt_t bopt;
+
+  /* declare variables used to cache schedules:
+   *  @C: on-disk schedule cache.
+   *  @cdir: cache directory, or NULL to use the environment.
+   *  @cuse: whether the cache may be used.
+   *  @key: cache key of the schedule, or NULL if it is not cached.
+   *  @kopt: options that determine the schedule.
+   *  @hit: whether the schedule was read from the cache.
+   *  @L0: starting scaling factor predicted by the table.
+   */
+  cache_t C;
+  const char *cdir;
+  char *key, kopt[96];
+  double L0;
+  int cuse, hit;
+
+  /* declare variables to hold the table of converged scaling factors:
+   *  @T: table structure.
+   *  @Tp: pointer to the table, or NULL if no table is used.
+   *  @fname: filename of the table, or NULL if no table is used.
+   */
+  tbl_t T, *Tp;
+  char *fname;
+
+  /* declare variables used to parse command line options:
+   *  @lopts: array of long option definitions.
+   *  @o: currently parsed option character.
+   */
+  static struct option lopts[] = {
+    { "table",    required_argument, NULL, 't' },
+    { "no-table", no_argument,       NULL, 'n' },
+    { "exact",    no_argument,       NULL, 'x' },
+    { "threads",  required_argument, NULL, 'j' },
+    { "candidates", required_argument, NULL, 'c' },
+    { "append",   required_argument, NULL, 'a' },
+    { "batch",    required_argument, NULL, 'b' },
+    { "output",   required_argument, NULL, 'o' },
+    { "cache",    required_argument, NULL, 'k' },
+    { "no-cache", no_argument,       NULL, 'K' },
+    { NULL, 0, NULL, 0 }
+  };
+  int o;
 
   /* declare a general-purpose loop index variable:
    *  @i: loop counter and iteration index.
    */
   unsigned int i;
 
+  /* use no table of converged scaling factors by default. */
+  fname = NULL;
+
+  /* use every online processor and the usual lanes by default. */
+  arg = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  opt.nthr = (arg < 1 ? 1 : arg > GAPUTIL_THREADS_MAX ?
+              GAPUTIL_THREADS_MAX : arg);
+  opt.ncand = SEQ_LANES;
+  opt.exact = 0;
+
+  /* generate a new schedule by default. */
+  afile = bfile = NULL;
+  prefix = "gaputil";
+  opt.pre = NULL;
+
+  /* use the cache named by the environment by default. */
+  cdir = NULL;
+  cuse = 1;
+
+  /* parse the command line options. */
+  while ((o = getopt_long(argc, argv, "+t:nxj:c:a:b:o:k:K",
+                          lopts, NULL)) != -1) {
+    switch (o) {
+      /* table filename. */
+      case 't':
+        fname = optarg;
+        break;
+
+      /* disabled table. */
+      case 'n':
+        fname = NULL;
+        break;
+
+      /* exact point count. */
+      case 'x':
+        opt.exact = 1;
+        break;
+
+      /* thread count. */
+      case 'j':
+        arg = atoi(optarg);
+        if (arg < 1 || arg > GAPUTIL_THREADS_MAX) {
+          fprintf(stderr, "error: thread count must lie in [1,%d]\n",
+                  GAPUTIL_THREADS_MAX);
+          return 1;
+        }
+
+        opt.nthr = (unsigned int) arg;
+        break;
+
+      /* candidate scaling factor count. */
+      case 'c':
+        arg = atoi(optarg);
+        if (arg < 1 || arg > SEQ_MAX_LANES) {
+          fprintf(stderr, "error: candidate count must lie in [1,%d]\n",
+                  SEQ_MAX_LANES);
+          return 1;
+        }
+
+        opt.ncand = (unsigned int) arg;
+        break;
+
+      /* schedule file to extend. */
+      case 'a':
+        afile = optarg;
+        break;
+
+      /* batch job file. */
+      case 'b':
+        bfile = optarg;
+        break;
+
+      /* batch output file name prefix. */
+      case 'o':
+        prefix = optarg;
+        break;
+
+      /* cache directory. */
+      case 'k':
+        cdir = optarg;
+        cuse = 1;
+        break;
+
+      /* disabled cache. */
+      case 'K':
+        cuse = 0;
+        break;
+
+      /* unknown option: output a usage statement and return failure. */
+      default:
+        fprintf(stderr, GAPUTIL_USAGE, argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  /* load the table of converged scaling factors. */
+  Tp = NULL;
+  if (fname) {
+    if (!tblload(&T, fname)) {
+      /* output an error and return failure. */
+      fprintf(stderr, "error: failed to load table '%s'\n", fname);
+      return 1;
+    }
+
+    Tp = &T;
+  }
+
+  /* pass the table to schedule generation. */
+  opt.T = Tp;
+  opt.store = 1;
+
+  /* build the schedules of a batch, if requested. */
+  if (bfile) {
+    /* check that only options shared by every job were given. */
+    if (argc != optind || afile) {
+      /* output an error and return failure. */
+      fprintf(stderr, "error: batches take no schedule arguments and "
+                      "no --append\n");
+      return 1;
+    }
+
+    /* initialize the julia interpreter on its own thread, which permits
+     * jobs to be built from any thread.
+     */
+    if (!evalstart()) {
+      /* output an error and return failure. */
+      fprintf(stderr, "error: failed to initialize julia\n");
+      return 1;
+    }
+
+    /* build the jobs. */
+    bopt.method = NUS_GAP;
+    bopt.seq = &opt;
+    bopt.rej = NULL;
+    bopt.jit = NULL;
+    bopt.prefix = prefix;
+    bopt.nthr = opt.nthr;
+    arg = batch(bfile, &bopt);
+
+    /* free the table, which the jobs only read. */
+    if (Tp)
+      tblfree(Tp);
+
+    /* free the julia interpreter and return. */
+    evalexit();
+    return (arg ? 0 : 1);
+  }
+
   /* determine the number of grid dimensions. */
-  D = argc - 3;
+  D = argc - optind - 2;
 
   /* check that a supported number of dimensions was requested.
    *
@@ -65,12 +277,12 @@ int main (int argc, char **argv) {
    */
   if (D < GAPUTIL_DIMS_MIN || D > GAPUTIL_DIMS_MAX) {
     /* output a usage statement and return failure. */
-    fprintf(stderr, GAPUTIL_USAGE, argv[0]);
+    fprintf(stderr, GAPUTIL_USAGE, argv[0], argv[0]);
     return 1;
   }
 
   /* read in the sampling density. */
-  d = atof(argv[1]);
+  d = atof(argv[optind]);
 
   /* validate the sampling density. */
   if (d <= 0.0 || d >= 1.0) {
@@ -80,7 +292,7 @@ int main (int argc, char **argv) {
   }
 
   /* allocate the grid size tuple. */
-  if (!tupalloc(&N, D) || !tupalloc(&xt, D)) {
+  if (!tupalloc(&N, D)) {
     /* output an error and return failure. */
     fprintf(stderr, "error: failed to allocate grid size tuple\n");
     return 1;
@@ -89,7 +301,7 @@ int main (int argc, char **argv) {
   /* read in the grid sizes. */
   for (i = 0; i < tupsize(&N); i++) {
     /* read the currently indexed argument. */
-    tupset(&N, i, atoi(argv[i + 2]));
+    tupset(&N, i, atoi(argv[optind + i + 1]));
 
     /* validate the grid size. */
     if (tupget(&N, i) == 0) {
@@ -99,30 +311,95 @@ int main (int argc, char **argv) {
     }
   }
 
-  /* initialize the julia interpreter. */
-  jl_init(JULIA_INIT_DIR);
+  /* read the points of the schedule to extend. */
+  if (afile) {
+    fh = fopen(afile, "r");
+    tupinit(&pre);
+    if (!fh || !tupread(fh, &N, &pre)) {
+      /* output an error and return failure. */
+      fprintf(stderr, "error: failed to read schedule '%s'\n", afile);
+      return 1;
+    }
+
+    fclose(fh);
+    opt.pre = &pre;
+  }
+
+  /* look up the schedule in the cache. extended schedules depend on more
+   * than the arguments, and are never cached. the search starts from the
+   * scaling factor predicted by the table in use, which changes the
+   * schedule, so that factor is part of the key.
+   */
+  key = NULL;
+  if (cuse && !afile && cacheopen(&C, cdir)) {
+    sprintf(kopt, "exact %d ncand %u", opt.exact, opt.ncand);
+    if (Tp && tblguess(Tp, argv[argc - 1], &N, d, &L0))
+      sprintf(kopt + strlen(kopt), " table %.17g", L0);
 
-  /* build the final schedule array. */
-  if (!seq(argv[argc - 1], &N, d, &xlst)) {
-    /* output an error and return failure. */
-    fprintf(stderr, "error: failed to compute output sequence\n");
-    return 1;
+    key = cachekey("gaputil", kopt, &N, &d, 1, argv[argc - 1]);
+  }
+
+  hit = (key && cachegetlst(&C, key, &xlst, 1, tupprod(&N)));
+
+  /* build the schedule if it was not cached. */
+  if (!hit) {
+    /* initialize the julia interpreter. */
+    jl_init(JULIA_INIT_DIR);
+
+    /* compile the gap equation. */
+    if (!evalinit(&ctx, argv[argc - 1], EVAL_GAP)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to compile gap equation\n");
+      return 1;
+    }
+
+    /* build the final schedule array. */
+    if (!seq(&ctx, &N, d, &opt, &xlst)) {
+      /* output an error and return failure. */
+      fprintf(stderr, "error: failed to compute output sequence\n");
+      return 1;
+    }
+
+    /* store the schedule in the cache. */
+    if (key && !cacheputlst(&C, key, &xlst, 1))
+      fprintf(stderr, "warning: failed to cache schedule\n");
+
+    /* free the equation. */
+    evalfree(&ctx);
+    evalexit();
+  }
+
+  /* free the cache key. */
+  if (key) {
+    free(key);
+    cacheclose(&C);
+  }
+
+  /* save and free the table. the schedule remains valid if the table
+   * cannot be saved, so the failure is not fatal.
+   */
+  if (Tp) {
+    if (!tblsave(Tp))
+      fprintf(stderr, "warning: failed to save table '%s'\n", fname);
+
+    tblfree(Tp);
   }
 
   /* print the final schedule values. */
-  for (i = 0; i < tupsize(&xlst); i++) {
-    /* unpack and print the current schedule value. */
-    tupunpack(tupget(&xlst, i), &N, &xt);
-    tupprint(&xt, stdout);
+  if (!tupwrite(stdout, &N, &xlst)) {
+    /* output an error and return failure. */
+    fprintf(stderr, "error: failed to write schedule\n");
+    return 1;
   }
 
   /* free the allocated tuples. */
+  if (afile)
+    tupfree(&pre);
+
   tupfree(&xlst);
-  tupfree(&xt);
   tupfree(&N);
 
   /* return successfully. */
-  evalfree();
   return 0;
 }
 
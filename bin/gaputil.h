@@ -26,10 +26,19 @@
 #include <string.h>
 #include <math.h>
 
-/* include the tuple, sequence and evaluation headers. */
+/* include the gnu option parsing and posix headers. */
+#include <getopt.h>
+#include <unistd.h>
+
+/* include the tuple, sequence, table, evaluation, batch and cache
+ * headers.
+ */
 #include "tup.h"
 #include "seq.h"
+#include "tbl.h"
 #include "eval.h"
+#include "bat.h"
+#include "cache.h"
 
 /* define a soft-limit for the number of dimensions that the program
  * is willing to build grids on.
@@ -37,6 +46,9 @@
 #define GAPUTIL_DIMS_MIN 1
 #define GAPUTIL_DIMS_MAX 3
 
+/* define the maximum number of threads used to generate schedules. */
+#define GAPUTIL_THREADS_MAX 256
+
 /* define a short help message for users who've got no clue.
  */
 #define GAPUTIL_USAGE "\
@@ -45,12 +57,35 @@
  Released under the GNU General Public License, ver. 2.0.\n\
 \n\
  Usage:\n\
-  %s density N1 [N2 [N3]] gapfunc\n\
+  %s [options] density N1 [N2 [N3]] gapfunc\n\
+  %s [options] --batch FILE\n\
 \n\
  The gap utility permits the creation of generalized gap sampling schedules\n\
  based on an arbitrary gap equation. The gap equation specified in gapfunc\n\
  will be used to construct a sampling schedule on a one-, two- or three-\n\
  dimensional grid, having a global sampling density of D.\n\
+\n\
+ Options:\n\
+  -t, --table FILE  read and update converged scaling factors in FILE\n\
+  -n, --no-table    do not use a table of converged scaling factors\n\
+                    (default)\n\
+  -x, --exact       output exactly round(density * N1 * N2 * N3) points\n\
+  -j, --threads NUM use NUM threads (default: all online processors)\n\
+  -c, --candidates NUM\n\
+                    advance NUM scaling factors in each pass (default: 3)\n\
+  -a, --append FILE extend the schedule in FILE to the new density\n\
+  -b, --batch FILE  build the schedule of each job in FILE\n\
+  -o, --output PRE  prefix the numbered batch file names with PRE\n\
+  -k, --cache DIR   reuse and store schedules in the cache directory DIR\n\
+  -K, --no-cache    do not use a schedule cache\n\
+\n\
+ Each line of a batch file holds a job of the form 'N1[,N2[,N3]] density\n\
+ gapfunc', whose schedule is written to a numbered file, and the sizes\n\
+ and timings of all jobs are written to standard output.\n\
+\n\
+ Schedules are cached in the directory named by the NUSUTILS_CACHE\n\
+ environment variable, bounded to NUSUTILS_CACHE_SIZE mebibytes\n\
+ (default: 256).\n\
 \n\
  For more information on how to use and/or cite the gap utility, please\n\
  consult the manual page for gaputil(1).\n\
@@ -37,25 +37,250 @@ int main (int argc, char **argv) {
   /* declare variables to hold schedule parameters:
    *  @D: total number of Nyquist grid dimensions.
    *  @N: tuple holding the Nyquist grid sizes.
-   *  @d: effective sampling density, in (0,1).
+   *  @d: effective sampling densities, in (0,1).
+   *  @nd: number of sampling densities.
+   *  @opt: sampling options.
+   *  @copt: options of the run.
+   *  @arg: currently parsed integer option argument.
    */
   unsigned int D;
+  jitopt_t opt;
+  cliopt_t copt;
   tuple_t N;
-  double d;
+  double d[JITUTIL_DENS_MAX];
+  unsigned int nd;
+  int arg;
 
-  /* declare variables to hold schedule values:
-   *  @xlst: tuple of linear indices in the schedule.
-   *  @xt: tuple to hold unpacked linear indices.
+  /* declare variables used to extend and resume schedules:
+   *  @afile: name of the schedule file to extend, or NULL.
+   *  @rfile: name of the file holding the term to resume from, or NULL.
+   *  @bfile: name of the batch job file, or NULL.
+   *  @bopt: options of the batch.
    */
-  tuple_t xlst, xt;
+  const char *afile, *rfile, *bfile;
+  batopt_t bopt;
 
-  /* declare a general-purpose loop index variable:
+  /* declare variables used to cache schedules:
+   *  @cdir: cache directory, or NULL to use the environment.
+   *  @cuse: whether the cache may be used.
+   */
+  const char *cdir;
+  int cuse;
+
+  /* declare variables used to read density grids from files:
+   *  @pfile: name of the density grid file, or NULL.
+   */
+  const char *pfile;
+
+  /* declare variables used to write ensembles of schedules:
+   *  @prefix: prefix of the output file names.
+   */
+  const char *prefix;
+
+  /* declare variables used to parse command line options:
+   *  @opts: array of long option definitions.
+   *  @o: currently parsed option character.
+   */
+  static struct option opts[] = {
+    { "threads",  required_argument, NULL, 'j' },
+    { "shard",    required_argument, NULL, 's' },
+    { "ensemble", required_argument, NULL, 'e' },
+    { "output",   required_argument, NULL, 'o' },
+    { "append",   required_argument, NULL, 'a' },
+    { "resume",   required_argument, NULL, 'r' },
+    { "batch",    required_argument, NULL, 'b' },
+    { "cache",    required_argument, NULL, 'k' },
+    { "no-cache", no_argument,       NULL, 'K' },
+    { "pdf-file", required_argument, NULL, 'p' },
+    { "pdf-precision", required_argument, NULL, 'P' },
+    { "zorder",   no_argument,       NULL, 'z' },
+    { "tile",     required_argument, NULL, 't' },
+    { NULL, 0, NULL, 0 }
+  };
+  int o;
+
+  /* declare general-purpose loop index variables:
    *  @i: loop counter and iteration index.
+   *  @s, @end: current and final parsed positions in the density list.
    */
   unsigned int i;
+  char *s, *end;
+
+  /* use every online processor by default. */
+  arg = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  opt.nthr = (arg < 1 ? 1 : arg > JITUTIL_THREADS_MAX ?
+              JITUTIL_THREADS_MAX : arg);
+
+  /* sample the whole grid at once, in linear order, by default. */
+  opt.tile = 0;
+  opt.zorder = 0;
+
+  /* sample a single schedule from the entire grid by default. */
+  opt.shard = opt.nshard = 1;
+  opt.nens = 1;
+  prefix = "jitutil";
+
+  /* sample new schedules from the start of their substreams by default. */
+  afile = rfile = bfile = NULL;
+  opt.pre = NULL;
+  opt.pos = NULL;
+  opt.pdf = NULL;
+
+  /* use the cache named by the environment by default. */
+  cdir = NULL;
+  cuse = 1;
+
+  /* evaluate the density function in double precision by default. */
+  pfile = NULL;
+  opt.prec = PDF_PREC_DOUBLE;
+  opt.err = NULL;
+  opt.miss = NULL;
+
+  /* parse the command line options. */
+  while ((o = getopt_long(argc, argv, "+j:t:s:e:o:a:r:b:k:Kp:P:z",
+                          opts, NULL)) != -1) {
+    switch (o) {
+      /* thread count. */
+      case 'j':
+        arg = atoi(optarg);
+        if (arg < 1 || arg > JITUTIL_THREADS_MAX) {
+          fprintf(stderr, "error: thread count must lie in [1,%d]\n",
+                  JITUTIL_THREADS_MAX);
+          return 1;
+        }
+        opt.nthr = (unsigned int) arg;
+        break;
 
-  /* determine the number of grid dimensions. */
-  D = argc - 3;
+      /* tile size. */
+      case 't':
+        arg = atoi(optarg);
+        if (arg < 1) {
+          fprintf(stderr, "error: tile size must be positive\n");
+          return 1;
+        }
+        opt.tile = (unsigned int) arg;
+        break;
+
+      /* grid shard. */
+      case 's':
+        if (sscanf(optarg, "%u/%u", &opt.shard, &opt.nshard) != 2 ||
+            opt.shard < 1 || opt.shard > opt.nshard) {
+          fprintf(stderr, "error: invalid shard '%s'\n", optarg);
+          return 1;
+        }
+        break;
+
+      /* ensemble size. */
+      case 'e':
+        arg = atoi(optarg);
+        if (arg < 1 || arg > JITUTIL_ENSEMBLE_MAX) {
+          fprintf(stderr, "error: ensemble size must lie in [1,%d]\n",
+                  JITUTIL_ENSEMBLE_MAX);
+          return 1;
+        }
+        opt.nens = (unsigned int) arg;
+        break;
+
+      /* output file name prefix. */
+      case 'o':
+        prefix = optarg;
+        break;
+
+      /* schedule file to extend. */
+      case 'a':
+        afile = optarg;
+        break;
+
+      /* file holding the term to resume from. */
+      case 'r':
+        rfile = optarg;
+        break;
+
+      /* batch job file. */
+      case 'b':
+        bfile = optarg;
+        break;
+
+      /* cache directory. */
+      case 'k':
+        cdir = optarg;
+        cuse = 1;
+        break;
+
+      /* disabled cache. */
+      case 'K':
+        cuse = 0;
+        break;
+
+      /* density grid file. */
+      case 'p':
+        pfile = optarg;
+        break;
+
+      /* density value precision. */
+      case 'P':
+        if (!strcmp(optarg, "float64") || !strcmp(optarg, "double"))
+          opt.prec = PDF_PREC_DOUBLE;
+        else if (!strcmp(optarg, "float32") || !strcmp(optarg, "float"))
+          opt.prec = PDF_PREC_FLOAT;
+        else {
+          fprintf(stderr, "error: invalid density precision '%s'\n",
+                  optarg);
+          return 1;
+        }
+        break;
+
+      /* z-order grid storage. */
+      case 'z':
+        opt.zorder = 1;
+        break;
+
+      /* unknown option: output a usage statement and return failure. */
+      default:
+        fprintf(stderr, JITUTIL_USAGE, argv[0], argv[0]);
+        return 1;
+    }
+  }
+
+  /* build the schedules of a batch, if requested. */
+  if (bfile) {
+    /* check that only options shared by every job were given. */
+    if (argc != optind || afile || rfile || pfile || opt.nens > 1 ||
+        opt.nshard > 1 || opt.prec != PDF_PREC_DOUBLE) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: batches take no schedule arguments, and "
+                      "only --threads, --tile, --zorder and --output\n");
+      return 1;
+    }
+
+    /* initialize the julia interpreter on its own thread, which permits
+     * jobs to be built from any thread.
+     */
+    if (!evalstart()) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to initialize julia\n");
+      return 1;
+    }
+
+    /* build the jobs. */
+    opt.shard = 0;
+    bopt.method = NUS_JIT;
+    bopt.seq = NULL;
+    bopt.rej = NULL;
+    bopt.jit = &opt;
+    bopt.prefix = prefix;
+    bopt.nthr = opt.nthr;
+    arg = batch(bfile, &bopt);
+
+    /* free the julia interpreter and return. */
+    evalexit();
+    return (arg ? 0 : 1);
+  }
+
+  /* determine the number of grid dimensions. a density grid file takes
+   * the place of the density function.
+   */
+  D = argc - optind - (pfile ? 1 : 2);
 
   /* check that a supported number of dimensions was requested.
    *
@@ -65,22 +290,46 @@ int main (int argc, char **argv) {
    */
   if (D < JITUTIL_DIMS_MIN || D > JITUTIL_DIMS_MAX) {
     /* output a usage statement and return failure. */
-    fprintf(stderr, JITUTIL_USAGE, argv[0]);
+    fprintf(stderr, JITUTIL_USAGE, argv[0], argv[0]);
     return 1;
   }
 
-  /* read in the sampling density. */
-  d = atof(argv[1]);
+  /* read in the comma-separated sampling densities. */
+  for (nd = 0, s = argv[optind];; s = end + 1) {
+    /* read the next density. */
+    d[nd] = strtod(s, &end);
+
+    /* validate the sampling density. */
+    if (end == s || d[nd] <= 0.0 || d[nd] >= 1.0) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: sampling density must lie in (0,1)\n");
+      return 1;
+    }
+
+    /* move to the next density, if any. */
+    nd++;
+    if (*end != ',')
+      break;
+
+    /* check that the density array has room. */
+    if (nd == JITUTIL_DENS_MAX) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: at most %d densities are supported\n",
+              JITUTIL_DENS_MAX);
+      return 1;
+    }
+  }
 
-  /* validate the sampling density. */
-  if (d <= 0.0 || d >= 1.0) {
+  /* check for trailing characters. */
+  if (*end) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: sampling density must lie in (0,1)\n");
+    fprintf(stderr, "error: invalid sampling density '%s'\n",
+            argv[optind]);
     return 1;
   }
 
   /* allocate the grid size tuple. */
-  if (!tupalloc(&N, D) || !tupalloc(&xt, D)) {
+  if (!tupalloc(&N, D)) {
     /* output an error message and return failure. */
     fprintf(stderr, "error: failed to allocate grid size tuple\n");
     return 1;
@@ -89,7 +338,7 @@ int main (int argc, char **argv) {
   /* read in the grid sizes. */
   for (i = 0; i < tupsize(&N); i++) {
     /* read the currently indexed argument. */
-    tupset(&N, i, atoi(argv[i + 2]));
+    tupset(&N, i, atoi(argv[optind + i + 1]));
 
     /* validate the grid size. */
     if (tupget(&N, i) == 0) {
@@ -99,30 +348,30 @@ int main (int argc, char **argv) {
     }
   }
 
-  /* initialize the julia interpreter. */
-  jl_init(JULIA_INIT_DIR);
-
-  /* build the final schedule array. */
-  if (!jit(argv[argc - 1], &N, d, &xlst)) {
+  /* validate the number of shards. */
+  if (opt.nshard > tupget(&N, D - 1)) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to compute output schedule\n");
+    fprintf(stderr, "error: shard count exceeds N%u grid size\n", D);
     return 1;
   }
 
-  /* print the final schedule values. */
-  for (i = 0; i < tupsize(&xlst); i++) {
-    /* unpack and print the current schedule value. */
-    tupunpack(tupget(&xlst, i), &N, &xt);
-    tupprint(&xt, stdout);
-  }
+  /* convert the shard index to be zero-based. */
+  opt.shard--;
 
-  /* free the allocated tuples. */
-  tupfree(&xlst);
-  tupfree(&xt);
-  tupfree(&N);
+  /* build and write the schedules. */
+  copt.method = NUS_JIT;
+  copt.rej = NULL;
+  copt.jit = &opt;
+  copt.name = "jitutil";
+  copt.prefix = prefix;
+  copt.afile = afile;
+  copt.rfile = rfile;
+  copt.pfile = pfile;
+  copt.cdir = cdir;
+  copt.cuse = cuse;
+  arg = clirun(&N, d, nd, argv[argc - 1], &copt);
 
-  /* return successfully. */
-  evalfree();
-  return 0;
+  /* free the grid size tuple and return. */
+  tupfree(&N);
+  return (arg ? 0 : 1);
 }
-
@@ -27,10 +27,19 @@
 #include <math.h>
 #include <time.h>
 
-/* include the tuple, sorting, jittering and evaluation headers. */
+/* include the gnu option parsing and posix headers. */
+#include <getopt.h>
+#include <unistd.h>
+
+/* include the tuple, sorting, jittering, evaluation, batch, cache and
+ * utility run headers.
+ */
 #include "tup.h"
 #include "jit.h"
 #include "eval.h"
+#include "bat.h"
+#include "cache.h"
+#include "cli.h"
 
 /* define a soft-limit for the number of dimensions that the program
  * is willing to build grids on.
@@ -38,6 +47,13 @@
 #define JITUTIL_DIMS_MIN 1
 #define JITUTIL_DIMS_MAX 3
 
+/* define the maximum number of threads used to evaluate densities, the
+ * maximum ensemble size, and the maximum number of nested densities.
+ */
+#define JITUTIL_THREADS_MAX  256
+#define JITUTIL_ENSEMBLE_MAX 1024
+#define JITUTIL_DENS_MAX     16
+
 /* define a short help message for users who've got no clue.
  */
 #define JITUTIL_USAGE "\
@@ -46,13 +62,42 @@
  Released under the GNU General Public License, ver. 2.0.\n\
 \n\
  Usage:\n\
-  %s density N1 [N2 [N3]] densfunc\n\
+  %s [options] density N1 [N2 [N3]] densfunc\n\
+  %s [options] --batch FILE\n\
 \n\
  The jittered sampling utility permits the creation of generalized\n\
  quasirandom sampling schedules based on an arbitrary density equation.\n\
  The equation specified in denfunc will be used to construct a sampling\n\
  schedule on a one-, two- or three-dimensional grid, having a global\n\
  sampling density equal to D.\n\
+\n\
+ Options:\n\
+  -j, --threads NUM use NUM threads (default: all online processors)\n\
+  -t, --tile SIZE   sample independent tiles of SIZE points per side\n\
+  -s, --shard K/M   sample only the K-th of M slabs of the grid\n\
+  -e, --ensemble K  draw K decorrelated schedules into numbered files\n\
+  -o, --output PRE  prefix the numbered file names with PRE\n\
+  -a, --append FILE extend the schedule in FILE to the new density\n\
+  -r, --resume FILE resume from and record the sequence term in FILE\n\
+  -b, --batch FILE  build the schedule of each job in FILE\n\
+  -k, --cache DIR   reuse and store schedules in the cache directory DIR\n\
+  -K, --no-cache    do not use a schedule cache\n\
+  -p, --pdf-file FILE\n\
+                    read the density grid from FILE instead of densfunc\n\
+  -P, --pdf-precision PREC\n\
+                    sample float64 (default) or float32 density values\n\
+  -z, --zorder      store untiled grids in z-order while sampling\n\
+\n\
+ A comma-separated list of densities builds nested schedules from one\n\
+ draw, each written to a numbered file.\n\
+\n\
+ Each line of a batch file holds a job of the form 'N1[,N2[,N3]] density\n\
+ densfunc', whose schedule is written to a numbered file, and the sizes\n\
+ and timings of all jobs are written to standard output.\n\
+\n\
+ Schedules are cached in the directory named by the NUSUTILS_CACHE\n\
+ environment variable, bounded to NUSUTILS_CACHE_SIZE mebibytes\n\
+ (default: 256).\n\
 \n\
  For more information on how to use and/or cite the jittered sampling\n\
  utility, please consult the manual page for jitutil(1).\n\
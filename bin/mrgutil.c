@@ -0,0 +1,228 @@
+
+/* mrgutil: sharded sampling schedule merge utility.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the main header. */
+#include "mrgutil.h"
+
+/* mrgread(): read the next grid index from a schedule file.
+ *
+ * arguments:
+ *  @fh: file handle to read from.
+ *  @x: array to store the grid index elements into.
+ *  @D: pointer to the number of grid dimensions, or zero if unknown.
+ *
+ * returns:
+ *  integer indicating whether an index was read (1), the file has ended
+ *  (0), or the file is malformed (-1).
+ */
+int mrgread (FILE *fh, unsigned int *x, unsigned int *D) {
+  /* declare required variables:
+   *  @buf: line buffer.
+   *  @s, @end: current and final parsed positions in the line.
+   *  @n: number of elements parsed from the line.
+   *  @v: currently parsed element.
+   */
+  char buf[MRGUTIL_LINE_MAX], *s, *end;
+  unsigned long v;
+  unsigned int n;
+
+  /* read lines until one holds a grid index. */
+  while (fgets(buf, MRGUTIL_LINE_MAX, fh)) {
+    /* parse the elements of the line. */
+    for (s = buf, n = 0;; s = end, n++) {
+      v = strtoul(s, &end, 10);
+      if (end == s)
+        break;
+
+      if (n < MRGUTIL_DIMS_MAX)
+        x[n] = (unsigned int) v;
+    }
+
+    /* skip blank lines. */
+    if (n == 0)
+      continue;
+
+    /* take the dimension count from the first index. */
+    if (*D == 0 && n <= MRGUTIL_DIMS_MAX)
+      *D = n;
+
+    /* return whether the index matches the dimension count. */
+    return (n == *D ? 1 : -1);
+  }
+
+  /* the file has ended. */
+  return 0;
+}
+
+/* mrgcmp(): compare two grid indices by their packed linear indices,
+ * which places the final dimension first.
+ *
+ * arguments:
+ *  @a, @b: arrays of grid index elements to compare.
+ *  @D: number of grid dimensions.
+ *
+ * returns:
+ *  negative, zero or positive integer if @a packs before, onto or after @b.
+ */
+int mrgcmp (unsigned int *a, unsigned int *b, unsigned int D) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   */
+  unsigned int i;
+
+  /* compare from the slowest varying dimension. */
+  for (i = D; i > 0; i--) {
+    if (a[i - 1] != b[i - 1])
+      return (a[i - 1] < b[i - 1] ? -1 : 1);
+  }
+
+  /* the indices are equal. */
+  return 0;
+}
+
+/* main(): application entry point.
+ *
+ * arguments:
+ *  @argc: number of command line arguments.
+ *  @argv: command line argument string array.
+ *
+ * returns:
+ *  integer representing whether execution terminated without error (0)
+ *  or not (1).
+ */
+int main (int argc, char **argv) {
+  /* declare variables to hold the input files:
+   *  @K: number of input files.
+   *  @fh: array of input file handles.
+   *  @x: array of the current grid index of each file.
+   *  @live: array of whether each file has an index remaining.
+   */
+  unsigned int K, *x;
+  FILE **fh;
+  int *live;
+
+  /* declare variables used during the merge:
+   *  @D: number of grid dimensions.
+   *  @last: most recently written grid index.
+   *  @k, @kmin: file loop counter and file holding the next index.
+   *  @i: dimension loop counter.
+   *  @nout: number of written indices.
+   *  @c: comparison of the next index against the last written index.
+   */
+  unsigned int D, last[MRGUTIL_DIMS_MAX], k, kmin, i, nout;
+  int c;
+
+  /* check that at least one file was given. */
+  if (argc < 2) {
+    /* output a usage statement and return failure. */
+    fprintf(stderr, MRGUTIL_USAGE, argv[0]);
+    return 1;
+  }
+
+  /* allocate the per-file arrays. */
+  K = argc - 1;
+  fh = (FILE**) calloc(K, sizeof(FILE*));
+  x = (unsigned int*) calloc(K * MRGUTIL_DIMS_MAX, sizeof(unsigned int));
+  live = (int*) calloc(K, sizeof(int));
+  if (!fh || !x || !live) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate file arrays\n");
+    return 1;
+  }
+
+  /* open each file and read its first index. */
+  for (k = 0, D = 0; k < K; k++) {
+    /* open the file. */
+    fh[k] = fopen(argv[k + 1], "r");
+    if (!fh[k]) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to open '%s'\n", argv[k + 1]);
+      return 1;
+    }
+
+    /* read the first index. */
+    live[k] = mrgread(fh[k], x + k * MRGUTIL_DIMS_MAX, &D);
+  }
+
+  /* repeatedly write the earliest remaining index. */
+  for (nout = 0;;) {
+    /* find the file holding the earliest index. */
+    for (k = 0, kmin = K; k < K; k++) {
+      /* check for malformed files. */
+      if (live[k] < 0) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: malformed schedule in '%s'\n",
+                argv[k + 1]);
+        return 1;
+      }
+
+      /* check for an earlier index. */
+      if (live[k] && (kmin == K ||
+          mrgcmp(x + k * MRGUTIL_DIMS_MAX,
+                 x + kmin * MRGUTIL_DIMS_MAX, D) < 0))
+        kmin = k;
+    }
+
+    /* end the merge once every file has ended. */
+    if (kmin == K)
+      break;
+
+    /* ensure that each file is sorted. */
+    c = (nout ? mrgcmp(x + kmin * MRGUTIL_DIMS_MAX, last, D) : 1);
+    if (c < 0) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: unsorted schedule in '%s'\n", argv[kmin + 1]);
+      return 1;
+    }
+
+    /* write the index, unless it was just written. */
+    if (c > 0) {
+      for (i = 0; i < D; i++) {
+        last[i] = x[kmin * MRGUTIL_DIMS_MAX + i];
+        printf(i ? " %u" : "%u", last[i]);
+      }
+
+      printf("\n");
+      nout++;
+    }
+
+    /* advance the file past the written index. */
+    live[kmin] = mrgread(fh[kmin], x + kmin * MRGUTIL_DIMS_MAX, &D);
+  }
+
+  /* report the number of merged points, which reveals any shard that
+   * lacks points.
+   */
+  fprintf(stderr, "merged %u points from %u schedules\n", nout, K);
+
+  /* close the files and free the per-file arrays. */
+  for (k = 0; k < K; k++)
+    fclose(fh[k]);
+
+  free(fh);
+  free(x);
+  free(live);
+
+  /* return successfully. */
+  return 0;
+}
+
@@ -0,0 +1,57 @@
+
+/* mrgutil: sharded sampling schedule merge utility.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* include the tuple header. */
+#include "tup.h"
+
+/* define a soft-limit for the number of dimensions that the program
+ * is willing to merge schedules on, and the longest accepted line.
+ */
+#define MRGUTIL_DIMS_MAX 3
+#define MRGUTIL_LINE_MAX 256
+
+/* define a short help message for users who've got no clue.
+ */
+#define MRGUTIL_USAGE "\
+ mrgutil: A command-line utility for merging sampling schedules.\n\
+ Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.\n\
+ Released under the GNU General Public License, ver. 2.0.\n\
+\n\
+ Usage:\n\
+  %s file1 [file2 ...]\n\
+\n\
+ The merge utility combines schedules that were built in shards by\n\
+ rejutil(1) or jitutil(1) into a single sorted schedule, which is\n\
+ written to standard output. Each input file must already be sorted,\n\
+ as all schedule utilities output them, and points that appear in more\n\
+ than one file are only written once. The number of merged points is\n\
+ reported on standard error.\n\
+\n\
+ For more information on how to use the merge utility, please consult\n\
+ the manual page for mrgutil(1).\n\
+"
+
@@ -0,0 +1,787 @@
+
+/* nusd: nonuniform sampling schedule server.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the main header. */
+#include "nusd.h"
+
+/* nusdcache: hash buckets of the handle cache, with the number of cached
+ * handles and the lock held while the cache is searched or extended.
+ */
+static nusdent_t *nusdcache[NUSD_CACHE_SIZE];
+static unsigned int nusdncache;
+static pthread_mutex_t nusdcachelock = PTHREAD_MUTEX_INITIALIZER;
+
+/* nusdq: ring of accepted connections that wait for a worker, with its
+ * first entry, its length, and the lock and condition that guard it.
+ */
+static int nusdq[NUSD_QUEUE_MAX];
+static unsigned int nusdqhead, nusdqlen;
+static pthread_mutex_t nusdqlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nusdqcond = PTHREAD_COND_INITIALIZER;
+
+/* nusdquit: whether the server has been asked to stop. */
+static volatile sig_atomic_t nusdquit;
+
+/* nusdexact: whether gap schedules hold exactly the desired point count. */
+static int nusdexact;
+
+/* nusdsignal(): signal handler that asks the server to stop.
+ *
+ * arguments:
+ *  @sig: number of the received signal.
+ */
+static void nusdsignal (int sig) {
+  /* flag the server to stop. */
+  (void) sig;
+  nusdquit = 1;
+}
+
+/* nusdhash(): compute the hash of an equation and its sampling method.
+ *
+ * arguments:
+ *  @method: sampling method of the equation.
+ *  @fn: equation string.
+ *
+ * returns:
+ *  64-bit fnv-1a hash of the method and the equation string.
+ */
+static unsigned long nusdhash (nusmethod_t method, const char *fn) {
+  /* declare required variables:
+   *  @hash: hash value.
+   */
+  unsigned long long hash = 14695981039346656037ULL;
+
+  /* hash the method, and then each character of the string. */
+  hash = (hash ^ (unsigned long long) method) * 1099511628211ULL;
+  for (; *fn; fn++)
+    hash = (hash ^ (unsigned char) *fn) * 1099511628211ULL;
+
+  /* return the hash. */
+  return (unsigned long) hash;
+}
+
+/* nusdfind(): search the cache for the handle of an equation. the cache
+ * lock must be held by the caller.
+ *
+ * arguments:
+ *  @method: sampling method of the equation.
+ *  @fn: equation string.
+ *  @hash: hash of the method and the equation.
+ *
+ * returns:
+ *  pointer to the cached handle, or NULL if none exists.
+ */
+static nus_t *nusdfind (nusmethod_t method, const char *fn,
+                        unsigned long hash) {
+  /* declare required variables:
+   *  @ent: current cache entry.
+   */
+  nusdent_t *ent;
+
+  /* search the bucket of the equation. */
+  for (ent = nusdcache[hash % NUSD_CACHE_SIZE]; ent; ent = ent->next) {
+    /* return the handle of a matching entry. */
+    if (ent->hash == hash && ent->h->method == method &&
+        strcmp(ent->h->fn, fn) == 0)
+      return ent->h;
+  }
+
+  /* no handle was found. */
+  return NULL;
+}
+
+/* nusdget(): look up the handle of an equation in the cache, compiling and
+ * caching a new handle if none exists. the cache is not locked while the
+ * handle compiles, so that other requests are not held up by it. if
+ * another thread cached the same equation in the meantime, its handle is
+ * used and the new one is freed.
+ *
+ * arguments:
+ *  @method: sampling method of the equation.
+ *  @fn: equation string.
+ *  @hit: pointer to the output cache status: 1 if the handle was cached,
+ *        0 if it was compiled and cached, or -1 if it was compiled but
+ *        the cache is full, in which case the caller frees the handle.
+ *
+ * returns:
+ *  pointer to the handle, or NULL on failure.
+ */
+static nus_t *nusdget (nusmethod_t method, const char *fn, int *hit) {
+  /* declare required variables:
+   *  @hash: hash of the method and the equation.
+   *  @ent: new cache entry.
+   *  @h, @hc: compiled and cached handles of the equation.
+   */
+  unsigned long hash;
+  nusdent_t *ent;
+  nus_t *h, *hc;
+
+  /* return the handle of the equation, if it is cached. */
+  hash = nusdhash(method, fn);
+  pthread_mutex_lock(&nusdcachelock);
+  hc = nusdfind(method, fn, hash);
+  pthread_mutex_unlock(&nusdcachelock);
+  if (hc) {
+    *hit = 1;
+    return hc;
+  }
+
+  /* compile a new handle, outside of the cache lock. each handle builds a
+   * schedule in one thread, as the workers already serve requests in
+   * parallel.
+   */
+  h = nusalloc(method, fn);
+  if (!h)
+    return NULL;
+
+  h->nthr = 1;
+  h->exact = nusdexact;
+
+  /* use the handle of another thread that compiled the same equation
+   * first, and free the new one.
+   */
+  pthread_mutex_lock(&nusdcachelock);
+  hc = nusdfind(method, fn, hash);
+  if (hc) {
+    pthread_mutex_unlock(&nusdcachelock);
+    nusfree(h);
+    *hit = 1;
+    return hc;
+  }
+
+  /* cache the handle, unless the cache is full. */
+  ent = (nusdncache < NUSD_CACHE_MAX ?
+         (nusdent_t*) malloc(sizeof(nusdent_t)) : NULL);
+  if (ent) {
+    ent->hash = hash;
+    ent->h = h;
+    ent->next = nusdcache[hash % NUSD_CACHE_SIZE];
+    nusdcache[hash % NUSD_CACHE_SIZE] = ent;
+    nusdncache++;
+  }
+
+  /* return the new handle. */
+  pthread_mutex_unlock(&nusdcachelock);
+  *hit = (ent ? 0 : -1);
+  return h;
+}
+
+/* nusdclear(): free every handle in the cache. */
+static void nusdclear (void) {
+  /* declare required variables:
+   *  @ent, @next: current and next cache entries.
+   *  @i: bucket loop counter.
+   */
+  nusdent_t *ent, *next;
+  unsigned int i;
+
+  /* free the entries of each bucket. */
+  for (i = 0; i < NUSD_CACHE_SIZE; i++) {
+    for (ent = nusdcache[i]; ent; ent = next) {
+      next = ent->next;
+      nusfree(ent->h);
+      free(ent);
+    }
+
+    nusdcache[i] = NULL;
+  }
+
+  nusdncache = 0;
+}
+
+/* nusdusec(): compute the number of microseconds between two times.
+ *
+ * arguments:
+ *  @t0, @t1: pointers to the start and end times.
+ *
+ * returns:
+ *  elapsed time in microseconds.
+ */
+static double nusdusec (struct timespec *t0, struct timespec *t1) {
+  /* return the difference of the two times. */
+  return 1.0e6 * (double) (t1->tv_sec - t0->tv_sec) +
+         1.0e-3 * (double) (t1->tv_nsec - t0->tv_nsec);
+}
+
+/* nusdserve(): parse and answer a single schedule request.
+ *
+ * arguments:
+ *  @line: request line, which is modified.
+ *  @out: file handle to write the response to.
+ */
+static void nusdserve (char *line, FILE *out) {
+  /* declare variables to hold the request:
+   *  @tool: name of the sampling method.
+   *  @grid: comma-separated list of grid sizes.
+   *  @method: sampling method of the request.
+   *  @N: array of grid sizes.
+   *  @D: number of grid dimensions.
+   *  @d: desired sampling density.
+   *  @fn: equation string.
+   *  @pos: offset of the equation in the line.
+   */
+  char tool[8], grid[64], *fn, *s, *end;
+  unsigned int N[NUS_DIMS_MAX], D;
+  nusmethod_t method;
+  unsigned long v;
+  double d;
+  int pos;
+
+  /* declare variables to hold the response:
+   *  @h: schedule generation handle of the equation.
+   *  @hit: cache status of the handle.
+   *  @buf: array of linear indices in the schedule.
+   *  @nbuf, @n: size of the array and number of indices in the schedule.
+   *  @t0, @t1, @t2: request, generation and completion times.
+   *  @i, @k, @x: index and dimension loop counters and unpacked index.
+   */
+  struct timespec t0, t1, t2;
+  unsigned int *buf, nbuf, n, i, k, x;
+  nus_t *h;
+  int hit;
+
+  /* start timing the request. */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  /* strip the line ending, and skip blank lines. */
+  line[strcspn(line, "\r\n")] = '\0';
+  if (line[strspn(line, " \t")] == '\0')
+    return;
+
+  /* parse the fields of the request. */
+  pos = 0;
+  if (sscanf(line, "%7s %63s %lf %n", tool, grid, &d, &pos) != 3 ||
+      pos == 0 || line[pos] == '\0') {
+    fprintf(out, "error invalid request\n");
+    fflush(out);
+    return;
+  }
+
+  fn = line + pos;
+
+  /* parse the sampling method. */
+  if (strcmp(tool, "gap") == 0) {
+    method = NUS_GAP;
+  }
+  else if (strcmp(tool, "rej") == 0) {
+    method = NUS_REJ;
+  }
+  else if (strcmp(tool, "jit") == 0) {
+    method = NUS_JIT;
+  }
+  else {
+    fprintf(out, "error unknown tool '%s'\n", tool);
+    fflush(out);
+    return;
+  }
+
+  /* parse the grid sizes. */
+  for (s = grid, D = 0, nbuf = 1; *s; s = end + (*end == ',')) {
+    v = strtoul(s, &end, 10);
+    if (end == s || (*end && *end != ',') || v < 1 ||
+        v > UINT_MAX / nbuf || D >= NUS_DIMS_MAX) {
+      fprintf(out, "error invalid grid '%s'\n", grid);
+      fflush(out);
+      return;
+    }
+
+    N[D++] = (unsigned int) v;
+    nbuf *= (unsigned int) v;
+  }
+
+  /* look up or compile the handle of the equation. */
+  h = nusdget(method, fn, &hit);
+  if (!h) {
+    fprintf(out, "error failed to compile equation\n");
+    fflush(out);
+    return;
+  }
+
+  /* build the schedule. a schedule never holds more than the grid. */
+  buf = (unsigned int*) malloc(nbuf * sizeof(unsigned int));
+  if (!buf || !nusgen(h, N, D, d, buf, nbuf, &n)) {
+    fprintf(out, "error failed to build schedule\n");
+    fflush(out);
+    if (hit < 0)
+      nusfree(h);
+
+    free(buf);
+    return;
+  }
+
+  /* free handles that could not be cached. */
+  if (hit < 0)
+    nusfree(h);
+
+  /* stream the response, starting with its size and generation time. */
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  fprintf(out, "ok %u %.0f\n", n, nusdusec(&t0, &t1));
+  for (i = 0; i < n; i++) {
+    /* unpack the linear index, first dimension fastest. */
+    for (k = 0, x = buf[i]; k < D; x /= N[k], k++)
+      fprintf(out, k ? " %u" : "%u", x % N[k]);
+
+    fprintf(out, "\n");
+  }
+
+  /* finish the response and report its latency. */
+  fflush(out);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  fprintf(stderr, "nusd: %s %s %g: %u points in %.0f us (%s)\n",
+          tool, grid, d, n, nusdusec(&t0, &t2),
+          hit > 0 ? "cached" : "compiled");
+
+  /* free the schedule. */
+  free(buf);
+}
+
+/* nusdconn(): answer every request received over a connection, until
+ * the client closes it.
+ *
+ * arguments:
+ *  @fd: file descriptor of the connection.
+ */
+static void nusdconn (int fd) {
+  /* declare required variables:
+   *  @in, @out: file handles to read requests and write responses.
+   *  @line: request line buffer.
+   */
+  char line[NUSD_LINE_MAX];
+  FILE *in, *out;
+
+  /* open buffered handles on the connection. */
+  in = fdopen(fd, "r");
+  out = (in ? fdopen(dup(fd), "w") : NULL);
+  if (!in || !out) {
+    fprintf(stderr, "error: failed to open connection\n");
+    if (in)
+      fclose(in);
+    else
+      close(fd);
+
+    return;
+  }
+
+  /* answer each request. */
+  while (fgets(line, NUSD_LINE_MAX, in)) {
+    /* reject lines that do not fit into the buffer. */
+    if (!strchr(line, '\n') && !feof(in)) {
+      fprintf(out, "error request too long\n");
+      fflush(out);
+      break;
+    }
+
+    nusdserve(line, out);
+  }
+
+  /* close the connection. */
+  fclose(out);
+  fclose(in);
+}
+
+/* nusdworker(): worker thread that serves queued connections until the
+ * server is stopped.
+ *
+ * arguments:
+ *  @arg: unused thread argument.
+ *
+ * returns:
+ *  NULL.
+ */
+static void *nusdworker (void *arg) {
+  /* declare required variables:
+   *  @fd: file descriptor of the current connection.
+   */
+  int fd;
+
+  /* serve connections from the queue. */
+  (void) arg;
+  for (;;) {
+    /* wait for a connection, or for the server to stop. */
+    pthread_mutex_lock(&nusdqlock);
+    while (!nusdqlen && !nusdquit)
+      pthread_cond_wait(&nusdqcond, &nusdqlock);
+
+    if (!nusdqlen) {
+      pthread_mutex_unlock(&nusdqlock);
+      break;
+    }
+
+    /* take the first connection. */
+    fd = nusdq[nusdqhead];
+    nusdqhead = (nusdqhead + 1) % NUSD_QUEUE_MAX;
+    nusdqlen--;
+    pthread_cond_broadcast(&nusdqcond);
+    pthread_mutex_unlock(&nusdqlock);
+
+    /* serve the connection. */
+    nusdconn(fd);
+  }
+
+  /* end the thread. */
+  return NULL;
+}
+
+/* nusdaddr(): fill a socket address from a socket path.
+ *
+ * arguments:
+ *  @addr: pointer to the address to fill.
+ *  @path: socket file path.
+ *
+ * returns:
+ *  integer indicating whether the path fits into the address (1) or not (0).
+ */
+static int nusdaddr (struct sockaddr_un *addr, const char *path) {
+  /* check the length of the path. */
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "error: socket path '%s' is too long\n", path);
+    return 0;
+  }
+
+  /* fill the address. */
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+
+  /* return success. */
+  return 1;
+}
+
+/* nusdclient(): send requests read from standard input to a server, and
+ * write its responses to standard output.
+ *
+ * arguments:
+ *  @path: socket file path of the server.
+ *
+ * returns:
+ *  integer indicating whether every request was answered (1) or not (0).
+ */
+static int nusdclient (const char *path) {
+  /* declare required variables:
+   *  @addr: address of the server.
+   *  @fd: file descriptor of the connection.
+   *  @in, @out: file handles to read responses and write requests.
+   *  @line: request and response line buffer.
+   *  @n: number of remaining lines in the current response.
+   */
+  char line[NUSD_LINE_MAX];
+  struct sockaddr_un addr;
+  FILE *in, *out;
+  unsigned int n;
+  int fd;
+
+  /* connect to the server. */
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || !nusdaddr(&addr, path) ||
+      connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "error: failed to connect to '%s'\n", path);
+    return 0;
+  }
+
+  /* open buffered handles on the connection. */
+  in = fdopen(fd, "r");
+  out = (in ? fdopen(dup(fd), "w") : NULL);
+  if (!in || !out) {
+    fprintf(stderr, "error: failed to open connection\n");
+    return 0;
+  }
+
+  /* send each request and copy its response. */
+  while (fgets(line, NUSD_LINE_MAX, stdin)) {
+    /* skip blank lines, which receive no response. */
+    if (line[strspn(line, " \t\r\n")] == '\0')
+      continue;
+
+    /* send the request. */
+    fputs(line, out);
+    if (!strchr(line, '\n'))
+      fputc('\n', out);
+
+    fflush(out);
+
+    /* read the status line of the response. */
+    if (!fgets(line, NUSD_LINE_MAX, in)) {
+      fprintf(stderr, "error: connection closed by server\n");
+      return 0;
+    }
+
+    /* copy the status line and every grid index of the response. */
+    fputs(line, stdout);
+    if (sscanf(line, "ok %u", &n) != 1)
+      n = 0;
+
+    for (; n > 0 && fgets(line, NUSD_LINE_MAX, in); n--)
+      fputs(line, stdout);
+
+    if (n > 0) {
+      fprintf(stderr, "error: truncated response\n");
+      return 0;
+    }
+  }
+
+  /* close the connection and return successfully. */
+  fclose(out);
+  fclose(in);
+  return 1;
+}
+
+/* nusdlisten(): open a listening socket at a path. a stale socket file
+ * left behind by a stopped server is replaced.
+ *
+ * arguments:
+ *  @path: socket file path.
+ *
+ * returns:
+ *  file descriptor of the listening socket, or -1 on failure.
+ */
+static int nusdlisten (const char *path) {
+  /* declare required variables:
+   *  @addr: address of the socket.
+   *  @fd, @fdc: file descriptors of the socket and of a probe connection.
+   */
+  struct sockaddr_un addr;
+  int fd, fdc;
+
+  /* create the socket. */
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || !nusdaddr(&addr, path))
+    return -1;
+
+  /* bind the socket, replacing the path if no server answers on it. */
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+    fdc = (errno == EADDRINUSE ? socket(AF_UNIX, SOCK_STREAM, 0) : -1);
+    if (fdc < 0 ||
+        connect(fdc, (struct sockaddr*) &addr, sizeof(addr)) == 0 ||
+        errno != ECONNREFUSED || unlink(path) < 0 ||
+        bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+      if (fdc >= 0)
+        close(fdc);
+
+      close(fd);
+      return -1;
+    }
+
+    close(fdc);
+  }
+
+  /* listen for connections. */
+  if (listen(fd, NUSD_QUEUE_MAX) < 0) {
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+
+  /* return the socket. */
+  return fd;
+}
+
+/* main(): application entry point.
+ *
+ * arguments:
+ *  @argc: number of command line arguments.
+ *  @argv: command line argument string array.
+ *
+ * returns:
+ *  integer representing whether execution terminated without error (0)
+ *  or not (1).
+ */
+int main (int argc, char **argv) {
+  /* declare variables to hold server parameters:
+   *  @path: socket file path.
+   *  @nthr: number of worker threads.
+   *  @client: whether to run as a client.
+   *  @arg: currently parsed integer option argument.
+   */
+  unsigned int nthr;
+  const char *path;
+  int client, arg;
+
+  /* declare variables used to run the server:
+   *  @thr: array of worker threads.
+   *  @fd, @fdc: file descriptors of the socket and of a connection.
+   *  @sa: signal action that stops the server.
+   *  @mask: set of signals handled by the main thread only.
+   *  @i: thread loop counter.
+   */
+  struct sigaction sa;
+  sigset_t mask;
+  pthread_t *thr;
+  unsigned int i;
+  int fd, fdc;
+
+  /* declare variables used to parse command line options:
+   *  @opts: array of long option definitions.
+   *  @o: currently parsed option character.
+   */
+  static struct option opts[] = {
+    { "threads", required_argument, NULL, 'j' },
+    { "exact",   no_argument,       NULL, 'x' },
+    { "client",  no_argument,       NULL, 'c' },
+    { NULL, 0, NULL, 0 }
+  };
+  int o;
+
+  /* use every online processor by default. */
+  arg = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  nthr = (arg < 1 ? 1 : arg > NUSD_THREADS_MAX ? NUSD_THREADS_MAX : arg);
+  client = 0;
+
+  /* parse the command line options. */
+  while ((o = getopt_long(argc, argv, "+j:xc", opts, NULL)) != -1) {
+    switch (o) {
+      /* worker count. */
+      case 'j':
+        arg = atoi(optarg);
+        if (arg < 1 || arg > NUSD_THREADS_MAX) {
+          fprintf(stderr, "error: thread count must lie in [1,%d]\n",
+                  NUSD_THREADS_MAX);
+          return 1;
+        }
+        nthr = (unsigned int) arg;
+        break;
+
+      /* exact gap schedule sizes. */
+      case 'x':
+        nusdexact = 1;
+        break;
+
+      /* client mode. */
+      case 'c':
+        client = 1;
+        break;
+
+      /* unknown option. */
+      default:
+        fprintf(stderr, NUSD_USAGE, argv[0]);
+        return 1;
+    }
+  }
+
+  /* check that exactly one socket path was given. */
+  if (argc - optind != 1) {
+    /* output a usage statement and return failure. */
+    fprintf(stderr, NUSD_USAGE, argv[0]);
+    return 1;
+  }
+
+  path = argv[optind];
+
+  /* run as a client, if requested. */
+  if (client)
+    return (nusdclient(path) ? 0 : 1);
+
+  /* ignore broken connections, and stop on interrupts. writes to closed
+   * connections then fail instead of ending the server.
+   */
+  signal(SIGPIPE, SIG_IGN);
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = nusdsignal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  /* initialize the library, which starts the julia thread. */
+  if (!nusinit()) {
+    fprintf(stderr, "error: failed to initialize julia\n");
+    return 1;
+  }
+
+  /* open the listening socket. */
+  fd = nusdlisten(path);
+  if (fd < 0) {
+    fprintf(stderr, "error: failed to listen on '%s'\n", path);
+    nusexit();
+    return 1;
+  }
+
+  /* start the workers with interrupts blocked, so that only the main
+   * thread receives them and leaves accept().
+   */
+  thr = (pthread_t*) calloc(nthr, sizeof(pthread_t));
+  if (!thr) {
+    fprintf(stderr, "error: failed to allocate worker threads\n");
+    return 1;
+  }
+
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  for (i = 0; i < nthr; i++) {
+    if (pthread_create(thr + i, NULL, nusdworker, NULL)) {
+      fprintf(stderr, "error: failed to start worker threads\n");
+      return 1;
+    }
+  }
+
+  pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+  fprintf(stderr, "nusd: listening on '%s' with %u workers\n", path, nthr);
+
+  /* accept connections until the server is stopped. */
+  while (!nusdquit) {
+    /* accept the next connection. */
+    fdc = accept(fd, NULL, NULL);
+    if (fdc < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      fprintf(stderr, "error: failed to accept connection\n");
+      break;
+    }
+
+    /* queue the connection for a worker. */
+    pthread_mutex_lock(&nusdqlock);
+    while (nusdqlen == NUSD_QUEUE_MAX && !nusdquit)
+      pthread_cond_wait(&nusdqcond, &nusdqlock);
+
+    if (nusdqlen < NUSD_QUEUE_MAX) {
+      nusdq[(nusdqhead + nusdqlen) % NUSD_QUEUE_MAX] = fdc;
+      nusdqlen++;
+      pthread_cond_broadcast(&nusdqcond);
+    }
+    else {
+      close(fdc);
+    }
+
+    pthread_mutex_unlock(&nusdqlock);
+  }
+
+  /* stop accepting connections, and let the workers finish the queue. */
+  close(fd);
+  unlink(path);
+  pthread_mutex_lock(&nusdqlock);
+  nusdquit = 1;
+  pthread_cond_broadcast(&nusdqcond);
+  pthread_mutex_unlock(&nusdqlock);
+
+  for (i = 0; i < nthr; i++)
+    pthread_join(thr[i], NULL);
+
+  /* free the cached handles and the library. */
+  nusdclear();
+  nusexit();
+  free(thr);
+
+  /* return successfully. */
+  fprintf(stderr, "nusd: stopped\n");
+  return 0;
+}
@@ -0,0 +1,98 @@
+
+/* nusd: nonuniform sampling schedule server.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+/* include the gnu option parsing, posix and socket headers. */
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* include the library header. */
+#include "nus.h"
+
+/* define the maximum number of worker threads, the number of accepted
+ * connections that may wait for a worker, and the longest request line.
+ */
+#define NUSD_THREADS_MAX 256
+#define NUSD_QUEUE_MAX   64
+#define NUSD_LINE_MAX    4096
+
+/* define the number of hash buckets of the handle cache, and the largest
+ * number of handles it holds. requests for equations beyond the limit are
+ * compiled and freed per request.
+ */
+#define NUSD_CACHE_SIZE  256
+#define NUSD_CACHE_MAX   1024
+
+/* define a short help message for users who've got no clue.
+ */
+#define NUSD_USAGE "\
+ nusd: A server for nonuniform sampling schedule generation.\n\
+ Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.\n\
+ Released under the GNU General Public License, ver. 2.0.\n\
+\n\
+ Usage:\n\
+  %s [options] socket\n\
+\n\
+ The schedule server initializes Julia once, listens on a local socket,\n\
+ and answers one schedule request per line, of the form:\n\
+\n\
+  tool N1[,N2[,N3]] density equation\n\
+\n\
+ where tool is one of gap, rej or jit. Each compiled equation is cached\n\
+ for later requests. Every response starts with a line holding 'ok', the\n\
+ number of points and the generation time in microseconds, followed by\n\
+ one grid index per line, or holds a single 'error' line.\n\
+\n\
+ Options:\n\
+  -j, --threads NUM serve NUM requests at once (default: all processors)\n\
+  -x, --exact       build gap schedules of exactly the desired size\n\
+  -c, --client      send requests from standard input to a server\n\
+\n\
+ For more information on how to use the schedule server, please consult\n\
+ the manual page for nusd(1).\n\
+"
+
+/* nusdent_t: type definition of an entry in the handle cache, which
+ * holds a schedule generation handle of a compiled equation.
+ */
+typedef struct nusdent {
+  /* @hash: hash of the sampling method and the equation string.
+   * @h: schedule generation handle of the entry.
+   * @next: next entry in the same hash bucket.
+   */
+  unsigned long hash;
+  nus_t *h;
+  struct nusdent *next;
+}
+nusdent_t;
+
@@ -0,0 +1,442 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the batch header. */
+#include "bat.h"
+
+/* batmsec(): compute the number of milliseconds between two times.
+ *
+ * arguments:
+ *  @t0, @t1: pointers to the start and end times.
+ *
+ * returns:
+ *  elapsed time in milliseconds.
+ */
+double batmsec (struct timespec *t0, struct timespec *t1) {
+  /* return the difference of the two times. */
+  return 1.0e3 * (double) (t1->tv_sec - t0->tv_sec) +
+         1.0e-6 * (double) (t1->tv_nsec - t0->tv_nsec);
+}
+
+/* batparse(): parse a single line of a job file, which holds the grid
+ * sizes as a comma-separated list, the sampling density and the equation.
+ *
+ * arguments:
+ *  @line: job line, which is modified.
+ *  @job: pointer to the job to initialize.
+ *  @fn: pointer to the output equation string within the line.
+ *
+ * returns:
+ *  integer indicating whether a job was parsed (1), the line holds no job
+ *  (0), or the line is malformed (-1).
+ */
+int batparse (char *line, batjob_t *job, char **fn) {
+  /* declare required variables:
+   *  @grid: comma-separated list of grid sizes.
+   *  @N: array of grid sizes.
+   *  @D: number of grid dimensions.
+   *  @s, @end: current and final parsed positions in the grid list.
+   *  @v: currently parsed grid size.
+   *  @pos: offset of the equation in the line.
+   *  @i: dimension loop counter.
+   */
+  unsigned int N[BAT_DIMS_MAX], D, i;
+  char grid[64], *s, *end;
+  unsigned long v;
+  int pos;
+
+  /* strip the line ending, and skip blank and comment lines. */
+  line[strcspn(line, "\r\n")] = '\0';
+  s = line + strspn(line, " \t");
+  if (*s == '\0' || *s == '#')
+    return 0;
+
+  /* parse the fields of the job. */
+  pos = 0;
+  if (sscanf(line, "%63s %lf %n", grid, &job->d, &pos) != 2 ||
+      pos == 0 || line[pos] == '\0' || job->d <= 0.0 || job->d >= 1.0)
+    return -1;
+
+  *fn = line + pos;
+
+  /* parse the grid sizes. */
+  for (s = grid, D = 0; *s; s = end + (*end == ',')) {
+    v = strtoul(s, &end, 10);
+    if (end == s || (*end && *end != ',') || v < 1 || v > UINT_MAX ||
+        D >= BAT_DIMS_MAX)
+      return -1;
+
+    N[D++] = (unsigned int) v;
+  }
+
+  /* store the grid sizes. */
+  if (!tupalloc(&job->N, D))
+    return -1;
+
+  for (i = 0; i < D; i++)
+    tupset(&job->N, i, N[i]);
+
+  /* return success. */
+  return 1;
+}
+
+/* batrun(): build the schedule of a single job and write it to its
+ * numbered output file.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the batch threads.
+ *  @k: index of the job to run.
+ */
+void batrun (batwork_t *W, unsigned int k) {
+  /* declare required variables:
+   *  @job: pointer to the job.
+   *  @G: pointer to the density grid of the job, or NULL.
+   *  @sopt, @ropt, @jopt: options of the job.
+   *  @lst: tuple of schedule indices.
+   *  @fname: output file name.
+   *  @fh: output file handle.
+   *  @t0, @t1: start and end times of each stage.
+   */
+  char fname[BAT_PATH_MAX];
+  struct timespec t0, t1;
+  seqopt_t sopt;
+  rejopt_t ropt;
+  jitopt_t jopt;
+  batjob_t *job;
+  batgrid_t *G;
+  tuple_t lst;
+  FILE *fh;
+
+  /* get the job and its density grid. */
+  job = W->job + k;
+  G = (W->opt->method == NUS_GAP ? NULL : W->grid + job->grid);
+  job->tgrid = -1.0;
+  job->ret = 0;
+  tupinit(&lst);
+
+  /* evaluate the density grid, unless another job already has. jobs
+   * that share the grid wait for its values.
+   */
+  if (G) {
+    pthread_mutex_lock(&G->lock);
+    if (!G->pdf) {
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      G->pdf = pdfgrid(W->E + job->eq, &job->N,
+                       W->opt->method == NUS_REJ ? PDF_NORM_MAX :
+                                                   PDF_NORM_SUM, W->nthr);
+
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      job->tgrid = batmsec(&t0, &t1);
+    }
+
+    pthread_mutex_unlock(&G->lock);
+    if (!G->pdf) {
+      fprintf(stderr, "error: failed to evaluate density values array\n");
+      return;
+    }
+  }
+
+  /* build the schedule using the method of the batch. */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  switch (W->opt->method) {
+    /* gap sampling. */
+    case NUS_GAP:
+      sopt = *W->opt->seq;
+      sopt.nthr = W->nthr;
+      sopt.store = 0;
+      job->ret = seq(W->E + job->eq, &job->N, job->d, &sopt, &lst);
+      break;
+
+    /* rejection sampling. */
+    case NUS_REJ:
+      ropt = *W->opt->rej;
+      ropt.nthr = W->nthr;
+      ropt.pdf = G->pdf;
+      job->ret = rej(W->E + job->eq, &job->N, &job->d, 1, &ropt, &lst);
+      break;
+
+    /* jittered sampling. */
+    case NUS_JIT:
+      jopt = *W->opt->jit;
+      jopt.nthr = W->nthr;
+      jopt.pdf = G->pdf;
+      jopt.miss = NULL;
+      job->ret = jit(W->E + job->eq, &job->N, &job->d, 1, &jopt, &lst);
+      break;
+  }
+
+  /* release the density grid once its final job is done with it. */
+  if (G) {
+    pthread_mutex_lock(&G->lock);
+    if (--G->refs == 0) {
+      pdfrelease(G->pdf);
+      G->pdf = NULL;
+    }
+
+    pthread_mutex_unlock(&G->lock);
+  }
+
+  /* write the schedule to its numbered file. */
+  snprintf(fname, BAT_PATH_MAX, "%s.%u", W->opt->prefix, k + 1);
+  fh = (job->ret ? fopen(fname, "w") : NULL);
+  if (job->ret && (!fh || !tupwrite(fh, &job->N, &lst))) {
+    fprintf(stderr, "error: failed to write schedule '%s'\n", fname);
+    job->ret = 0;
+  }
+
+  if (fh)
+    fclose(fh);
+
+  /* store the size and timing of the schedule. */
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  job->tdraw = batmsec(&t0, &t1);
+  job->n = tupsize(&lst);
+  tupfree(&lst);
+}
+
+/* batthread(): claim and run jobs until none remain.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the batch threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *batthread (void *arg) {
+  /* declare required variables:
+   *  @W: shared state of the batch threads.
+   *  @k: index of the claimed job.
+   */
+  batwork_t *W = (batwork_t*) arg;
+  unsigned int k;
+
+  /* claim jobs in the order of their density grids. */
+  while ((k = __atomic_fetch_add(&W->next, 1, __ATOMIC_RELAXED)) < W->njob)
+    batrun(W, W->ord[k]);
+
+  /* end the thread. */
+  return NULL;
+}
+
+/* batch(): build the schedules of every job in a job file, compiling each
+ * distinct equation once and evaluating each distinct density grid once.
+ * independent jobs run concurrently, and each schedule is written to the
+ * file @prefix.@k for the @k-th job. a summary of the size and timings of
+ * each job is written to standard output.
+ *
+ * arguments:
+ *  @fname: name of the job file.
+ *  @opt: pointer to the options of the batch.
+ *
+ * returns:
+ *  integer indicating whether every job succeeded (1) or not (0).
+ */
+int batch (const char *fname, const batopt_t *opt) {
+  /* declare variables to read the job file:
+   *  @fh: file handle of the job file.
+   *  @line: current line of the job file.
+   *  @fn: equation string of the current line.
+   *  @nline: line number of the current line.
+   *  @ret: status of the current line.
+   */
+  char line[BAT_LINE_MAX], *fn;
+  unsigned int nline;
+  FILE *fh;
+  int ret;
+
+  /* declare variables to hold the jobs and their shared state:
+   *  @W: shared state of the batch threads.
+   *  @nmax: number of allocated jobs, equations and grids.
+   *  @neq, @ngrid: number of equations and grids.
+   *  @type: type of the equations of the method.
+   *  @N: grid sizes of the first job of a grid.
+   */
+  unsigned int nmax, neq, ngrid;
+  evaltype_t type;
+  batwork_t W;
+  tuple_t *N;
+
+  /* declare variables used to run the jobs:
+   *  @nthr: number of batch threads.
+   *  @t0, @t1: start and end times of the batch.
+   *  @i, @j, @k: general-purpose loop counters.
+   */
+  unsigned int nthr, i, j, k;
+  struct timespec t0, t1;
+
+  /* open the job file. */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  fh = fopen(fname, "r");
+  if (!fh) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to open job file '%s'\n", fname);
+    return 0;
+  }
+
+  /* initialize the shared state. */
+  memset(&W, 0, sizeof(batwork_t));
+  W.opt = opt;
+  type = (opt->method == NUS_GAP ? EVAL_GAP : EVAL_PDF);
+  nmax = neq = ngrid = 0;
+
+  /* read the jobs. */
+  for (nline = 1; fgets(line, BAT_LINE_MAX, fh); nline++) {
+    /* grow the job, equation and grid arrays. */
+    if (W.njob == nmax) {
+      nmax = (nmax ? 2 * nmax : 16);
+      W.job = (batjob_t*) realloc(W.job, nmax * sizeof(batjob_t));
+      W.E = (evalctx_t*) realloc(W.E, nmax * sizeof(evalctx_t));
+      W.grid = (batgrid_t*) realloc(W.grid, nmax * sizeof(batgrid_t));
+      if (!W.job || !W.E || !W.grid) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to allocate jobs\n");
+        return 0;
+      }
+    }
+
+    /* parse the job. */
+    ret = batparse(line, W.job + W.njob, &fn);
+    if (ret == 0)
+      continue;
+
+    if (ret < 0) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: invalid job on line %u of '%s'\n",
+              nline, fname);
+      return 0;
+    }
+
+    /* find the equation of the job, or compile it. */
+    for (j = 0; j < neq && strcmp(W.E[j].str, fn) != 0; j++);
+    if (j == neq) {
+      if (!evalinit(W.E + j, fn, type)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compile equation on line %u\n",
+                nline);
+        return 0;
+      }
+
+      neq++;
+    }
+
+    /* find the density grid of the job, or add it. */
+    W.job[W.njob].eq = j;
+    for (k = 0; k < ngrid; k++) {
+      N = &W.job[W.grid[k].job].N;
+      if (W.grid[k].eq != j || tupsize(N) != tupsize(&W.job[W.njob].N))
+        continue;
+
+      for (i = 0; i < tupsize(N) &&
+           tupget(N, i) == tupget(&W.job[W.njob].N, i); i++);
+
+      if (i == tupsize(N))
+        break;
+    }
+
+    if (k == ngrid) {
+      W.grid[k].eq = j;
+      W.grid[k].job = W.njob;
+      W.grid[k].pdf = NULL;
+      W.grid[k].refs = 0;
+      ngrid++;
+    }
+
+    W.grid[k].refs++;
+    W.job[W.njob++].grid = k;
+  }
+
+  /* close the job file. */
+  fclose(fh);
+  if (W.njob == 0) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: no jobs in '%s'\n", fname);
+    return 0;
+  }
+
+  /* initialize the grid locks, now that the grid array is final. */
+  for (k = 0; k < ngrid; k++)
+    pthread_mutex_init(&W.grid[k].lock, NULL);
+
+  /* order the jobs by their density grids, so that each grid is evaluated
+   * and released while its jobs run together.
+   */
+  W.ord = (unsigned int*) malloc(W.njob * sizeof(unsigned int));
+  if (!W.ord) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate jobs\n");
+    return 0;
+  }
+
+  for (k = 0, i = 0; k < ngrid; k++) {
+    for (j = 0; j < W.njob; j++) {
+      if (W.job[j].grid == k)
+        W.ord[i++] = j;
+    }
+  }
+
+  /* share the threads among the running jobs. */
+  nthr = (opt->nthr > 1 ? opt->nthr : 1);
+  nthr = (nthr < W.njob ? nthr : W.njob);
+  W.nthr = (opt->nthr > nthr ? opt->nthr / nthr : 1);
+  W.next = 0;
+
+  /* run the jobs on the batch threads. */
+  thrrun(batthread, &W, nthr);
+
+  /* write the summary of every job. */
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  printf("# job points grid_ms build_ms file\n");
+  for (k = 0, ret = 1; k < W.njob; k++) {
+    if (W.job[k].tgrid >= 0.0)
+      printf("%u %u %.3f %.3f %s.%u%s\n", k + 1, W.job[k].n,
+             W.job[k].tgrid, W.job[k].tdraw, opt->prefix, k + 1,
+             W.job[k].ret ? "" : " failed");
+    else
+      printf("%u %u - %.3f %s.%u%s\n", k + 1, W.job[k].n,
+             W.job[k].tdraw, opt->prefix, k + 1,
+             W.job[k].ret ? "" : " failed");
+
+    ret = (ret && W.job[k].ret);
+  }
+
+  printf("# %u jobs, %u equations, %u grids, %.3f ms\n",
+         W.njob, neq, opt->method == NUS_GAP ? 0 : ngrid,
+         batmsec(&t0, &t1));
+
+  /* free the jobs, equations and grids. */
+  for (k = 0; k < W.njob; k++)
+    tupfree(&W.job[k].N);
+
+  for (j = 0; j < neq; j++)
+    evalfree(W.E + j);
+
+  for (k = 0; k < ngrid; k++)
+    pthread_mutex_destroy(&W.grid[k].lock);
+
+  free(W.job);
+  free(W.E);
+  free(W.grid);
+  free(W.ord);
+
+  /* return the status of the jobs. */
+  return ret;
+}
@@ -0,0 +1,143 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_BAT_H__
+#define __NUSUTILS_BAT_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+/* include the posix threads header. */
+#include <pthread.h>
+
+/* include the library, sampling, evaluation, density grid and thread
+ * headers.
+ */
+#include "nus.h"
+#include "seq.h"
+#include "rej.h"
+#include "jit.h"
+#include "eval.h"
+#include "pdf.h"
+#include "thr.h"
+
+/* define the largest number of grid dimensions of a job, the longest
+ * line of a job file, and the longest output file name.
+ */
+#define BAT_DIMS_MAX  3
+#define BAT_LINE_MAX  4096
+#define BAT_PATH_MAX  4096
+
+/* batjob_t: type definition of a single job of a batch. */
+typedef struct {
+  /* @N: tuple of Nyquist grid sizes.
+   * @d: desired sampling density.
+   * @eq: index of the compiled equation of the job.
+   * @grid: index of the density grid of the job.
+   */
+  tuple_t N;
+  double d;
+  unsigned int eq, grid;
+
+  /* @n: number of points in the schedule.
+   * @tgrid: time spent evaluating the density grid, or negative if the
+   *         grid was evaluated by another job.
+   * @tdraw: time spent building and writing the schedule.
+   * @ret: status of the job.
+   */
+  unsigned int n;
+  double tgrid, tdraw;
+  int ret;
+}
+batjob_t;
+
+/* batgrid_t: type definition of a density grid shared by every job that
+ * has the same density function and grid size.
+ */
+typedef struct {
+  /* @eq: index of the compiled equation of the grid.
+   * @job: index of the first job of the grid.
+   * @pdf: array of density values, or NULL until the first job needs it.
+   * @refs: number of jobs that have not yet used the grid.
+   * @lock: lock held while the grid is evaluated or released.
+   */
+  unsigned int eq, job;
+  double *pdf;
+  unsigned int refs;
+  pthread_mutex_t lock;
+}
+batgrid_t;
+
+/* batopt_t: type definition of the options of a batch, which hold the
+ * options of the sampling method as a template for every job.
+ */
+typedef struct {
+  /* @method: sampling method of every job.
+   * @seq, @rej, @jit: pointer to the options of the method in use.
+   */
+  nusmethod_t method;
+  const seqopt_t *seq;
+  const rejopt_t *rej;
+  const jitopt_t *jit;
+
+  /* @prefix: prefix of the numbered output file names.
+   * @nthr: total number of threads shared by all running jobs.
+   */
+  const char *prefix;
+  unsigned int nthr;
+}
+batopt_t;
+
+/* batwork_t: type definition of the shared state of the batch threads,
+ * which claim jobs in the order of their density grids.
+ */
+typedef struct {
+  /* @opt: pointer to the batch options.
+   * @job: array of jobs.
+   * @ord: array of job indices, in the order that jobs are claimed.
+   * @E: array of compiled equations.
+   * @grid: array of density grids.
+   */
+  const batopt_t *opt;
+  batjob_t *job;
+  unsigned int *ord;
+  evalctx_t *E;
+  batgrid_t *grid;
+
+  /* @njob: number of jobs.
+   * @nthr: number of threads given to each job.
+   * @next: index of the next job to claim.
+   */
+  unsigned int njob, nthr, next;
+}
+batwork_t;
+
+/* function declarations: */
+
+int batch (const char *fname, const batopt_t *opt);
+
+#endif /* !__NUSUTILS_BAT_H__ */
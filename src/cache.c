@@ -0,0 +1,653 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the cache header. */
+#include "cache.h"
+
+/* include the posix file, directory and memory mapping headers. */
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* CACHE_MAGIC: magic bytes at the start of every cache entry file. */
+#define CACHE_MAGIC  "nuscach2"
+
+/* CACHE_SUFFIX: file name suffix of every cache entry. */
+#define CACHE_SUFFIX  ".nus"
+
+/* cachelru_t: type definition of an entry file considered for eviction. */
+typedef struct {
+  /* @name: file name of the entry.
+   * @size: size of the entry file.
+   * @mtime: time of the last use of the entry, in nanoseconds.
+   */
+  char *name;
+  unsigned long long size, mtime;
+}
+cachelru_t;
+
+/* cachehash(): compute the hash of a cache key.
+ *
+ * arguments:
+ *  @key: key string to hash.
+ *
+ * returns:
+ *  64-bit fnv-1a hash of the key string.
+ */
+uint64_t cachehash (const char *key) {
+  /* declare required variables:
+   *  @h: running hash value.
+   */
+  uint64_t h = 14695981039346656037ULL;
+
+  /* hash each character of the string. */
+  for (; *key; key++) {
+    h ^= (unsigned char) *key;
+    h *= 1099511628211ULL;
+  }
+
+  /* return the computed result. */
+  return h;
+}
+
+/* cachesum(): compute the checksum of the data of a cache entry, which
+ * folds each whole 64-bit word, and then each remaining byte, into a
+ * 64-bit fnv-1a hash.
+ *
+ * arguments:
+ *  @data: pointer to the entry data.
+ *  @n: number of bytes of entry data.
+ *
+ * returns:
+ *  checksum of the entry data.
+ */
+uint64_t cachesum (const void *data, size_t n) {
+  /* declare required variables:
+   *  @p: pointer to the bytes of the data.
+   *  @h: running hash value.
+   *  @w: current word of the data.
+   *  @i: byte offset of the current word or byte.
+   */
+  const unsigned char *p = (const unsigned char*) data;
+  uint64_t h = 14695981039346656037ULL, w;
+  size_t i;
+
+  /* hash each whole word, and then each remaining byte. */
+  for (i = 0; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+    memcpy(&w, p + i, sizeof(uint64_t));
+    h = (h ^ w) * 1099511628211ULL;
+  }
+
+  for (; i < n; i++)
+    h = (h ^ p[i]) * 1099511628211ULL;
+
+  /* return the computed result. */
+  return h;
+}
+
+/* cachepath(): build the path of the entry file of a cache key.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @key: key string of the entry.
+ *
+ * returns:
+ *  newly allocated path string, or NULL on failure.
+ */
+char *cachepath (cache_t *C, const char *key) {
+  /* declare required variables:
+   *  @path: path string.
+   */
+  char *path;
+
+  /* allocate and build the path. */
+  path = (char*) malloc(strlen(C->dir) + 32);
+  if (path)
+    sprintf(path, "%s/%016llx" CACHE_SUFFIX, C->dir,
+            (unsigned long long) cachehash(key));
+
+  /* return the path. */
+  return path;
+}
+
+/* cacheopen(): open a cache directory, which is created if it does not
+ * exist. when no directory is given, the directory named by the cache
+ * environment variable is used, if any.
+ *
+ * arguments:
+ *  @C: pointer to the cache to initialize.
+ *  @dir: path of the cache directory, or NULL.
+ *
+ * returns:
+ *  integer indicating whether a cache is in use (1) or not (0).
+ */
+int cacheopen (cache_t *C, const char *dir) {
+  /* declare required variables:
+   *  @env: value of the size bound environment variable.
+   *  @mb: size bound in mebibytes.
+   */
+  unsigned long mb;
+  const char *env;
+
+  /* locate the cache directory. */
+  C->dir = NULL;
+  if (!dir)
+    dir = getenv(CACHE_ENV);
+
+  if (!dir || !*dir)
+    return 0;
+
+  /* create the directory, if necessary. */
+  if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+    fprintf(stderr, "warning: failed to create cache '%s'\n", dir);
+    return 0;
+  }
+
+  /* store the directory path. */
+  C->dir = (char*) malloc(strlen(dir) + 1);
+  if (!C->dir)
+    return 0;
+
+  strcpy(C->dir, dir);
+
+  /* read the size bound. */
+  env = getenv(CACHE_SIZE_ENV);
+  mb = (env ? strtoul(env, NULL, 10) : 0);
+  C->max = (unsigned long long) (mb ? mb : CACHE_SIZE_DEF) << 20;
+
+  /* return success. */
+  return 1;
+}
+
+/* cacheclose(): free the memory held by a cache.
+ *
+ * arguments:
+ *  @C: pointer to the cache to free.
+ */
+void cacheclose (cache_t *C) {
+  /* free the directory path. */
+  free(C->dir);
+  C->dir = NULL;
+}
+
+/* cachekey(): build the key string of a cached result, which holds every
+ * input that determines it.
+ *
+ * arguments:
+ *  @tool: name of the program building the result.
+ *  @opts: string of the options that determine the result.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @d: array of sampling densities, or NULL.
+ *  @nd: number of sampling densities.
+ *  @fn: gap equation or density function string.
+ *
+ * returns:
+ *  newly allocated key string, or NULL on failure.
+ */
+char *cachekey (const char *tool, const char *opts, tuple_t *N,
+                const double *d, unsigned int nd, const char *fn) {
+  /* declare required variables:
+   *  @key: key string.
+   *  @len: length of the key string.
+   *  @i: grid dimension and density loop counter.
+   */
+  unsigned int i;
+  size_t len;
+  char *key;
+
+  /* allocate the key string. */
+  key = (char*) malloc(strlen(CACHE_VERSION) + strlen(tool) +
+                       strlen(opts) + strlen(fn) +
+                       16 * tupsize(N) + 32 * nd + 32);
+  if (!key)
+    return NULL;
+
+  /* write the version, the tool and its options. */
+  len = sprintf(key, "%s\n%s\n%s\nN", CACHE_VERSION, tool, opts);
+
+  /* write the grid sizes and the densities. */
+  for (i = 0; i < tupsize(N); i++)
+    len += sprintf(key + len, " %u", tupget(N, i));
+
+  len += sprintf(key + len, "\nd");
+  for (i = 0; i < nd; i++)
+    len += sprintf(key + len, " %.17g", d[i]);
+
+  /* write the equation. */
+  sprintf(key + len, "\n%s", fn);
+
+  /* return the key. */
+  return key;
+}
+
+/* cacheget(): map the entry of a key from the cache, and mark the entry as
+ * the most recently used one. the mapping is private, so the data may be
+ * used in place without modifying the entry.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @key: key string of the entry.
+ *  @ent: pointer to the output mapped entry.
+ *
+ * returns:
+ *  integer indicating whether the entry was found (1) or not (0).
+ */
+int cacheget (cache_t *C, const char *key, cacheent_t *ent) {
+  /* declare required variables:
+   *  @path: path of the entry file.
+   *  @st: status of the entry file.
+   *  @hdr: pointer to the header of the entry.
+   *  @off: offset of the entry data.
+   *  @fd: file descriptor of the entry file.
+   */
+  cachehdr_t *hdr;
+  struct stat st;
+  char *path;
+  size_t off;
+  int fd;
+
+  /* open the entry file. */
+  ent->map = ent->data = NULL;
+  path = cachepath(C, key);
+  fd = (path ? open(path, O_RDONLY) : -1);
+  free(path);
+  if (fd < 0)
+    return 0;
+
+  /* map the entry file. */
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(cachehdr_t) ||
+      (ent->map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+    ent->map = NULL;
+    close(fd);
+    return 0;
+  }
+
+  /* check that the entry belongs to the key, is complete, and matches
+   * its checksum.
+   */
+  ent->nmap = st.st_size;
+  hdr = (cachehdr_t*) ent->map;
+  off = sizeof(cachehdr_t) + ((hdr->nkey + 7) & ~7UL);
+  if (memcmp(hdr->magic, CACHE_MAGIC, 8) != 0 ||
+      hdr->nkey != strlen(key) || off > ent->nmap ||
+      hdr->ndata != ent->nmap - off ||
+      memcmp((char*) ent->map + sizeof(cachehdr_t), key, hdr->nkey) != 0 ||
+      cachesum((char*) ent->map + off, hdr->ndata) != hdr->sum) {
+    cacherelease(ent);
+    close(fd);
+    return 0;
+  }
+
+  /* mark the entry as recently used. */
+  futimens(fd, NULL);
+  close(fd);
+
+  /* return the entry data. */
+  ent->data = (char*) ent->map + off;
+  ent->ndata = hdr->ndata;
+  return 1;
+}
+
+/* cacherelease(): unmap a cache entry.
+ *
+ * arguments:
+ *  @ent: pointer to the entry to unmap.
+ */
+void cacherelease (cacheent_t *ent) {
+  /* unmap the entry file. */
+  if (ent->map)
+    munmap(ent->map, ent->nmap);
+
+  ent->map = ent->data = NULL;
+  ent->nmap = ent->ndata = 0;
+}
+
+/* cachelrucmp(): compare two entry files by the time of their last use.
+ *
+ * arguments:
+ *  @a, @b: pointers to the entry files to compare.
+ *
+ * returns:
+ *  negative, zero or positive integer if @a was used before, at the same
+ *  time or after @b.
+ */
+int cachelrucmp (const void *a, const void *b) {
+  /* declare required variables:
+   *  @ea, @eb: entry files to compare.
+   */
+  const cachelru_t *ea = (const cachelru_t*) a;
+  const cachelru_t *eb = (const cachelru_t*) b;
+
+  /* compare the times of last use. */
+  return (ea->mtime < eb->mtime ? -1 : ea->mtime > eb->mtime ? 1 : 0);
+}
+
+/* cacheevict(): remove the least recently used entries of a cache until
+ * the total size of its entries lies within its bound.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ */
+void cacheevict (cache_t *C) {
+  /* declare required variables:
+   *  @dh: directory handle of the cache.
+   *  @de: current directory entry.
+   *  @st: status of the current entry file.
+   *  @lru: array of entry files.
+   *  @n, @nmax: number of listed and allocated entry files.
+   *  @total: total size of the entry files.
+   *  @path: path of the current entry file.
+   *  @len: length of the current file name.
+   *  @i: entry file loop counter.
+   */
+  unsigned long long total;
+  unsigned int n, nmax, i;
+  struct dirent *de;
+  struct stat st;
+  cachelru_t *lru;
+  char *path;
+  size_t len;
+  DIR *dh;
+
+  /* open the cache directory. */
+  dh = opendir(C->dir);
+  path = (char*) malloc(strlen(C->dir) + 256 + 2);
+  if (!dh || !path) {
+    if (dh)
+      closedir(dh);
+
+    free(path);
+    return;
+  }
+
+  /* list the entry files, with their sizes and times of last use. */
+  lru = NULL;
+  total = 0;
+  for (n = nmax = 0; (de = readdir(dh));) {
+    /* skip files that are not entries. */
+    len = strlen(de->d_name);
+    if (len < strlen(CACHE_SUFFIX) || de->d_name[0] == '.' ||
+        strcmp(de->d_name + len - strlen(CACHE_SUFFIX), CACHE_SUFFIX))
+      continue;
+
+    sprintf(path, "%s/%s", C->dir, de->d_name);
+    if (stat(path, &st) < 0)
+      continue;
+
+    /* grow the array of entry files. */
+    if (n == nmax) {
+      nmax = (nmax ? 2 * nmax : 64);
+      lru = (cachelru_t*) realloc(lru, nmax * sizeof(cachelru_t));
+      if (!lru)
+        break;
+    }
+
+    /* store the entry file. */
+    lru[n].name = (char*) malloc(len + 1);
+    if (!lru[n].name)
+      break;
+
+    strcpy(lru[n].name, de->d_name);
+    lru[n].size = st.st_size;
+    lru[n].mtime = 1000000000ULL * st.st_mtim.tv_sec + st.st_mtim.tv_nsec;
+    total += lru[n++].size;
+  }
+
+  closedir(dh);
+
+  /* remove the least recently used entries until the bound is met. */
+  if (lru && total > C->max) {
+    qsort(lru, n, sizeof(cachelru_t), cachelrucmp);
+    for (i = 0; i < n && total > C->max; i++) {
+      sprintf(path, "%s/%s", C->dir, lru[i].name);
+      if (unlink(path) == 0)
+        total -= lru[i].size;
+    }
+  }
+
+  /* free the array of entry files. */
+  for (i = 0; lru && i < n; i++)
+    free(lru[i].name);
+
+  free(lru);
+  free(path);
+}
+
+/* cacheput(): store data in the cache under a key. the entry is written
+ * to a temporary file that then replaces any existing entry, so readers
+ * never see a partially written entry. least recently used entries are
+ * then evicted as needed.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @key: key string of the entry.
+ *  @data: data of the entry.
+ *  @n: number of bytes of data.
+ *
+ * returns:
+ *  integer indicating whether the entry was stored (1) or not (0).
+ */
+int cacheput (cache_t *C, const char *key, const void *data, size_t n) {
+  /* declare required variables:
+   *  @hdr: header of the entry.
+   *  @pad: padding bytes after the key.
+   *  @path, @tmp: paths of the entry file and of the temporary file.
+   *  @fh: file handle of the temporary file.
+   *  @fd: file descriptor of the temporary file.
+   *  @ok: whether every write succeeded.
+   */
+  char pad[8], *path, *tmp;
+  cachehdr_t hdr;
+  FILE *fh;
+  int fd, ok;
+
+  /* build the paths of the entry and temporary files. */
+  path = cachepath(C, key);
+  tmp = (char*) malloc(strlen(C->dir) + 32);
+  if (!path || !tmp) {
+    free(path);
+    free(tmp);
+    return 0;
+  }
+
+  sprintf(tmp, "%s/.tmpXXXXXX", C->dir);
+
+  /* open the temporary file. */
+  fd = mkstemp(tmp);
+  fh = (fd >= 0 ? fdopen(fd, "wb") : NULL);
+  if (!fh) {
+    if (fd >= 0) {
+      close(fd);
+      unlink(tmp);
+    }
+
+    free(path);
+    free(tmp);
+    return 0;
+  }
+
+  /* build the header. */
+  memset(&hdr, 0, sizeof(cachehdr_t));
+  memcpy(hdr.magic, CACHE_MAGIC, 8);
+  hdr.nkey = strlen(key);
+  hdr.ndata = n;
+  hdr.sum = cachesum(data, n);
+  memset(pad, 0, 8);
+
+  /* write the header, the padded key and the data. */
+  ok = (fwrite(&hdr, sizeof(cachehdr_t), 1, fh) == 1);
+  ok = (ok && fwrite(key, 1, hdr.nkey, fh) == hdr.nkey);
+  ok = (ok && fwrite(pad, 1, (8 - hdr.nkey % 8) % 8, fh) ==
+              (8 - hdr.nkey % 8) % 8);
+  ok = (ok && fwrite(data, 1, n, fh) == n);
+
+  /* close the temporary file and move it over the entry file. */
+  ok = (fclose(fh) == 0 && ok);
+  ok = (ok && chmod(tmp, 0644) == 0 && rename(tmp, path) == 0);
+
+  /* remove the temporary file on failure. */
+  if (!ok)
+    unlink(tmp);
+
+  /* free the paths, and bound the size of the cache. */
+  free(path);
+  free(tmp);
+  if (ok)
+    cacheevict(C);
+
+  /* return the status. */
+  return ok;
+}
+
+/* cachegetlst(): read an array of schedule tuples from the cache. the
+ * entry holds the number of tuples, followed by the size and the packed
+ * indices of each tuple, all as 32-bit unsigned integers. the indices of
+ * each tuple must lie on the grid, in strictly increasing order.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @key: key string of the entry.
+ *  @lst: array of output tuples.
+ *  @nlst: number of output tuples.
+ *  @n: number of grid points.
+ *
+ * returns:
+ *  integer indicating whether the tuples were read (1) or not (0).
+ */
+int cachegetlst (cache_t *C, const char *key, tuple_t *lst,
+                 unsigned int nlst, unsigned int n) {
+  /* declare required variables:
+   *  @ent: mapped cache entry.
+   *  @v: array of integers in the entry.
+   *  @nv, @off: number of integers and offset of the current tuple.
+   *  @k, @i: tuple and index loop counters.
+   */
+  cacheent_t ent;
+  uint32_t *v;
+  size_t nv, off;
+  unsigned int k, i;
+
+  /* map the entry, and check the number of tuples. */
+  if (!cacheget(C, key, &ent))
+    return 0;
+
+  v = (uint32_t*) ent.data;
+  nv = ent.ndata / sizeof(uint32_t);
+  if (nv < 1 || v[0] != nlst) {
+    cacherelease(&ent);
+    return 0;
+  }
+
+  /* copy each tuple out of the entry. */
+  for (k = 0, off = 1; k < nlst; k++) {
+    /* check the size of the tuple. */
+    tupinit(lst + k);
+    if (off >= nv || v[off] > nv - off - 1)
+      break;
+
+    /* check the packed indices. */
+    for (i = 0; i < v[off]; i++) {
+      if (v[off + 1 + i] >= n || (i && v[off + 1 + i] <= v[off + i]))
+        break;
+    }
+
+    if (i < v[off])
+      break;
+
+    /* copy the packed indices. */
+    if (v[off]) {
+      if (!tupalloc(lst + k, v[off]))
+        break;
+
+      memcpy(lst[k].elem, v + off + 1, v[off] * sizeof(uint32_t));
+    }
+
+    off += v[off] + 1;
+  }
+
+  /* unmap the entry and check that every tuple was read. */
+  cacherelease(&ent);
+  if (k < nlst || off != nv) {
+    for (k = 0; k < nlst; k++)
+      tupfree(lst + k);
+
+    return 0;
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* cacheputlst(): store an array of schedule tuples in the cache, in the
+ * format read by cachegetlst().
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @key: key string of the entry.
+ *  @lst: array of tuples to store.
+ *  @nlst: number of tuples.
+ *
+ * returns:
+ *  integer indicating whether the tuples were stored (1) or not (0).
+ */
+int cacheputlst (cache_t *C, const char *key, tuple_t *lst,
+                 unsigned int nlst) {
+  /* declare required variables:
+   *  @v: array of integers to store.
+   *  @nv, @off: number of integers and offset of the current tuple.
+   *  @k: tuple loop counter.
+   *  @ok: status of the store.
+   */
+  size_t nv, off;
+  unsigned int k;
+  uint32_t *v;
+  int ok;
+
+  /* count and allocate the integers of the entry. */
+  for (k = 0, nv = 1; k < nlst; k++)
+    nv += tupsize(lst + k) + 1;
+
+  v = (uint32_t*) malloc(nv * sizeof(uint32_t));
+  if (!v)
+    return 0;
+
+  /* pack the tuples. */
+  v[0] = nlst;
+  for (k = 0, off = 1; k < nlst; k++) {
+    v[off] = tupsize(lst + k);
+    if (v[off])
+      memcpy(v + off + 1, lst[k].elem, v[off] * sizeof(uint32_t));
+
+    off += v[off] + 1;
+  }
+
+  /* store the entry. */
+  ok = cacheput(C, key, v, nv * sizeof(uint32_t));
+  free(v);
+
+  /* return the status. */
+  return ok;
+}
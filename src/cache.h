@@ -0,0 +1,108 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_CACHE_H__
+#define __NUSUTILS_CACHE_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* include the tuple header. */
+#include "tup.h"
+
+/* define the environment variables that enable the cache directory and
+ * bound its size in mebibytes, and the default size bound.
+ */
+#define CACHE_ENV       "NUSUTILS_CACHE"
+#define CACHE_SIZE_ENV  "NUSUTILS_CACHE_SIZE"
+#define CACHE_SIZE_DEF  256
+
+/* CACHE_VERSION: version of the programs that write cache entries. it is
+ * part of every key, so that entries written by versions that may build
+ * other schedules are never served.
+ */
+#define CACHE_VERSION  "nusutils 20151016"
+
+/* cachehdr_t: type definition of the header of a cache entry file, which
+ * is followed by the key string, padded to eight bytes, and then by the
+ * data of the entry.
+ */
+typedef struct {
+  /* @magic: magic bytes identifying cache entry files.
+   * @nkey: number of bytes in the key string.
+   * @ndata: number of bytes of entry data.
+   * @sum: checksum of the entry data.
+   */
+  char magic[8];
+  uint32_t nkey, pad;
+  uint64_t ndata, sum;
+}
+cachehdr_t;
+
+/* cache_t: type definition of a size-bounded directory of cache entries,
+ * which are evicted in least recently used order.
+ */
+typedef struct {
+  /* @dir: path of the cache directory.
+   * @max: largest total size of all entries, in bytes.
+   */
+  char *dir;
+  unsigned long long max;
+}
+cache_t;
+
+/* cacheent_t: type definition of a memory-mapped cache entry. */
+typedef struct {
+  /* @map, @nmap: address and size of the mapped entry file.
+   * @data, @ndata: address and size of the entry data.
+   */
+  void *map, *data;
+  size_t nmap, ndata;
+}
+cacheent_t;
+
+/* function declarations: */
+
+int cacheopen (cache_t *C, const char *dir);
+
+void cacheclose (cache_t *C);
+
+char *cachekey (const char *tool, const char *opts, tuple_t *N,
+                const double *d, unsigned int nd, const char *fn);
+
+int cacheget (cache_t *C, const char *key, cacheent_t *ent);
+
+void cacherelease (cacheent_t *ent);
+
+int cacheput (cache_t *C, const char *key, const void *data, size_t n);
+
+int cachegetlst (cache_t *C, const char *key, tuple_t *lst,
+                 unsigned int nlst, unsigned int n);
+
+int cacheputlst (cache_t *C, const char *key, tuple_t *lst,
+                 unsigned int nlst);
+
+#endif /* !__NUSUTILS_CACHE_H__ */
@@ -0,0 +1,422 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+
+/* include the utility run header. */
+#include "cli.h"
+
+/* cliread(): read the points of the schedule to extend and the term to
+ * resume from, when they are named by the options of a run.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of grid sizes.
+ *  @opt: pointer to the options of the run.
+ *  @pre: pointer to the output tuple of points already sampled.
+ *  @pos: pointer to the output term to resume from, which is unchanged
+ *        if it was not yet recorded.
+ *
+ * returns:
+ *  integer indicating whether the files were read (1) or not (0).
+ */
+int cliread (tuple_t *N, const cliopt_t *opt, tuple_t *pre,
+             unsigned long *pos) {
+  /* declare required variables:
+   *  @fh: input file handle.
+   */
+  FILE *fh;
+
+  /* read the points of the schedule to extend. */
+  if (opt->afile) {
+    fh = fopen(opt->afile, "r");
+    tupinit(pre);
+    if (!fh || !tupread(fh, N, pre)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to read schedule '%s'\n", opt->afile);
+      if (fh)
+        fclose(fh);
+
+      return 0;
+    }
+
+    fclose(fh);
+  }
+
+  /* read the term to resume from, if it was recorded. */
+  if (opt->rfile) {
+    fh = fopen(opt->rfile, "r");
+    if (fh && fscanf(fh, "%lu", pos) != 1) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to read position '%s'\n", opt->rfile);
+      return 0;
+    }
+
+    if (fh)
+      fclose(fh);
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* cliwrite(): record the term to resume from, and write the schedules
+ * of a run. single schedules are written to standard output, and each
+ * schedule of an ensemble or a density list to its own numbered file.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of grid sizes.
+ *  @opt: pointer to the options of the run.
+ *  @lst: array of schedules of each ensemble member and density, which
+ *        are freed as they are written.
+ *  @nens: number of ensemble members.
+ *  @nd: number of sampling densities.
+ *  @pos: term to resume from.
+ *
+ * returns:
+ *  integer indicating whether the schedules were written (1) or not (0).
+ */
+int cliwrite (tuple_t *N, const cliopt_t *opt, tuple_t *lst,
+              unsigned int nens, unsigned int nd, unsigned long pos) {
+  /* declare required variables:
+   *  @fname: output file name of the current schedule.
+   *  @fh: output file handle of the current schedule.
+   *  @e, @j, @k: member, density and schedule loop counters.
+   */
+  char fname[CLI_PATH_MAX];
+  unsigned int e, j, k;
+  FILE *fh;
+
+  /* record the term to resume from. */
+  if (opt->rfile) {
+    fh = fopen(opt->rfile, "w");
+    if (!fh) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to write position '%s'\n",
+              opt->rfile);
+      return 0;
+    }
+
+    fprintf(fh, "%lu\n", pos);
+    fclose(fh);
+  }
+
+  /* loop over the schedules of each ensemble member and density. */
+  for (k = 0; k < nens * nd; k++) {
+    /* get the member and density indices. */
+    e = k / nd;
+    j = k % nd;
+
+    /* open the numbered file of the schedule, if required. */
+    fh = stdout;
+    if (nens > 1 || nd > 1) {
+      if (nens > 1 && nd > 1)
+        snprintf(fname, CLI_PATH_MAX, "%s.%u.%u", opt->prefix, e + 1, j + 1);
+      else
+        snprintf(fname, CLI_PATH_MAX, "%s.%u", opt->prefix,
+                 nens > 1 ? e + 1 : j + 1);
+
+      fh = fopen(fname, "w");
+      if (!fh) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to open '%s'\n", fname);
+        return 0;
+      }
+    }
+
+    /* print the final schedule values. */
+    if (!tupwrite(fh, N, lst + k)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to write schedule\n");
+      return 0;
+    }
+
+    /* close the output file and free the schedule. */
+    if (fh != stdout)
+      fclose(fh);
+
+    tupfree(lst + k);
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* clirun(): build and write the schedules of a single run of a density
+ * sampling utility. the schedules are read from the cache if they were
+ * stored, and are otherwise drawn from the density grid, which is read
+ * from its file, mapped from the cache, or evaluated and cached.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of grid sizes.
+ *  @d: array of sampling densities, in (0,1).
+ *  @nd: number of sampling densities.
+ *  @fn: string of the density equation.
+ *  @opt: pointer to the options of the run.
+ *
+ * returns:
+ *  integer indicating whether the run succeeded (1) or not (0).
+ */
+int clirun (tuple_t *N, const double *d, unsigned int nd, const char *fn,
+            const cliopt_t *opt) {
+  /* declare variables that point into the options of the method:
+   *  @pdf: pointer to the given density values.
+   *  @pre: pointer to the points already sampled.
+   *  @ppos: pointer to the term to resume from.
+   *  @perr: pointer to the output error of single precision values.
+   *  @nthr: number of threads to evaluate the density with.
+   *  @nshard: number of grid shards.
+   *  @nens: number of ensemble members.
+   *  @prec: precision of the sampled density values.
+   *  @norm: normalization of the density values of the method.
+   */
+  double **pdf, **perr;
+  tuple_t **pre;
+  unsigned long **ppos;
+  unsigned int nthr, nshard, nens;
+  pdfprec_t prec;
+  pdfnorm_t norm;
+
+  /* declare variables used to build the schedules:
+   *  @ctx: evaluation context of the density equation.
+   *  @lst: array of tuples of linear indices in each schedule.
+   *  @P: tuple of the linear indices already sampled.
+   *  @pos: quasirandom term to resume from.
+   *  @err: maximum relative error of single precision density values.
+   *  @F: density grid read from the file.
+   *  @ret: status of the sampling.
+   *  @miss: number of points that the schedules lack.
+   *  @k: schedule loop counter.
+   */
+  evalctx_t ctx;
+  tuple_t *lst, P;
+  unsigned long pos;
+  unsigned int miss, k;
+  double err;
+  pdffile_t F;
+  int ret;
+
+  /* declare variables used to cache schedules:
+   *  @C: on-disk schedule cache.
+   *  @ent: cache entry of the density grid, if it was cached.
+   *  @cuse: whether the cache is used.
+   *  @key: cache key of the schedules, or NULL if they are not cached.
+   *  @kopt: options that determine the schedules.
+   *  @hit: whether the schedules were read from the cache.
+   *  @comp: whether the density equation was compiled.
+   */
+  cache_t C;
+  cacheent_t ent;
+  char *key, kopt[80];
+  int cuse, hit, comp;
+
+  /* point into the options of the method, and build the options that
+   * determine its schedules.
+   */
+  if (opt->method == NUS_JIT) {
+    pdf = &opt->jit->pdf;
+    pre = &opt->jit->pre;
+    ppos = &opt->jit->pos;
+    perr = &opt->jit->err;
+    nthr = opt->jit->nthr;
+    nshard = opt->jit->nshard;
+    nens = opt->jit->nens;
+    prec = opt->jit->prec;
+    norm = PDF_NORM_SUM;
+    sprintf(kopt, "tile %u shard %u/%u nens %u", opt->jit->tile,
+            opt->jit->shard, nshard, nens);
+  }
+  else {
+    pdf = &opt->rej->pdf;
+    pre = &opt->rej->pre;
+    ppos = &opt->rej->pos;
+    perr = &opt->rej->err;
+    nthr = opt->rej->nthr;
+    nshard = opt->rej->nshard;
+    nens = opt->rej->nens;
+    prec = opt->rej->prec;
+    norm = PDF_NORM_MAX;
+    sprintf(kopt, "shard %u/%u nens %u", opt->rej->shard, nshard, nens);
+  }
+
+  if (prec == PDF_PREC_FLOAT)
+    strcat(kopt, " pdf float32");
+
+  /* initialize every resource of the run, so that all failures may
+   * share the same cleanup.
+   */
+  tupinit(&P);
+  lst = NULL;
+  key = NULL;
+  cuse = comp = 0;
+  ent.map = NULL;
+  F.map = NULL;
+  F.nmap = 0;
+  ret = 0;
+
+  /* read the points to extend and the term to resume from. */
+  pos = 0;
+  err = 0.0;
+  *pdf = NULL;
+  *pre = (opt->afile ? &P : NULL);
+  *ppos = (opt->rfile ? &pos : NULL);
+  *perr = &err;
+  miss = 0;
+  if (opt->method == NUS_JIT)
+    opt->jit->miss = &miss;
+
+  if (!cliread(N, opt, &P, &pos))
+    goto done;
+
+  /* allocate the schedule tuples. */
+  lst = (tuple_t*) calloc(nens * nd, sizeof(tuple_t));
+  if (!lst) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate schedule tuples\n");
+    goto done;
+  }
+
+  /* open the cache, and look up the schedules in it. extended and
+   * resumed schedules depend on more than the arguments, and are never
+   * cached, but their density grids are.
+   */
+  cuse = (opt->cuse && !opt->pfile && cacheopen(&C, opt->cdir));
+  if (cuse && !opt->afile && !opt->rfile)
+    key = cachekey(opt->name, kopt, N, d, nd, fn);
+
+  hit = (key && cachegetlst(&C, key, lst, nens * nd, tupprod(N)));
+
+  /* build the schedules if they were not cached. */
+  if (!hit) {
+    /* read the density grid from its file, or map it from the cache, if
+     * it was stored. a single shard never uses a cached grid, as it only
+     * evaluates its own values.
+     */
+    if (opt->pfile) {
+      if (!pdfload(&F, opt->pfile, N, norm, nthr))
+        goto done;
+
+      *pdf = F.pdf;
+    }
+    else if (cuse && nshard <= 1)
+      *pdf = pdfget(&C, N, fn, norm, &ent);
+
+    /* compile the density equation if the grid was not read or cached. */
+    if (!*pdf) {
+      /* initialize the julia interpreter. */
+      jl_init(JULIA_INIT_DIR);
+
+      /* compile the density equation. */
+      if (!evalinit(&ctx, fn, EVAL_PDF)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compile density equation\n");
+        goto done;
+      }
+
+      comp = 1;
+    }
+
+    /* evaluate the density grid, unless a single shard is sampled, which
+     * evaluates and keeps only its own values, or the values are sampled
+     * in single precision, which are evaluated without a double precision
+     * copy.
+     */
+    if (comp && nshard <= 1 && prec == PDF_PREC_DOUBLE) {
+      *pdf = pdfgrid(&ctx, N, norm, nthr);
+      if (!*pdf) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to evaluate density function\n");
+        goto done;
+      }
+
+      /* store the density grid in the cache. */
+      if (cuse && !pdfput(&C, N, fn, norm, *pdf))
+        fprintf(stderr, "warning: failed to cache density grid\n");
+    }
+
+    /* build the final schedule arrays. */
+    ret = (opt->method == NUS_JIT ?
+           jit(&ctx, N, d, nd, opt->jit, lst) :
+           rej(&ctx, N, d, nd, opt->rej, lst));
+
+    if (!ret) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to compute output schedule\n");
+      goto done;
+    }
+
+    /* report the error of the single precision density values. */
+    if (prec == PDF_PREC_FLOAT)
+      fprintf(stderr, "pdf-precision float32: maximum relative error "
+                      "%.3e\n", err);
+
+    /* store the schedules in the cache, unless they lack points. */
+    if (key && !miss && !cacheputlst(&C, key, lst, nens * nd))
+      fprintf(stderr, "warning: failed to cache schedules\n");
+  }
+
+  /* write the schedules. schedules that lack points are still written,
+   * but the run fails, so that a short shard is never merged unnoticed.
+   */
+  ret = cliwrite(N, opt, lst, nens, nd, pos);
+  if (ret && miss) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: schedules lack %u of the requested points\n",
+            miss);
+    ret = 0;
+  }
+
+  /* free the equation and the density grid, the cache, and the allocated
+   * tuples, and clear the pointers into them. every failure returns
+   * through here.
+   */
+done:
+  if (comp) {
+    evalfree(&ctx);
+    evalexit();
+  }
+
+  if (opt->pfile)
+    pdffree(&F);
+  else if (ent.map)
+    cacherelease(&ent);
+  else
+    pdfrelease(*pdf);
+
+  if (cuse) {
+    free(key);
+    cacheclose(&C);
+  }
+
+  for (k = 0; lst && k < nens * nd; k++)
+    tupfree(lst + k);
+
+  tupfree(&P);
+  free(lst);
+  *pdf = NULL;
+  *pre = NULL;
+  *ppos = NULL;
+  *perr = NULL;
+  if (opt->method == NUS_JIT)
+    opt->jit->miss = NULL;
+
+  /* return the status of the run. */
+  return ret;
+}
@@ -0,0 +1,83 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_CLI_H__
+#define __NUSUTILS_CLI_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* include the julia header. */
+#include <julia.h>
+
+/* include the library, tuple, sampling, evaluation, density grid and
+ * cache headers.
+ */
+#include "nus.h"
+#include "tup.h"
+#include "rej.h"
+#include "jit.h"
+#include "eval.h"
+#include "pdf.h"
+#include "cache.h"
+
+/* define the longest output file name. */
+#define CLI_PATH_MAX  4096
+
+/* cliopt_t: type definition of the options of a single run of a density
+ * sampling utility, which hold the options of the sampling method that
+ * every schedule of the run is built with.
+ */
+typedef struct {
+  /* @method: sampling method of the run, either NUS_REJ or NUS_JIT.
+   * @rej, @jit: pointer to the options of the method in use.
+   */
+  nusmethod_t method;
+  rejopt_t *rej;
+  jitopt_t *jit;
+
+  /* @name: name of the utility, which keys its cached schedules.
+   * @prefix: prefix of the numbered output file names.
+   */
+  const char *name, *prefix;
+
+  /* @afile: name of the schedule file to extend, or NULL.
+   * @rfile: name of the file holding the term to resume from, or NULL.
+   * @pfile: name of the density grid file, or NULL.
+   * @cdir: cache directory, or NULL to use the environment.
+   * @cuse: whether the cache may be used.
+   */
+  const char *afile, *rfile, *pfile, *cdir;
+  int cuse;
+}
+cliopt_t;
+
+/* function declarations: */
+
+int clirun (tuple_t *N, const double *d, unsigned int nd, const char *fn,
+            const cliopt_t *opt);
+
+#endif /* !__NUSUTILS_CLI_H__ */
@@ -23,15 +23,25 @@
 /* include the evaluation header. */
 #include "eval.h"
 
+
 /* * * * evaluation format strings * * * */
 
-/* FMT_GAP: format string for all gap equation assignments. */
+/* FMT_GAP: format string for all gap equation assignments. each context
+ * defines its functions under its own numbered names.
+ */
 #define FMT_GAP \
-  "g(x::Float64, d::Int32, O::Array, N::Array, L::Float64) = %s + 1.0;"
+  "g%u(x::Float64, d::Int32, O::Array, N::Array, L::Float64) = %s + 1.0;"
+
+/* FMT_GV: format string for evaluating the gap equation at a vector of
+ * sequence terms and scaling factors in a single call.
+ */
+#define FMT_GV \
+  "gv%u(x::Array, d::Int32, O::Array, N::Array, L::Array) = \
+   [g%u(x[i], d, O, N, L[i]) for i = 1 : length(x)]"
 
 /* FMT_PDF: format string for all density function assignments. */
 #define FMT_PDF \
-  "f(x::Array, N::Array) = %s;"
+  "f%u(x::Array, N::Array) = %s;"
 
 /* * * * preprogrammed gap equation expression strings * * * */
 
@@ -55,40 +65,214 @@
    L * sin((pi / 2) * (x + sum(O)) / sum(N)) \
      * sin((pi / 4) * N[d] * (x + sum(O)) / sum(N))^2"
 
+/* * * * type definitions * * * */
+
+/* evaljob_t: type definition of the arguments and result of a call into
+ * julia, which is made either by the calling thread or by the julia
+ * thread started by evalstart().
+ */
+typedef struct {
+  /* @E: pointer to the evaluation context of the call.
+   * @fstr: equation string to compile.
+   */
+  evalctx_t *E;
+  const char *fstr;
+
+  /* @x: array of current and next sequence terms, or of density values.
+   * @L: array of scaling factors.
+   * @d: current dimension of the Nyquist grid.
+   * @O, @N, @xt: origin, grid size and grid index tuples.
+   * @rng: array of quasirandom number generators of each sequence.
+   * @K: number of sequences.
+   * @ret: status of the call.
+   */
+  double *x, *L;
+  int d;
+  tuple_t *O, *N, *xt;
+  qrng_t **rng;
+  unsigned int K;
+  int ret;
+}
+evaljob_t;
+
 /* * * * global variables * * * */
 
-/* evaltyp: type of evaluation engine currently in use. */
-evaltype_t evaltyp;
+/* evalids: number of contexts initialized, used to name their functions. */
+static unsigned int evalids;
+
+/* evaljllock: lock that serializes every call into julia.
+ * evaljlmtx, evaljlcond: synchronization primitives of the julia thread.
+ * evaljlthr: handle of the julia thread.
+ * evaljljob, evaljlarg: pending call of the julia thread, or NULL.
+ * evaljlup: whether the julia thread is running.
+ * evaljlquit: whether the julia thread must exit.
+ */
+static pthread_mutex_t evaljllock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t evaljlmtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t evaljlcond = PTHREAD_COND_INITIALIZER;
+static pthread_t evaljlthr;
+static void (*evaljljob) (evaljob_t*);
+static evaljob_t *evaljlarg;
+static int evaljlup, evaljlquit;
+
+/* evalgapvars, evalpdfvars: variables of natively compiled equations. */
+const exprvar_t evalgapvars[] = {
+  { "x", 0 }, { "d", 0 }, { "O", 1 }, { "N", 1 }, { "L", 0 }
+};
+const exprvar_t evalpdfvars[] = {
+  { "x", 1 }, { "N", 1 }
+};
+
+/* * * * julia thread functions * * * */
+
+/* evaljlthread(): initialize julia, and make every call handed to the
+ * julia thread until it is asked to exit.
+ *
+ * arguments:
+ *  @arg: unused.
+ *
+ * returns:
+ *  NULL.
+ */
+static void *evaljlthread (void *arg) {
+  /* initialize julia on this thread, and signal that it is running. */
+  jl_init(JULIA_INIT_DIR);
+  pthread_mutex_lock(&evaljlmtx);
+  evaljlup = 1;
+  pthread_cond_broadcast(&evaljlcond);
+
+  /* make calls until asked to exit. */
+  while (1) {
+    while (!evaljljob && !evaljlquit)
+      pthread_cond_wait(&evaljlcond, &evaljlmtx);
+
+    if (evaljlquit)
+      break;
+
+    /* make the call, and signal its completion. */
+    pthread_mutex_unlock(&evaljlmtx);
+    evaljljob(evaljlarg);
+    pthread_mutex_lock(&evaljlmtx);
+    evaljljob = NULL;
+    pthread_cond_broadcast(&evaljlcond);
+  }
+
+  /* clean up the julia internals. */
+  pthread_mutex_unlock(&evaljlmtx);
+  jl_atexit_hook(0);
+  return NULL;
+}
+
+/* evalcall(): make a call into julia, one at a time. calls are handed to
+ * the julia thread if one was started, and are otherwise made from the
+ * calling thread, which must then be the thread that initialized julia.
+ *
+ * arguments:
+ *  @fn: function that makes the call.
+ *  @J: pointer to the arguments of the call.
+ */
+static void evalcall (void (*fn) (evaljob_t*), evaljob_t *J) {
+  /* serialize the calls. */
+  pthread_mutex_lock(&evaljllock);
+  if (evaljlup) {
+    /* hand the call to the julia thread, and wait for it. */
+    pthread_mutex_lock(&evaljlmtx);
+    evaljljob = fn;
+    evaljlarg = J;
+    pthread_cond_broadcast(&evaljlcond);
+    while (evaljljob)
+      pthread_cond_wait(&evaljlcond, &evaljlmtx);
+
+    pthread_mutex_unlock(&evaljlmtx);
+  }
+  else {
+    /* make the call directly. */
+    fn(J);
+  }
+
+  pthread_mutex_unlock(&evaljllock);
+}
+
+/* evalstart(): initialize julia on a dedicated thread, which makes the
+ * calls of every context from then on. this permits schedules to be built
+ * from any thread of a program that embeds the library.
+ *
+ * returns:
+ *  integer indicating whether the thread was started (1) or not (0).
+ */
+int evalstart (void) {
+  /* declare required variables:
+   *  @ret: whether the thread is running.
+   */
+  int ret = 1;
+
+  /* start the thread once, and wait for it to initialize julia. */
+  pthread_mutex_lock(&evaljllock);
+  if (!evaljlup) {
+    evaljlquit = 0;
+    if (pthread_create(&evaljlthr, NULL, evaljlthread, NULL)) {
+      ret = 0;
+    }
+    else {
+      pthread_mutex_lock(&evaljlmtx);
+      while (!evaljlup)
+        pthread_cond_wait(&evaljlcond, &evaljlmtx);
+
+      pthread_mutex_unlock(&evaljlmtx);
+    }
+  }
+
+  /* return the status of the thread. */
+  pthread_mutex_unlock(&evaljllock);
+  return ret;
+}
 
-/* evalfn: julia function handle that holds the compiled equation. */
-jl_function_t *evalfn;
+/* evalexit(): allow the julia environment to free its internals, after
+ * every context has been freed. the julia thread is stopped, if one was
+ * started.
+ */
+void evalexit (void) {
+  /* check whether a julia thread is running. */
+  pthread_mutex_lock(&evaljllock);
+  if (evaljlup) {
+    /* stop the julia thread, which cleans up the julia internals. */
+    pthread_mutex_lock(&evaljlmtx);
+    evaljlquit = 1;
+    pthread_cond_broadcast(&evaljlcond);
+    pthread_mutex_unlock(&evaljlmtx);
+    pthread_join(evaljlthr, NULL);
+    evaljlup = 0;
+  }
+  else {
+    /* clean up the julia internals from the calling thread. */
+    jl_atexit_hook(0);
+  }
 
-/* evalrng: quasirandom number generator for poisson-distributed terms. */
-qrng_t evalrng;
+  pthread_mutex_unlock(&evaljllock);
+}
 
 /* * * * function definitions * * * */
 
-/* evalinit_gap(): gap-specific initialization function.
+/* evalinit_gap(): gap-specific julia compilation function.
  * see evalinit() for more details.
  */
-int evalinit_gap (const char *fstr) {
+static void evalinit_gap (evaljob_t *J) {
   /* declare required variables:
    *  @stmt: gap equation assignment statement string.
    *  @nstmt: number of characters in the statement string.
+   *  @name: name of a compiled function.
    */
-  char *stmt;
+  char *stmt, name[32];
   int nstmt;
 
   /* allocate a function string to evaluate. */
-  nstmt = strlen(fstr) + strlen(FMT_GAP) + 32;
+  nstmt = strlen(J->fstr) + strlen(FMT_GAP) + strlen(FMT_GV) + 64;
   stmt = (char*) malloc(nstmt * sizeof(char));
 
   /* check that the string was evaluated. */
+  J->ret = EVAL_ERR;
   if (!stmt)
-    return EVAL_ERR;
-
-  /* build the function assignment string. */
-  snprintf(stmt, nstmt, FMT_GAP, fstr);
+    return;
 
   /* evaluate preprogrammed function definitions. */
   (void) jl_eval_string(EXPR_POISRND);
@@ -96,104 +280,171 @@ int evalinit_gap (const char *fstr) {
   (void) jl_eval_string(EXPR_SG);
   (void) jl_eval_string(EXPR_SB);
 
-  /* evaluate the function assignment. */
+  /* evaluate the function assignment and its vectorized form. */
+  snprintf(stmt, nstmt, FMT_GAP, J->E->id, J->fstr);
+  (void) jl_eval_string(stmt);
+  snprintf(stmt, nstmt, FMT_GV, J->E->id, J->E->id);
   (void) jl_eval_string(stmt);
   free(stmt);
 
   /* check that the evaluation succeeded. */
   if (jl_exception_occurred())
-    return EVAL_ERR;
+    return;
 
-  /* get the compiled function handle. */
-  evalfn = jl_get_function(jl_current_module, "g");
+  /* get the compiled function handles. */
+  snprintf(name, 32, "g%u", J->E->id);
+  J->E->fn = jl_get_function(jl_current_module, name);
+  snprintf(name, 32, "gv%u", J->E->id);
+  J->E->fnv = jl_get_function(jl_current_module, name);
 
   /* return success. */
-  return EVAL_OK;
+  J->ret = EVAL_OK;
 }
 
-/* evalinit_pdf(): density-specific initialization function.
+/* evalinit_pdf(): density-specific julia compilation function.
  * see evalinit() for more details.
  */
-int evalinit_pdf (const char *fstr) {
+static void evalinit_pdf (evaljob_t *J) {
   /* declare required variables:
    *  @stmt: gap equation assignment statement string.
    *  @nstmt: number of characters in the statement string.
+   *  @name: name of the compiled function.
    */
-  char *stmt;
+  char *stmt, name[32];
   int nstmt;
 
   /* allocate a function string to evaluate. */
-  nstmt = strlen(fstr) + strlen(FMT_PDF) + 32;
+  nstmt = strlen(J->fstr) + strlen(FMT_PDF) + 32;
   stmt = (char*) malloc(nstmt * sizeof(char));
 
   /* check that the string was evaluated. */
+  J->ret = EVAL_ERR;
   if (!stmt)
-    return EVAL_ERR;
-
-  /* build the function assignment string. */
-  snprintf(stmt, nstmt, FMT_PDF, fstr);
+    return;
 
-  /* evaluate the function assignment. */
+  /* build and evaluate the function assignment. */
+  snprintf(stmt, nstmt, FMT_PDF, J->E->id, J->fstr);
   (void) jl_eval_string(stmt);
   free(stmt);
 
   /* check that the evaluation succeeded. */
   if (jl_exception_occurred())
-    return EVAL_ERR;
+    return;
 
   /* get the compiled function handle. */
-  evalfn = jl_get_function(jl_current_module, "f");
+  snprintf(name, 32, "f%u", J->E->id);
+  J->E->fn = jl_get_function(jl_current_module, name);
+  J->E->fnv = NULL;
 
   /* return success. */
-  return EVAL_OK;
+  J->ret = EVAL_OK;
 }
 
-/* evalinit(): initialize the equation evaluation engine.
+/* evalinit(): initialize an evaluation context by compiling an equation.
+ * a context may be used to build any number of schedules.
  *
  * arguments:
+ *  @E: pointer to the context to initialize.
  *  @fstr: julia function string to compile and call.
  *  @ftype: evaluation engine type: gap or pdf.
  *
  * returns:
  *  integer indicating whether initialization succeeded.
  */
-int evalinit (const char *fstr, evaltype_t ftype) {
-  /* allocate the quasirandom number generator. */
-  if (!qrngalloc(&evalrng, 1))
+int evalinit (evalctx_t *E, const char *fstr, evaltype_t ftype) {
+  /* declare required variables:
+   *  @J: arguments of the julia compilation call.
+   */
+  evaljob_t J;
+
+  /* initialize the context, such that evalfree() may always be called. */
+  memset(E, 0, sizeof(evalctx_t));
+  E->type = ftype;
+  E->id = __atomic_fetch_add(&evalids, 1, __ATOMIC_RELAXED);
+
+  /* store the equation string. */
+  E->str = (char*) malloc(strlen(fstr) + 1);
+  if (!E->str)
     return EVAL_ERR;
 
-  /* iterate the qrng just once to avoid returning zero. */
-  qrngeval(&evalrng);
+  strcpy(E->str, fstr);
 
-  /* determine the type of evaluation engine to initialize. */
+  /* compile the julia form of the equation. */
+  J.E = E;
+  J.fstr = fstr;
   switch (ftype) {
     /* gap equation. */
     case EVAL_GAP:
-      return evalinit_gap(fstr);
+      evalcall(evalinit_gap, &J);
+      E->expr = exprcompile(fstr, evalgapvars, 5);
+      break;
 
     /* density function. */
     case EVAL_PDF:
-      return evalinit_pdf(fstr);
+      evalcall(evalinit_pdf, &J);
+      E->expr = exprcompile(fstr, evalpdfvars, 2);
+      break;
 
     /* otherwise. */
     default:
       return EVAL_ERR;
   }
 
-  /* return failure: unknown engine type and failed switch? */
-  return EVAL_ERR;
+  /* return the status of the compilation. */
+  return J.ret;
 }
 
-/* evalfree(): called to destroy the equation evaluation engine. this
- * allows the julia environment to free its internals and frees any
- * extra allocated memory.
+/* evalfree(): free the compiled equation of an evaluation context. the
+ * julia functions of the context are left to the julia environment.
+ *
+ * arguments:
+ *  @E: pointer to the context to free.
  */
-void evalfree (void) {
-  /* free the quasirandom number generator. */
-  qrngfree(&evalrng);
+void evalfree (evalctx_t *E) {
+  /* ensure the pointer is valid. */
+  if (!E)
+    return;
+
+  /* free the native equation. */
+  exprfree(E->expr);
+  E->expr = NULL;
+
+  /* free the equation string. */
+  free(E->str);
+  E->str = NULL;
+}
 
-  /* clean up the julia internals. */
-  jl_atexit_hook(0);
+/* evalnative(): determine whether the equation of a context is evaluated
+ * natively, in which case evalgapv() and evalpdf() may be called on the
+ * context from several threads at once.
+ *
+ * arguments:
+ *  @E: pointer to the context to query.
+ *
+ * returns:
+ *  integer indicating whether native evaluation is in use.
+ */
+int evalnative (evalctx_t *E) {
+  /* return whether a native program was compiled. */
+  return (E->expr != NULL);
+}
+
+/* evalargs(): fill a native argument value from a tuple.
+ *
+ * arguments:
+ *  @v: pointer to the output value.
+ *  @t: pointer to the tuple to convert.
+ */
+static void evalargs (exprval_t *v, tuple_t *t) {
+  /* declare required variables:
+   *  @i: element index.
+   */
+  int i;
+
+  /* copy the tuple elements, flagging oversized tuples. */
+  v->n = tupsize(t);
+  for (i = 0; i < tupsize(t) && i < EXPR_MAX_DIMS; i++)
+    v->v[i] = (double) tupget(t, i);
 }
 
 /* evalpois(): return a quasirandomly poisson-distributed value,
@@ -201,11 +452,12 @@ void evalfree (void) {
  *
  * arguments:
  *  @lambda: negative of the input rate parameter.
+ *  @g: pointer to the quasirandom number generator to draw from.
  *
  * returns:
  *  floating point value of the result.
  */
-double evalpois (double lambda) {
+double evalpois (double lambda, qrng_t *g) {
   /* declare required variables:
    *  @L: exponentiated negated rate.
    *  @k: final poisson variate.
@@ -220,10 +472,10 @@ double evalpois (double lambda) {
   /* loop until the final iterate is reached. */
   do {
     /* compute a new iterate within the qrng. */
-    qrngeval(&evalrng);
+    qrngeval(g);
 
     /* update the intermediate values. */
-    p *= evalrng.x[0];
+    p *= g->x[0];
     k += 1.0;
   }
   while (p >= L);
@@ -232,149 +484,225 @@ double evalpois (double lambda) {
   return k;
 }
 
-/* evalgap(): compute the next term in the deterministic gap sequence
- * given the current value and the sequence parameters.
- *
- * arguments:
- *  @x: pointer to the current and next sequence term.
- *  @d: current dimension of the Nyquist grid.
- *  @O: current offset position in the Nyquist grid.
- *  @N: total size of the Nyquist grid.
- *  @L: scaling factor for sequence terms.
- *
- * returns:
- *  integer indicating whether the sequence is well-behaved (1) (i.e. whether
- *  the scaling factor is in bounds) or not (0).
+/* evalgapv_jl(): call the vectorized gap equation of a context.
+ * see evalgapv() for more details.
  */
-int evalgap (double *x, int d, tuple_t *O, tuple_t *N, double L) {
+static void evalgapv_jl (evaljob_t *J) {
   /* declare required variables:
    *  @i: general array index and loop counter.
-   *  @ret: return status value for this function.
-   *  @theta: sequence term angular value.
    *  @gx: unboxed gap equation result.
    */
-  int i, ret = EVAL_OK;
-  double theta, gx;
+  double gx;
+  int i;
 
   /* declare required julia variables:
-   *  @gval: boxed return value of the gap method call.
+   *  @dval: boxed dimension argument of the gap method call.
+   *  @gval: returned array of the gap method call.
    *  @args: array of value pointers passed to the gap method.
    *  @arrtype: data type of the arrays passed to the gap method.
-   *  @arro, @arrn: arrays passed to the gap method.
-   *  @dato, @datn: array data pointers.
+   *  @arrx, @arro, @arrn, @arrl: arrays passed to the gap method.
+   *  @datx, @dato, @datn, @datl, @datg: array data pointers.
    */
-  jl_value_t *xval, *dval, *Lval, *gval;
+  jl_value_t *dval, *gval;
   jl_value_t **args;
   jl_value_t *arrtype;
-  jl_array_t *arro, *arrn;
-  double *dato, *datn;
-
-  /* compute the angular term value. */
-  theta = (*x + tupsum(O)) / tupsum(N);
-
-  /* determine whether the angular term is in bounds.
-   *
-   * this check is to ensure that the value of the provided scaling
-   * factor generates a well-behaved sequence. poorly behaved
-   * sequences having large scaling factors must be identified
-   * in order to assign large errors to their parameters and
-   * thus ensure simplex optimization succeeds.
-   */
-  if (theta > 1.0)
-    ret = EVAL_INVALID;
+  jl_array_t *arrx, *arro, *arrn, *arrl;
+  double *datx, *dato, *datn, *datl, *datg;
 
-  /* box up the scalar arguments. */
-  xval = jl_box_float64(*x);
-  dval = jl_box_int32(d + 1);
-  Lval = jl_box_float64(L);
+  /* box up the scalar argument. */
+  dval = jl_box_int32(J->d + 1);
 
   /* initialize the array data type. */
   arrtype = jl_apply_array_type(jl_float64_type, 1);
 
-  /* allocate the origin and size arrays. */
-  arro = jl_alloc_array_1d(arrtype, tupsize(O));
-  arrn = jl_alloc_array_1d(arrtype, tupsize(N));
+  /* allocate the term, origin, size and scaling factor arrays. */
+  arrx = jl_alloc_array_1d(arrtype, J->K);
+  arro = jl_alloc_array_1d(arrtype, tupsize(J->O));
+  arrn = jl_alloc_array_1d(arrtype, tupsize(J->N));
+  arrl = jl_alloc_array_1d(arrtype, J->K);
 
-  /* access the origin and size array data pointers. */
+  /* access the array data pointers. */
+  datx = (double*) jl_array_data(arrx);
   dato = (double*) jl_array_data(arro);
   datn = (double*) jl_array_data(arrn);
+  datl = (double*) jl_array_data(arrl);
 
   /* fill the origin and size arrays. */
-  for (i = 0; i < tupsize(O); i++) {
-    dato[i] = (double) tupget(O, i);
-    datn[i] = (double) tupget(N, i);
+  for (i = 0; i < tupsize(J->O); i++) {
+    dato[i] = (double) tupget(J->O, i);
+    datn[i] = (double) tupget(J->N, i);
+  }
+
+  /* fill the term and scaling factor arrays. */
+  for (i = 0; i < (int) J->K; i++) {
+    datx[i] = J->x[i];
+    datl[i] = J->L[i];
   }
 
   /* initialize the argument array. */
   JL_GC_PUSHARGS(args, 5);
 
   /* construct an argument array for the gap method call. */
-  args[0] = xval;
+  args[0] = (jl_value_t*) arrx;
   args[1] = dval;
   args[2] = (jl_value_t*) arro;
   args[3] = (jl_value_t*) arrn;
-  args[4] = Lval;
+  args[4] = (jl_value_t*) arrl;
 
-  /* call the gap equation with the current arguments. */
-  gval = jl_call(evalfn, args, 5);
+  /* call the vectorized gap equation with the current arguments. */
+  gval = jl_call(J->E->fnv, args, 5);
 
   /* check if an exception occurred. */
   if (jl_exception_occurred()) {
     /* output an error. */
-    fprintf(stderr, "error: g(%.3lf, %d, [%u.0",
-      *x, d, tupget(O, 0));
-    for (i = 1; i < tupsize(O); i++)
-      fprintf(stderr, ", %u.0", tupget(O, i));
-    fprintf(stderr, "], [%u.0", tupget(N, 0));
-    for (i = 1; i < tupsize(N); i++)
-      fprintf(stderr, ", %u.0", tupget(N, i));
-    fprintf(stderr, "], %.3lf) ==> %s\n", L,
+    fprintf(stderr, "error: gv([%.3lf", J->x[0]);
+    for (i = 1; i < (int) J->K; i++)
+      fprintf(stderr, ", %.3lf", J->x[i]);
+    fprintf(stderr, "], %d, [%u.0", J->d, tupget(J->O, 0));
+    for (i = 1; i < tupsize(J->O); i++)
+      fprintf(stderr, ", %u.0", tupget(J->O, i));
+    fprintf(stderr, "], [%u.0", tupget(J->N, 0));
+    for (i = 1; i < tupsize(J->N); i++)
+      fprintf(stderr, ", %u.0", tupget(J->N, i));
+    fprintf(stderr, "], [%.3lf", J->L[0]);
+    for (i = 1; i < (int) J->K; i++)
+      fprintf(stderr, ", %.3lf", J->L[i]);
+    fprintf(stderr, "]) ==> %s\n",
       jl_typeof_str(jl_exception_occurred()));
 
     /* force the error to be printed. */
     fflush(stderr);
 
     /* return an exception status. */
-    ret = EVAL_EXCEPTION;
+    J->ret = EVAL_EXCEPTION;
   }
   else {
-    /* unbox the computed result. */
-    gx = jl_unbox_float64(gval);
-
-    /* check the sign of the result. */
-    if (gx >= 0.0) {
-      /* perform a deterministic update. */
-      *x += gx;
-    }
-    else {
-      /* perform a quasi-random update. */
-      *x += evalpois(gx + 1.0);
+    /* access the computed results. */
+    datg = (double*) jl_array_data(gval);
+
+    /* update each sequence term. */
+    for (i = 0; i < (int) J->K; i++) {
+      /* reject results that are not finite, which would never end the
+       * quasi-random update.
+       */
+      gx = datg[i];
+      if (!isfinite(gx)) {
+        fprintf(stderr, "error: gv(..., %d, ...) ==> non-finite result\n",
+                J->d + 1);
+        J->ret = EVAL_EXCEPTION;
+        break;
+      }
+
+      /* check the sign of the result. */
+      if (gx >= 0.0) {
+        /* perform a deterministic update. */
+        J->x[i] += gx;
+      }
+      else {
+        /* perform a quasi-random update. */
+        J->x[i] += evalpois(gx + 1.0, J->rng[i]);
+      }
     }
   }
 
   /* release the references to the function arguments. */
   JL_GC_POP();
-
-  /* return the well-behaved flag. */
-  return ret;
 }
 
-/* evalpdf(): compute the density function at a given grid point.
+/* evalgapv(): compute the next terms of several deterministic gap
+ * sequences along the same line, each having its own scaling factor,
+ * using a single call of the gap equation.
  *
  * arguments:
- *  @fx: pointer to the output density value.
- *  @x: pointer to the current grid index.
+ *  @E: pointer to the evaluation context of the gap equation.
+ *  @x: array of current and next sequence terms.
+ *  @d: current dimension of the Nyquist grid.
+ *  @O: current offset position in the Nyquist grid.
  *  @N: total size of the Nyquist grid.
+ *  @L: array of scaling factors for sequence terms.
+ *  @rng: array of quasirandom number generators for poisson-distributed
+ *        terms of each sequence.
+ *  @st: array of output flags indicating whether each sequence is
+ *       well-behaved (1) or not (EVAL_INVALID).
+ *  @K: number of sequences.
  *
  * returns:
- *  integer indicating whether evaluation succeeded (1) or not (0).
+ *  integer indicating whether evaluation succeeded (1) or not.
  */
-int evalpdf (double *fx, tuple_t *x, tuple_t *N) {
+int evalgapv (evalctx_t *E, double *x, int d, tuple_t *O, tuple_t *N,
+              double *L, qrng_t **rng, int *st, unsigned int K) {
+  /* declare required variables:
+   *  @i: general array index and loop counter.
+   *  @gx: unboxed gap equation result.
+   *  @J: arguments of the julia call.
+   */
+  evaljob_t J;
+  double gx;
+  int i;
+
+  /* declare required native variables:
+   *  @nat: array of native argument values.
+   */
+  exprval_t nat[5];
+
+  /* determine whether the angular terms are in bounds. */
+  for (i = 0; i < (int) K; i++)
+    st[i] = ((x[i] + tupsum(O)) / tupsum(N) > 1.0 ? EVAL_INVALID : EVAL_OK);
+
+  /* evaluate natively when possible. */
+  if (E->expr) {
+    /* build the shared arguments. */
+    nat[1].n = 0;
+    nat[1].v[0] = (double) (d + 1);
+    evalargs(nat + 2, O);
+    evalargs(nat + 3, N);
+
+    /* update each sequence term. */
+    for (i = 0; i < (int) K; i++) {
+      /* build the remaining arguments. */
+      nat[0].n = nat[4].n = 0;
+      nat[0].v[0] = x[i];
+      nat[4].v[0] = L[i];
+
+      /* evaluate the gap equation. */
+      if (!expreval(E->expr, nat, &gx)) {
+        fprintf(stderr, "error: g(%.3lf, %d, ...) ==> EvaluationError\n",
+                x[i], d + 1);
+        return EVAL_EXCEPTION;
+      }
+
+      /* perform a deterministic or quasi-random update. */
+      gx += 1.0;
+      x[i] += (gx >= 0.0 ? gx : evalpois(gx + 1.0, rng[i]));
+    }
+
+    return EVAL_OK;
+  }
+
+  /* call the vectorized gap equation. */
+  J.E = E;
+  J.x = x;
+  J.L = L;
+  J.d = d;
+  J.O = O;
+  J.N = N;
+  J.rng = rng;
+  J.K = K;
+  J.ret = EVAL_OK;
+  evalcall(evalgapv_jl, &J);
+
+  /* return the evaluation status. */
+  return J.ret;
+}
+
+/* evalpdf_jl(): call the density function of a context.
+ * see evalpdf() for more details.
+ */
+static void evalpdf_jl (evaljob_t *J) {
   /* declare required variables:
    *  @i: general array index and loop counter.
-   *  @ret: return status value for this function.
    */
-  int i, ret = EVAL_OK;
+  int i;
 
   /* declare required julia variables:
    *  @boxfval: boxed return value of the method call.
@@ -393,17 +721,17 @@ int evalpdf (double *fx, tuple_t *x, tuple_t *N) {
   arrtype = jl_apply_array_type(jl_float64_type, 1);
 
   /* allocate the origin and size arrays. */
-  arrx = jl_alloc_array_1d(arrtype, tupsize(x));
-  arrn = jl_alloc_array_1d(arrtype, tupsize(N));
+  arrx = jl_alloc_array_1d(arrtype, tupsize(J->xt));
+  arrn = jl_alloc_array_1d(arrtype, tupsize(J->N));
 
   /* access the origin and size array data pointers. */
   datx = (double*) jl_array_data(arrx);
   datn = (double*) jl_array_data(arrn);
 
   /* fill the origin and size arrays. */
-  for (i = 0; i < tupsize(x); i++) {
-    datx[i] = (double) tupget(x, i);
-    datn[i] = (double) tupget(N, i);
+  for (i = 0; i < tupsize(J->xt); i++) {
+    datx[i] = (double) tupget(J->xt, i);
+    datn[i] = (double) tupget(J->N, i);
   }
 
   /* initialize the argument array. */
@@ -414,18 +742,18 @@ int evalpdf (double *fx, tuple_t *x, tuple_t *N) {
   args[1] = (jl_value_t*) arrn;
 
   /* call the gap equation with the current arguments. */
-  boxfval = jl_call(evalfn, args, 2);
+  boxfval = jl_call(J->E->fn, args, 2);
 
   /* check if an exception occurred. */
   if (jl_exception_occurred()) {
     /* output an error. */
     fprintf(stderr, "error: f([%u.0",
-      tupget(x, 0));
-    for (i = 1; i < tupsize(x); i++)
-      fprintf(stderr, ", %u.0", tupget(x, i));
-    fprintf(stderr, "], [%u.0", tupget(N, 0));
-    for (i = 1; i < tupsize(N); i++)
-      fprintf(stderr, ", %u.0", tupget(N, i));
+      tupget(J->xt, 0));
+    for (i = 1; i < tupsize(J->xt); i++)
+      fprintf(stderr, ", %u.0", tupget(J->xt, i));
+    fprintf(stderr, "], [%u.0", tupget(J->N, 0));
+    for (i = 1; i < tupsize(J->N); i++)
+      fprintf(stderr, ", %u.0", tupget(J->N, i));
     fprintf(stderr, "]) ==> %s\n",
       jl_typeof_str(jl_exception_occurred()));
 
@@ -433,19 +761,65 @@ int evalpdf (double *fx, tuple_t *x, tuple_t *N) {
     fflush(stderr);
 
     /* zero the computed result. */
-    *fx = 0.0;
+    *J->x = 0.0;
 
     /* return an exception status. */
-    ret = EVAL_EXCEPTION;
+    J->ret = EVAL_EXCEPTION;
   }
   else {
     /* unbox the computed result. */
-    *fx = jl_unbox_float64(boxfval);
+    *J->x = jl_unbox_float64(boxfval);
   }
 
   /* release the references to the function arguments. */
   JL_GC_POP();
+}
+
+/* evalpdf(): compute the density function at a given grid point.
+ *
+ * arguments:
+ *  @E: pointer to the evaluation context of the density function.
+ *  @fx: pointer to the output density value.
+ *  @x: pointer to the current grid index.
+ *  @N: total size of the Nyquist grid.
+ *
+ * returns:
+ *  integer indicating whether evaluation succeeded (1) or not (0).
+ */
+int evalpdf (evalctx_t *E, double *fx, tuple_t *x, tuple_t *N) {
+  /* declare required variables:
+   *  @J: arguments of the julia call.
+   */
+  evaljob_t J;
+
+  /* declare required native variables:
+   *  @nat: array of native argument values.
+   */
+  exprval_t nat[2];
+
+  /* evaluate natively when possible. */
+  if (E->expr) {
+    /* build the arguments and evaluate the density function. */
+    evalargs(nat, x);
+    evalargs(nat + 1, N);
+    if (!expreval(E->expr, nat, fx)) {
+      fprintf(stderr, "error: f([%u.0, ...]) ==> EvaluationError\n",
+              tupget(x, 0));
+      *fx = 0.0;
+      return EVAL_EXCEPTION;
+    }
+
+    return EVAL_OK;
+  }
+
+  /* call the density function. */
+  J.E = E;
+  J.x = fx;
+  J.xt = x;
+  J.N = N;
+  J.ret = EVAL_OK;
+  evalcall(evalpdf_jl, &J);
 
   /* return the evaluation status. */
-  return ret;
+  return J.ret;
 }
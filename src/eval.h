@@ -27,14 +27,19 @@
 /* include standard c library headers. */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+/* include the posix threads header. */
+#include <pthread.h>
+
 /* include the julia library header. */
 #include <julia.h>
 
-/* include the tuple and qrng headers. */
+/* include the tuple, qrng and native expression headers. */
 #include "tup.h"
 #include "qrng.h"
+#include "expr.h"
 
 /* define required function return values:
  *  EVAL_OK: indicates success.
@@ -58,15 +63,50 @@ typedef enum {
 }
 evaltype_t;
 
+/* evalctx_t: type definition of an evaluation context, which holds a
+ * single compiled equation. contexts are independent of each other, and
+ * natively compiled contexts may be evaluated from several threads at
+ * once. calls into julia are made one at a time by all contexts.
+ */
+typedef struct evalctx {
+  /* @type: kind of equation held by the context.
+   * @str: string of the compiled equation.
+   * @id: number that names the julia functions of the context.
+   */
+  evaltype_t type;
+  char *str;
+  unsigned int id;
+
+  /* @fn: julia function handle that holds the compiled equation.
+   * @fnv: julia function handle that maps the gap equation over vectors.
+   */
+  jl_function_t *fn;
+  jl_function_t *fnv;
+
+  /* @expr: natively compiled form of the equation, if its expression
+   *        lies within the subset of julia syntax supported by
+   *        exprcompile(), or NULL.
+   */
+  expr_t *expr;
+}
+evalctx_t;
+
 /* function declarations: */
 
-int evalinit (const char *fstr, evaltype_t ftype);
+int evalstart (void);
+
+void evalexit (void);
+
+int evalinit (evalctx_t *E, const char *fstr, evaltype_t ftype);
+
+void evalfree (evalctx_t *E);
 
-void evalfree (void);
+int evalnative (evalctx_t *E);
 
-int evalgap (double *x, int d, tuple_t *O, tuple_t *N, double L);
+int evalgapv (evalctx_t *E, double *x, int d, tuple_t *O, tuple_t *N,
+              double *L, qrng_t **rng, int *st, unsigned int K);
 
-int evalpdf (double *fx, tuple_t *x, tuple_t *N);
+int evalpdf (evalctx_t *E, double *fx, tuple_t *x, tuple_t *N);
 
 #endif /* !__NUSUTILS_EVAL_H__ */
 
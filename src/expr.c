@@ -0,0 +1,874 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the native expression header. */
+#include "expr.h"
+
+/* define the operation codes of compiled expression programs. */
+enum {
+  EXPR_NUM = 0,  /* push a constant.                   */
+  EXPR_VAR,      /* push a variable.                   */
+  EXPR_NEG,      /* negate the top value.              */
+  EXPR_ADD,      /* elementwise binary operations.     */
+  EXPR_SUB,
+  EXPR_MUL,
+  EXPR_DIV,
+  EXPR_POW,
+  EXPR_LT,       /* elementwise comparisons.           */
+  EXPR_LE,
+  EXPR_GT,
+  EXPR_GE,
+  EXPR_EQ,
+  EXPR_NE,
+  EXPR_IDX,      /* one-based vector indexing.         */
+  EXPR_FN1,      /* elementwise single-argument call.  */
+  EXPR_FN2,      /* elementwise two-argument call.     */
+  EXPR_SUM,      /* vector reductions.                 */
+  EXPR_PROD,
+  EXPR_LEN,
+  EXPR_JZ,       /* jump if the top value is zero.     */
+  EXPR_JMP,      /* unconditional jump.                */
+  EXPR_POIS,     /* preprogrammed functions.           */
+  EXPR_SG,
+  EXPR_SB,
+  EXPR_PG
+};
+
+/* exprmod(): floored modulus, matching julia's mod() function. */
+static double exprmod (double a, double b) {
+  return a - floor(a / b) * b;
+}
+
+/* exprfn1: table of natively supported single-argument functions, and
+ * the domain of their arguments. julia raises a domain error for any
+ * argument outside of it, so native evaluation fails instead.
+ */
+static const struct {
+  const char *name;
+  double (*fn) (double);
+  double lo, hi;
+}
+exprfn1[] = {
+  { "sin",   sin,   -INFINITY, INFINITY },
+  { "cos",   cos,   -INFINITY, INFINITY },
+  { "tan",   tan,   -INFINITY, INFINITY },
+  { "asin",  asin,  -1.0,      1.0      },
+  { "acos",  acos,  -1.0,      1.0      },
+  { "atan",  atan,  -INFINITY, INFINITY },
+  { "sinh",  sinh,  -INFINITY, INFINITY },
+  { "cosh",  cosh,  -INFINITY, INFINITY },
+  { "tanh",  tanh,  -INFINITY, INFINITY },
+  { "exp",   exp,   -INFINITY, INFINITY },
+  { "log",   log,   0.0,       INFINITY },
+  { "log2",  log2,  0.0,       INFINITY },
+  { "log10", log10, 0.0,       INFINITY },
+  { "sqrt",  sqrt,  0.0,       INFINITY },
+  { "abs",   fabs,  -INFINITY, INFINITY },
+  { "floor", floor, -INFINITY, INFINITY },
+  { "ceil",  ceil,  -INFINITY, INFINITY },
+  { "round", rint,  -INFINITY, INFINITY },
+  { NULL, NULL, 0.0, 0.0 }
+};
+
+/* exprfn2: table of natively supported two-argument functions. */
+static const struct {
+  const char *name;
+  double (*fn) (double, double);
+}
+exprfn2[] = {
+  { "min",  fmin    }, { "max",  fmax    },
+  { "atan", atan2   }, { "mod",  exprmod },
+  { NULL, NULL }
+};
+
+/* exprparse_t: structure that holds the state of the expression
+ * compiler while it descends through an expression string.
+ */
+typedef struct {
+  /* @s: expression string being compiled.
+   * @e: program being emitted.
+   * @cap: number of allocated program instructions.
+   * @vars: array of accepted variables.
+   * @nvar: number of accepted variables.
+   * @depth: current depth of the evaluation stack.
+   * @vec: whether each value on the evaluation stack is a vector.
+   * @ok: whether compilation has succeeded so far.
+   */
+  const char *s;
+  expr_t *e;
+  unsigned int cap;
+  const exprvar_t *vars;
+  unsigned int nvar;
+  int depth;
+  unsigned char vec[EXPR_MAX_STACK];
+  int ok;
+}
+exprparse_t;
+
+/* function declarations of the recursive descent parser: */
+static void exprternary (exprparse_t *p);
+static void exprunary (exprparse_t *p);
+
+/* exprspace(): skip whitespace in the expression string. */
+static void exprspace (exprparse_t *p) {
+  while (*p->s == ' ' || *p->s == '\t' || *p->s == '\n' || *p->s == '\r')
+    p->s++;
+}
+
+/* exprmatch(): consume a token from the expression string, if present.
+ *
+ * arguments:
+ *  @p: pointer to the compiler state.
+ *  @tok: token string to match after any whitespace.
+ *
+ * returns:
+ *  integer indicating whether the token was consumed (1) or not (0).
+ */
+static int exprmatch (exprparse_t *p, const char *tok) {
+  exprspace(p);
+  if (strncmp(p->s, tok, strlen(tok)) != 0)
+    return 0;
+
+  p->s += strlen(tok);
+  return 1;
+}
+
+/* exprdot(): consume an optional broadcasting dot before one of a set of
+ * operator characters, leaving the operator itself in the string.
+ *
+ * arguments:
+ *  @p: pointer to the compiler state.
+ *  @ops: string of operator characters that may follow the dot.
+ *
+ * returns:
+ *  the operator character that follows, or zero.
+ */
+static char exprdot (exprparse_t *p, const char *ops) {
+  exprspace(p);
+  if (p->s[0] == '.' && p->s[1] && strchr(ops, p->s[1]))
+    p->s++;
+
+  return (*p->s && strchr(ops, *p->s) ? *p->s : 0);
+}
+
+/* expremit(): append an instruction to the program being compiled.
+ *
+ * arguments:
+ *  @p: pointer to the compiler state.
+ *  @op: operation code of the instruction.
+ *  @arg: integer argument of the instruction.
+ *  @val: constant argument of the instruction.
+ *  @dd: change in evaluation stack depth caused by the instruction.
+ */
+static void expremit (exprparse_t *p, int op, int arg, double val, int dd) {
+  /* declare required variables:
+   *  @ops: reallocated instruction array.
+   *  @v: whether the result of the instruction is a vector.
+   *  @d: stack depth before the instruction.
+   */
+  exprop_t *ops;
+  int v, d;
+
+  /* do nothing once compilation has failed. */
+  if (!p->ok)
+    return;
+
+  /* grow the instruction array as needed. */
+  if (p->e->n >= p->cap) {
+    ops = (exprop_t*) realloc(p->e->ops, 2 * (p->cap + 8) * sizeof(exprop_t));
+    if (!ops) {
+      p->ok = 0;
+      return;
+    }
+
+    p->e->ops = ops;
+    p->cap = 2 * (p->cap + 8);
+  }
+
+  /* store the instruction. */
+  p->e->ops[p->e->n].op = op;
+  p->e->ops[p->e->n].arg = arg;
+  p->e->ops[p->e->n].val = val;
+  p->e->n++;
+
+  /* determine whether the result is a vector. elementwise operations
+   * broadcast their operands, and every other result is a scalar.
+   */
+  d = p->depth;
+  switch (op) {
+    case EXPR_VAR:
+      v = p->vars[arg].vec;
+      break;
+
+    case EXPR_NEG: case EXPR_FN1: case EXPR_POIS:
+      v = (d >= 1 && p->vec[d - 1]);
+      break;
+
+    case EXPR_ADD: case EXPR_SUB: case EXPR_MUL: case EXPR_DIV:
+    case EXPR_POW: case EXPR_LT:  case EXPR_LE:  case EXPR_GT:
+    case EXPR_GE:  case EXPR_EQ:  case EXPR_NE:  case EXPR_FN2:
+      v = (d >= 2 && (p->vec[d - 2] || p->vec[d - 1]));
+      break;
+
+    default:
+      v = 0;
+  }
+
+  /* track the stack depth, failing on overflow. */
+  p->depth += dd;
+  if (p->depth > EXPR_MAX_STACK || p->depth < 0) {
+    p->ok = 0;
+    return;
+  }
+
+  /* record the kind of the result, unless the instruction is a jump. */
+  if (op != EXPR_JZ && op != EXPR_JMP && p->depth > 0)
+    p->vec[p->depth - 1] = (unsigned char) v;
+}
+
+/* exprargs(): compile the comma-separated arguments of a function call,
+ * after its opening parenthesis has been consumed.
+ *
+ * arguments:
+ *  @p: pointer to the compiler state.
+ *
+ * returns:
+ *  number of compiled arguments.
+ */
+static int exprargs (exprparse_t *p) {
+  /* declare required variables:
+   *  @n: number of compiled arguments.
+   */
+  int n = 0;
+
+  /* handle empty argument lists. */
+  if (exprmatch(p, ")"))
+    return 0;
+
+  /* compile each argument. */
+  do {
+    exprternary(p);
+    n++;
+  }
+  while (p->ok && exprmatch(p, ","));
+
+  /* require the closing parenthesis. */
+  if (!exprmatch(p, ")"))
+    p->ok = 0;
+
+  return n;
+}
+
+/* exprcall(): compile a call of a named function.
+ *
+ * arguments:
+ *  @p: pointer to the compiler state.
+ *  @name: name of the called function.
+ */
+static void exprcall (exprparse_t *p, const char *name) {
+  /* declare required variables:
+   *  @i: function table index.
+   *  @n: number of arguments.
+   */
+  int i, n;
+
+  /* compile the arguments. */
+  n = exprargs(p);
+  if (!p->ok)
+    return;
+
+  /* handle reductions and preprogrammed functions. */
+  if (n == 1 && strcmp(name, "sum") == 0)
+    expremit(p, EXPR_SUM, 0, 0.0, 0);
+  else if (n == 1 && strcmp(name, "prod") == 0)
+    expremit(p, EXPR_PROD, 0, 0.0, 0);
+  else if (n == 1 && strcmp(name, "length") == 0)
+    expremit(p, EXPR_LEN, 0, 0.0, 0);
+  else if (n == 1 && strcmp(name, "poisrnd") == 0)
+    expremit(p, EXPR_POIS, 0, 0.0, 0);
+  else if (n == 5 && strcmp(name, "sinegap") == 0)
+    expremit(p, EXPR_SG, 0, 0.0, -4);
+  else if (n == 5 && strcmp(name, "sineburst") == 0)
+    expremit(p, EXPR_SB, 0, 0.0, -4);
+  else if (n == 5 && strcmp(name, "poissongap") == 0)
+    expremit(p, EXPR_PG, 0, 0.0, -4);
+  else if (n == 1) {
+    /* search the single-argument function table. */
+    for (i = 0; exprfn1[i].name; i++) {
+      if (strcmp(name, exprfn1[i].name) == 0) {
+        expremit(p, EXPR_FN1, i, 0.0, 0);
+        return;
+      }
+    }
+
+    p->ok = 0;
+  }
+  else if (n == 2) {
+    /* search the two-argument function table. */
+    for (i = 0; exprfn2[i].name; i++) {
+      if (strcmp(name, exprfn2[i].name) == 0) {
+        expremit(p, EXPR_FN2, i, 0.0, -1);
+        return;
+      }
+    }
+
+    p->ok = 0;
+  }
+  else
+    p->ok = 0;
+}
+
+/* exprpostfix(): compile a primary expression and any indexing that
+ * follows it.
+ */
+static void exprpostfix (exprparse_t *p) {
+  /* declare required variables:
+   *  @name: identifier read from the string.
+   *  @end: end of a parsed numeric constant.
+   *  @val: parsed numeric constant.
+   *  @i, @n: variable index and identifier length.
+   */
+  char name[32], *end;
+  unsigned int i, n;
+  double val;
+
+  /* determine the kind of primary expression. */
+  exprspace(p);
+  if (isdigit((unsigned char) *p->s) ||
+      (*p->s == '.' && isdigit((unsigned char) p->s[1]))) {
+    /* numeric constant. */
+    val = strtod(p->s, &end);
+    p->s = end;
+    expremit(p, EXPR_NUM, 0, val, 1);
+
+    /* handle julia's implicit multiplication of numeric coefficients. */
+    if (isalpha((unsigned char) *p->s) || *p->s == '_' || *p->s == '(') {
+      exprunary(p);
+      expremit(p, EXPR_MUL, 0, 0.0, -1);
+    }
+
+    return;
+  }
+  else if (isalpha((unsigned char) *p->s) || *p->s == '_') {
+    /* read the identifier. */
+    for (n = 0; isalnum((unsigned char) p->s[n]) || p->s[n] == '_'; n++);
+    if (n >= sizeof(name)) {
+      p->ok = 0;
+      return;
+    }
+
+    memcpy(name, p->s, n);
+    name[n] = '\0';
+    p->s += n;
+
+    /* function calls. */
+    if (exprmatch(p, "(")) {
+      exprcall(p, name);
+    }
+    else {
+      /* variables. */
+      for (i = 0; i < p->nvar; i++) {
+        if (strcmp(name, p->vars[i].name) == 0)
+          break;
+      }
+
+      if (i < p->nvar)
+        expremit(p, EXPR_VAR, (int) i, 0.0, 1);
+      else if (strcmp(name, "pi") == 0)
+        expremit(p, EXPR_NUM, 0, M_PI, 1);
+      else
+        p->ok = 0;
+    }
+  }
+  else if (exprmatch(p, "(")) {
+    /* parenthesized subexpression. */
+    exprternary(p);
+    if (!exprmatch(p, ")"))
+      p->ok = 0;
+  }
+  else {
+    /* unsupported syntax. */
+    p->ok = 0;
+  }
+
+  /* compile any indexing operations. */
+  while (p->ok && exprmatch(p, "[")) {
+    exprternary(p);
+    expremit(p, EXPR_IDX, 0, 0.0, -1);
+    if (!exprmatch(p, "]"))
+      p->ok = 0;
+  }
+}
+
+/* exprpower(): compile a right-associative exponentiation. */
+static void exprpower (exprparse_t *p) {
+  exprpostfix(p);
+  if (p->ok && exprdot(p, "^")) {
+    p->s++;
+    exprunary(p);
+    expremit(p, EXPR_POW, 0, 0.0, -1);
+  }
+}
+
+/* exprunary(): compile a unary plus or minus. */
+static void exprunary (exprparse_t *p) {
+  if (exprmatch(p, "-")) {
+    exprunary(p);
+    expremit(p, EXPR_NEG, 0, 0.0, 0);
+  }
+  else if (exprmatch(p, "+"))
+    exprunary(p);
+  else
+    exprpower(p);
+}
+
+/* exprproduct(): compile a chain of multiplications and divisions. */
+static void exprproduct (exprparse_t *p) {
+  /* declare required variables:
+   *  @c: operator character.
+   */
+  char c;
+
+  exprunary(p);
+  while (p->ok && (c = exprdot(p, "*/"))) {
+    p->s++;
+    exprunary(p);
+    expremit(p, c == '*' ? EXPR_MUL : EXPR_DIV, 0, 0.0, -1);
+  }
+}
+
+/* exprsum(): compile a chain of additions and subtractions. */
+static void exprsum (exprparse_t *p) {
+  /* declare required variables:
+   *  @c: operator character.
+   */
+  char c;
+
+  exprproduct(p);
+  while (p->ok && (c = exprdot(p, "+-"))) {
+    p->s++;
+    exprproduct(p);
+    expremit(p, c == '+' ? EXPR_ADD : EXPR_SUB, 0, 0.0, -1);
+  }
+}
+
+/* exprcompare(): compile an optional comparison. undotted comparisons
+ * of vectors yield a single boolean in julia, so they are left to julia.
+ */
+static void exprcompare (exprparse_t *p) {
+  /* declare required variables:
+   *  @op: operation code of the comparison.
+   *  @dot: whether the comparison is broadcast.
+   *  @s: position of the comparison operator.
+   */
+  const char *s;
+  int op, dot;
+
+  exprsum(p);
+  exprspace(p);
+  s = p->s;
+  if (!p->ok || !exprdot(p, "<>=!"))
+    return;
+
+  dot = (p->s != s);
+
+  if (exprmatch(p, "<="))
+    op = EXPR_LE;
+  else if (exprmatch(p, ">="))
+    op = EXPR_GE;
+  else if (exprmatch(p, "=="))
+    op = EXPR_EQ;
+  else if (exprmatch(p, "!="))
+    op = EXPR_NE;
+  else if (exprmatch(p, "<"))
+    op = EXPR_LT;
+  else if (exprmatch(p, ">"))
+    op = EXPR_GT;
+  else {
+    p->ok = 0;
+    return;
+  }
+
+  exprsum(p);
+  if (p->ok && !dot && (p->vec[p->depth - 2] || p->vec[p->depth - 1])) {
+    p->ok = 0;
+    return;
+  }
+
+  expremit(p, op, 0, 0.0, -1);
+}
+
+/* exprternary(): compile an optional conditional expression. */
+static void exprternary (exprparse_t *p) {
+  /* declare required variables:
+   *  @jz, @jmp: indices of the emitted jump instructions.
+   *  @v: whether the first branch yields a vector.
+   */
+  unsigned int jz, jmp;
+  int v;
+
+  exprcompare(p);
+  if (!p->ok || !exprmatch(p, "?"))
+    return;
+
+  /* emit the conditional jump around the first branch. */
+  jz = p->e->n;
+  expremit(p, EXPR_JZ, 0, 0.0, -1);
+  exprternary(p);
+
+  /* emit the jump around the second branch. */
+  jmp = p->e->n;
+  v = (p->ok && p->vec[p->depth - 1]);
+  expremit(p, EXPR_JMP, 0, 0.0, -1);
+  if (!p->ok || !exprmatch(p, ":")) {
+    p->ok = 0;
+    return;
+  }
+
+  /* compile the second branch and patch the jump targets. */
+  p->e->ops[jz].arg = (int) p->e->n;
+  exprternary(p);
+  if (p->ok) {
+    p->e->ops[jmp].arg = (int) p->e->n;
+    p->vec[p->depth - 1] |= (unsigned char) v;
+  }
+}
+
+/* exprcompile(): compile an expression string into a program that may
+ * be evaluated natively, without calling into julia. only a subset of
+ * julia syntax is supported: numeric constants, the named variables,
+ * arithmetic and comparison operators (dotted or not), conditionals,
+ * indexing, common elementary functions, reductions and the
+ * preprogrammed gap equations.
+ *
+ * arguments:
+ *  @str: expression string to compile.
+ *  @vars: array of variables accepted by the expression.
+ *  @nvar: number of accepted variables.
+ *
+ * returns:
+ *  pointer to the compiled expression, or NULL if the string could not
+ *  be compiled into a native program.
+ */
+expr_t *exprcompile (const char *str, const exprvar_t *vars,
+                     unsigned int nvar) {
+  /* declare required variables:
+   *  @p: compiler state.
+   */
+  exprparse_t p;
+
+  /* allocate the program structure. */
+  p.e = (expr_t*) calloc(1, sizeof(expr_t));
+  if (!p.e)
+    return NULL;
+
+  /* initialize the compiler state. */
+  p.s = str;
+  p.cap = 0;
+  p.vars = vars;
+  p.nvar = nvar;
+  p.depth = 0;
+  p.ok = 1;
+
+  /* compile the expression and require that it consumes the string. */
+  exprternary(&p);
+  exprspace(&p);
+  if (*p.s)
+    p.ok = 0;
+
+  /* check that compilation succeeded. */
+  if (!p.ok || p.e->n == 0) {
+    exprfree(p.e);
+    return NULL;
+  }
+
+  /* return the compiled program. */
+  p.e->nvar = nvar;
+  return p.e;
+}
+
+/* exprfree(): free a compiled expression.
+ *
+ * arguments:
+ *  @e: pointer to the compiled expression to free.
+ */
+void exprfree (expr_t *e) {
+  /* check that the pointer is valid. */
+  if (!e)
+    return;
+
+  /* free the program and its structure. */
+  free(e->ops);
+  free(e);
+}
+
+/* exprapply(): apply a binary operation to a pair of scalars. */
+static double exprapply (int op, int arg, double a, double b) {
+  switch (op) {
+    case EXPR_ADD: return a + b;
+    case EXPR_SUB: return a - b;
+    case EXPR_MUL: return a * b;
+    case EXPR_DIV: return a / b;
+    case EXPR_POW: return (b == 2.0 ? a * a : pow(a, b));
+    case EXPR_LT:  return (a <  b ? 1.0 : 0.0);
+    case EXPR_LE:  return (a <= b ? 1.0 : 0.0);
+    case EXPR_GT:  return (a >  b ? 1.0 : 0.0);
+    case EXPR_GE:  return (a >= b ? 1.0 : 0.0);
+    case EXPR_EQ:  return (a == b ? 1.0 : 0.0);
+    case EXPR_NE:  return (a != b ? 1.0 : 0.0);
+    case EXPR_FN2: return exprfn2[arg].fn(a, b);
+  }
+
+  return NAN;
+}
+
+/* exprsumv(): sum the elements of a value. */
+static double exprsumv (const exprval_t *a) {
+  /* declare required variables:
+   *  @i: element index.
+   *  @s: running sum.
+   */
+  unsigned int i;
+  double s;
+
+  /* scalars are their own sums. */
+  if (a->n == 0)
+    return a->v[0];
+
+  for (i = 1, s = a->v[0]; i < a->n; i++)
+    s += a->v[i];
+
+  return s;
+}
+
+/* exprgap(): evaluate one of the preprogrammed gap equations from its
+ * five arguments, following the julia definitions in eval.c.
+ *
+ * arguments:
+ *  @op: operation code of the preprogrammed equation.
+ *  @a: array of the five argument values (x, d, O, N, L).
+ *  @y: pointer to the output value.
+ *
+ * returns:
+ *  integer indicating whether evaluation succeeded (1) or not (0).
+ */
+static int exprgap (int op, const exprval_t *a, double *y) {
+  /* declare required variables:
+   *  @x, @L: sequence term and scaling factor.
+   *  @th: normalized position of the term.
+   *  @d: one-based dimension index.
+   *  @b: burst factor.
+   */
+  double x, L, th, b;
+  int d;
+
+  /* require scalar terms and scaling factors. */
+  if (a[0].n || a[1].n || a[4].n)
+    return 0;
+
+  /* compute the sine-gap value. */
+  x = a[0].v[0];
+  L = a[4].v[0];
+  th = x + exprsumv(a + 2);
+  *y = L * sin((M_PI / 2.0) * th / exprsumv(a + 3));
+
+  /* apply the burst factor of the sine-burst equation. */
+  if (op == EXPR_SB) {
+    d = (int) a[1].v[0];
+    if (a[3].n == 0 || d < 1 || d > (int) a[3].n)
+      return 0;
+
+    b = sin((M_PI / 4.0) * a[3].v[d - 1] * th / exprsumv(a + 3));
+    *y *= b * b;
+  }
+
+  /* apply the poisson marker of the poisson-gap equation. */
+  if (op == EXPR_PG)
+    *y = -*y - 2.0;
+
+  return 1;
+}
+
+/* expreval(): evaluate a compiled expression. this function only reads
+ * from the compiled program, so it may be called from several threads
+ * at once.
+ *
+ * arguments:
+ *  @e: pointer to the compiled expression.
+ *  @vars: array of variable values, in the order used for compilation.
+ *  @y: pointer to the scalar output value.
+ *
+ * returns:
+ *  integer indicating whether evaluation succeeded (1) or not (0).
+ */
+int expreval (const expr_t *e, const exprval_t *vars, double *y) {
+  /* declare required variables:
+   *  @st: evaluation stack.
+   *  @r: result of binary operations.
+   *  @a, @b: operand pointers.
+   *  @sp: stack pointer, counting values on the stack.
+   *  @pc: program counter.
+   *  @i: element index.
+   *  @k: index value.
+   */
+  exprval_t st[EXPR_MAX_STACK], r, *a, *b;
+  unsigned int sp, pc, i;
+  double k;
+
+  /* run the program. */
+  for (sp = 0, pc = 0; pc < e->n; pc++) {
+    /* point at the topmost operands. */
+    a = st + sp - 2;
+    b = st + sp - 1;
+
+    /* execute the instruction. */
+    switch (e->ops[pc].op) {
+      /* push a constant. */
+      case EXPR_NUM:
+        st[sp].n = 0;
+        st[sp++].v[0] = e->ops[pc].val;
+        break;
+
+      /* push a variable. */
+      case EXPR_VAR:
+        if (vars[e->ops[pc].arg].n > EXPR_MAX_DIMS)
+          return 0;
+
+        st[sp++] = vars[e->ops[pc].arg];
+        break;
+
+      /* negate and apply single-argument functions elementwise. */
+      case EXPR_NEG:
+        for (i = 0; i < (b->n ? b->n : 1); i++)
+          b->v[i] = -b->v[i];
+        break;
+
+      case EXPR_FN1:
+        for (i = 0; i < (b->n ? b->n : 1); i++) {
+          k = b->v[i];
+          if (k < exprfn1[e->ops[pc].arg].lo ||
+              k > exprfn1[e->ops[pc].arg].hi)
+            return 0;
+
+          b->v[i] = exprfn1[e->ops[pc].arg].fn(k);
+        }
+        break;
+
+      /* apply binary operations elementwise, broadcasting scalars. */
+      case EXPR_ADD: case EXPR_SUB: case EXPR_MUL: case EXPR_DIV:
+      case EXPR_POW: case EXPR_LT:  case EXPR_LE:  case EXPR_GT:
+      case EXPR_GE:  case EXPR_EQ:  case EXPR_NE:  case EXPR_FN2:
+        if (a->n && b->n && a->n != b->n)
+          return 0;
+
+        /* julia raises a domain error for negative bases of fractional
+         * powers.
+         */
+        r.n = (a->n ? a->n : b->n);
+        for (i = 0; i < (r.n ? r.n : 1); i++) {
+          k = b->v[b->n ? i : 0];
+          if (e->ops[pc].op == EXPR_POW && a->v[a->n ? i : 0] < 0.0 &&
+              k != floor(k))
+            return 0;
+
+          r.v[i] = exprapply(e->ops[pc].op, e->ops[pc].arg,
+                             a->v[a->n ? i : 0], k);
+        }
+
+        *a = r;
+        sp--;
+        break;
+
+      /* index into a vector. */
+      case EXPR_IDX:
+        k = b->v[0];
+        if (b->n || a->n == 0 || k != floor(k) || k < 1.0 || k > a->n)
+          return 0;
+
+        a->v[0] = a->v[(unsigned int) k - 1];
+        a->n = 0;
+        sp--;
+        break;
+
+      /* reduce vectors to scalars. */
+      case EXPR_SUM:
+        b->v[0] = exprsumv(b);
+        b->n = 0;
+        break;
+
+      case EXPR_PROD:
+        for (i = 1, k = b->v[0]; i < b->n; i++)
+          k *= b->v[i];
+
+        b->v[0] = k;
+        b->n = 0;
+        break;
+
+      case EXPR_LEN:
+        b->v[0] = (b->n ? (double) b->n : 1.0);
+        b->n = 0;
+        break;
+
+      /* conditional and unconditional jumps. */
+      case EXPR_JZ:
+        if (b->n)
+          return 0;
+
+        sp--;
+        if (b->v[0] == 0.0)
+          pc = e->ops[pc].arg - 1;
+        break;
+
+      case EXPR_JMP:
+        pc = e->ops[pc].arg - 1;
+        break;
+
+      /* quasirandom poisson marker. */
+      case EXPR_POIS:
+        for (i = 0; i < (b->n ? b->n : 1); i++)
+          b->v[i] = -b->v[i] - 2.0;
+        break;
+
+      /* preprogrammed gap equations. */
+      case EXPR_SG: case EXPR_SB: case EXPR_PG:
+        sp -= 4;
+        if (!exprgap(e->ops[pc].op, st + sp - 1, &k))
+          return 0;
+
+        st[sp - 1].n = 0;
+        st[sp - 1].v[0] = k;
+        break;
+
+      /* unknown instructions. */
+      default:
+        return 0;
+    }
+  }
+
+  /* require a single finite scalar result. */
+  if (sp != 1 || st[0].n || !isfinite(st[0].v[0]))
+    return 0;
+
+  *y = st[0].v[0];
+  return 1;
+}
+
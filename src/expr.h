@@ -0,0 +1,100 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_EXPR_H__
+#define __NUSUTILS_EXPR_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+/* define the maximum number of elements in a vector value, and the
+ * maximum number of values held on the evaluation stack.
+ */
+#define EXPR_MAX_DIMS   8
+#define EXPR_MAX_STACK  32
+
+/* exprval_t: structure that holds a scalar (n == 0) or vector value
+ * of a natively evaluated expression.
+ */
+typedef struct {
+  /* @n: number of vector elements, or zero for scalars.
+   * @v: array of element values.
+   */
+  unsigned int n;
+  double v[EXPR_MAX_DIMS];
+}
+exprval_t;
+
+/* exprvar_t: structure that names a variable accepted by a natively
+ * evaluated expression.
+ */
+typedef struct {
+  /* @name: name of the variable in expression strings.
+   * @vec: whether the variable holds a vector.
+   */
+  const char *name;
+  int vec;
+}
+exprvar_t;
+
+/* exprop_t: structure that holds a single instruction of a compiled
+ * expression program.
+ */
+typedef struct {
+  /* @op: operation code of the instruction.
+   * @arg: variable index, function index or jump target.
+   * @val: constant value.
+   */
+  int op, arg;
+  double val;
+}
+exprop_t;
+
+/* expr_t: structure that holds an expression compiled into a stack
+ * program, which may be evaluated from several threads at once.
+ */
+typedef struct {
+  /* @ops: array of program instructions.
+   * @n: number of program instructions.
+   * @nvar: number of variables accepted by the program.
+   */
+  exprop_t *ops;
+  unsigned int n, nvar;
+}
+expr_t;
+
+/* function declarations: */
+
+expr_t *exprcompile (const char *str, const exprvar_t *vars,
+                     unsigned int nvar);
+
+void exprfree (expr_t *e);
+
+int expreval (const expr_t *e, const exprval_t *vars, double *y);
+
+#endif /* !__NUSUTILS_EXPR_H__ */
+
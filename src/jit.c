@@ -23,63 +23,438 @@
 /* include the jittering header. */
 #include "jit.h"
 
+/* jitdep(): deposit the low bits of a value into the set bits of a mask.
+ *
+ * arguments:
+ *  @x: value to deposit.
+ *  @m: mask of the bits to deposit into, from least significant.
+ *
+ * returns:
+ *  deposited bits.
+ */
+unsigned int jitdep (unsigned int x, unsigned int m) {
+#ifdef __BMI2__
+  /* use the parallel bit deposit instruction. */
+  return _pdep_u32(x, m);
+#else
+  /* declare required variables:
+   *  @r: deposited bits.
+   *  @b: current bit of the value.
+   */
+  unsigned int r, b;
+
+  /* deposit each bit of the value into the next bit of the mask. */
+  for (r = 0, b = 1; m; m &= m - 1, b <<= 1) {
+    if (x & b)
+      r |= m & -m;
+  }
+
+  return r;
+#endif
+}
+
+/* jitext(): extract the set bits of a mask from a value.
+ *
+ * arguments:
+ *  @x: value to extract bits from.
+ *  @m: mask of the bits to extract, from least significant.
+ *
+ * returns:
+ *  extracted bits, packed into the low bits.
+ */
+unsigned int jitext (unsigned int x, unsigned int m) {
+#ifdef __BMI2__
+  /* use the parallel bit extract instruction. */
+  return _pext_u32(x, m);
+#else
+  /* declare required variables:
+   *  @r: extracted bits.
+   *  @b: next bit of the result.
+   */
+  unsigned int r, b;
+
+  /* extract each bit of the mask into the next bit of the result. */
+  for (r = 0, b = 1; m; m &= m - 1, b <<= 1) {
+    if (x & m & -m)
+      r |= b;
+  }
+
+  return r;
+#endif
+}
+
+/* jitlayout(): compute the storage order of a grid. z-order is only used
+ * when its indices fit into JIT_ZBITS bits, and linear order otherwise.
+ *
+ * arguments:
+ *  @L: pointer to the output storage order.
+ *  @N: pointer to the tuple of grid sizes.
+ *  @z: whether z-order is requested.
+ */
+void jitlayout (jitlay_t *L, tuple_t *N, int z) {
+  /* declare required variables:
+   *  @b: number of index bits of each dimension.
+   *  @nb, @lvl: number of assigned bits and current bit level.
+   *  @i: dimension loop counter.
+   */
+  unsigned int b[JIT_ZBITS], nb, lvl, i;
+
+  /* store a linear order by default. */
+  L->N = N;
+  L->n = tupprod(N);
+  L->z = 0;
+  tupgridinit(&L->P, N);
+  for (i = 0; i < tupsize(N) && i < JIT_ZBITS; i++)
+    L->st[i] = tupstride(N, i);
+
+  if (!z || tupsize(N) > JIT_ZBITS)
+    return;
+
+  /* count the index bits of each dimension. */
+  for (i = 0, nb = 0; i < tupsize(N); i++) {
+    for (b[i] = 0; b[i] < JIT_ZBITS && (1UL << b[i]) < tupget(N, i);
+         b[i]++);
+
+    L->zm[i] = 0;
+    nb += b[i];
+  }
+
+  /* keep the linear order if z-order indices do not fit. */
+  if (nb >= JIT_ZBITS)
+    return;
+
+  /* interleave the bits of each dimension, from least significant, and
+   * skip dimensions whose bits are exhausted.
+   */
+  for (lvl = 0, nb = 0; nb < JIT_ZBITS; lvl++) {
+    for (i = 0, z = 0; i < tupsize(N); i++) {
+      if (lvl < b[i]) {
+        L->zm[i] |= 1U << nb++;
+        z = 1;
+      }
+    }
+
+    if (!z)
+      break;
+  }
+
+  /* store the z-order. */
+  L->n = 1U << nb;
+  L->z = 1;
+
+  /* tabulate the linear index contributed by each byte of a z-order
+   * index, which are summed to convert z-order indices.
+   */
+  for (lvl = 0; lvl < sizeof(L->lt) / sizeof(L->lt[0]); lvl++) {
+    for (nb = 0; nb < 256; nb++) {
+      for (i = 0, L->lt[lvl][nb] = 0; i < tupsize(N); i++)
+        L->lt[lvl][nb] += jitext(nb << (8 * lvl), L->zm[i]) * L->st[i];
+    }
+  }
+}
+
+/* jitpack(): pack grid indices into a stored index.
+ *
+ * arguments:
+ *  @L: pointer to the storage order.
+ *  @x: pointer to the tuple of grid indices.
+ *
+ * returns:
+ *  stored index of the grid point.
+ */
+unsigned int jitpack (jitlay_t *L, tuple_t *x) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   *  @xi: stored index.
+   */
+  unsigned int i, xi;
+
+  /* pack linear indices. */
+  if (!L->z)
+    return L->P.pack(&L->P, x->elem);
+
+  /* interleave z-order indices. */
+  for (i = 0, xi = 0; i < tupsize(x); i++)
+    xi |= jitdep(tupget(x, i), L->zm[i]);
+
+  return xi;
+}
+
+/* jitunpack(): unpack a stored index into grid indices.
+ *
+ * arguments:
+ *  @L: pointer to the storage order.
+ *  @xi: stored index of the grid point.
+ *  @x: pointer to the output tuple of grid indices.
+ */
+void jitunpack (jitlay_t *L, unsigned int xi, tuple_t *x) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   */
+  unsigned int i;
+
+  /* unpack linear indices. */
+  if (!L->z) {
+    L->P.unpack(&L->P, xi, x->elem);
+    return;
+  }
+
+  /* deinterleave z-order indices. */
+  for (i = 0; i < tupsize(x); i++)
+    tupset(x, i, jitext(xi, L->zm[i]));
+}
+
+/* jitlin(): convert a stored index into a linear index.
+ *
+ * arguments:
+ *  @L: pointer to the storage order.
+ *  @xi: stored index of the grid point.
+ *
+ * returns:
+ *  linear index of the grid point.
+ */
+unsigned int jitlin (jitlay_t *L, unsigned int xi) {
+  /* linear indices are stored as they are. */
+  if (!L->z)
+    return xi;
+
+  /* sum the linear index contributed by each byte. */
+  return L->lt[0][xi & 0xff] + L->lt[1][(xi >> 8) & 0xff] +
+         L->lt[2][(xi >> 16) & 0xff] + L->lt[3][xi >> 24];
+}
+
+/* jitstep(): compute the stored index of a neighbor of a grid point. the
+ * neighbor must lie on the grid.
+ *
+ * arguments:
+ *  @L: pointer to the storage order.
+ *  @xi: stored index of the grid point.
+ *  @i: dimension along which to step.
+ *  @dir: direction of the step, either -1 or +1.
+ *
+ * returns:
+ *  stored index of the neighbor.
+ */
+unsigned int jitstep (jitlay_t *L, unsigned int xi, unsigned int i,
+                      int dir) {
+  /* declare required variables:
+   *  @m: bits of the stepped dimension, or its linear stride.
+   */
+  unsigned int m;
+
+  /* step linear indices by the stride of the dimension. */
+  if (!L->z) {
+    m = (i < JIT_ZBITS ? L->st[i] : tupstride(L->N, i));
+    return (dir < 0 ? xi - m : xi + m);
+  }
+
+  /* step z-order indices by carrying only through the bits of the
+   * dimension.
+   */
+  m = L->zm[i];
+  if (dir < 0)
+    return (((xi & m) - 1) & m) | (xi & ~m);
+
+  return (((xi | ~m) + 1) & m) | (xi & ~m);
+}
+
+/* jitbetter(): select the more probable of two available stored indices,
+ * comparing the density values in the precision they are stored in. ties
+ * are won by the smaller linear index.
+ *
+ * arguments:
+ *  @M: pointer to the tree of the grid.
+ *  @a, @b: stored indices to compare, or JIT_MAX_NONE.
+ *
+ * returns:
+ *  the better stored index, or JIT_MAX_NONE if neither is given.
+ */
+unsigned int jitbetter (jitmax_t *M, unsigned int a, unsigned int b) {
+  /* declare required variables:
+   *  @pa, @pb: density values of the two indices.
+   */
+  double pa, pb;
+
+  /* return the given index, if the other is missing. */
+  if (a == JIT_MAX_NONE)
+    return b;
+  else if (b == JIT_MAX_NONE)
+    return a;
+
+  /* compare the density values, and then the linear indices. */
+  pa = pdfat(M->pdf, a);
+  pb = pdfat(M->pdf, b);
+  if (pa != pb)
+    return (pa > pb ? a : b);
+
+  return (jitlin(M->L, a) < jitlin(M->L, b) ? a : b);
+}
+
+/* jitmaxleaf(): recompute the best available index of a leaf block.
+ *
+ * arguments:
+ *  @M: pointer to the tree of the grid.
+ *  @b: index of the leaf block.
+ */
+void jitmaxleaf (jitmax_t *M, unsigned int b) {
+  /* declare required variables:
+   *  @i, @end: stored index loop counter and bound of the block.
+   *  @best: best available index of the block.
+   */
+  unsigned int i, end, best;
+
+  /* scan the available indices of the block. */
+  i = b * JIT_MAX_BLOCK;
+  end = (M->L->n - i < JIT_MAX_BLOCK ? M->L->n : i + JIT_MAX_BLOCK);
+  for (best = JIT_MAX_NONE; i < end; i++) {
+    if (M->mask[i])
+      best = jitbetter(M, best, i);
+  }
+
+  /* store the best index into the leaf. */
+  M->node[M->nleaf + b] = best;
+}
+
+/* jitmaxinit(): build the tree that locates the most probable available
+ * point of a grid.
+ *
+ * arguments:
+ *  @M: pointer to the tree to build.
+ *  @pdf: pointer to the view of the stored density values.
+ *  @mask: array of availability flags of each stored index.
+ *  @L: pointer to the storage order of the grid.
+ *
+ * returns:
+ *  integer indicating whether the tree was built (1) or not (0).
+ */
+int jitmaxinit (jitmax_t *M, const pdfview_t *pdf,
+                const unsigned char *mask, jitlay_t *L) {
+  /* declare required variables:
+   *  @k: node loop counter.
+   *  @nblk: number of leaf blocks.
+   */
+  unsigned int k, nblk;
+
+  /* store the grid. */
+  M->pdf = pdf;
+  M->mask = mask;
+  M->L = L;
+
+  /* count the leaves, and allocate the nodes. */
+  nblk = (L->n + JIT_MAX_BLOCK - 1) / JIT_MAX_BLOCK;
+  for (M->nleaf = 1; M->nleaf < nblk; M->nleaf <<= 1);
+  M->node = (unsigned int*) malloc(2 * M->nleaf * sizeof(unsigned int));
+  if (!M->node)
+    return 0;
+
+  /* fill the leaves, and then the nodes above them. */
+  for (k = 0; k < M->nleaf; k++) {
+    if (k < nblk)
+      jitmaxleaf(M, k);
+    else
+      M->node[M->nleaf + k] = JIT_MAX_NONE;
+  }
+
+  for (k = M->nleaf - 1; k > 0; k--)
+    M->node[k] = jitbetter(M, M->node[2 * k], M->node[2 * k + 1]);
+
+  /* return success. */
+  return 1;
+}
+
+/* jitmaxdrop(): update the tree after a point has been masked off.
+ *
+ * arguments:
+ *  @M: pointer to the tree of the grid.
+ *  @xi: stored index of the masked point.
+ */
+void jitmaxdrop (jitmax_t *M, unsigned int xi) {
+  /* declare required variables:
+   *  @k: node loop counter.
+   */
+  unsigned int k;
+
+  /* recompute the leaf of the point, unless it held another point. */
+  k = M->nleaf + xi / JIT_MAX_BLOCK;
+  if (M->node[k] != xi)
+    return;
+
+  jitmaxleaf(M, xi / JIT_MAX_BLOCK);
+
+  /* recompute the nodes above the leaf, until one is unchanged. */
+  for (k >>= 1; k > 0; k >>= 1) {
+    xi = jitbetter(M, M->node[2 * k], M->node[2 * k + 1]);
+    if (xi == M->node[k])
+      break;
+
+    M->node[k] = xi;
+  }
+}
+
+/* jitmaxfree(): free the nodes of a tree.
+ *
+ * arguments:
+ *  @M: pointer to the tree to free.
+ */
+void jitmaxfree (jitmax_t *M) {
+  /* free the nodes. */
+  free(M->node);
+  M->node = NULL;
+}
+
 /* jitsearch(): locate all adjacent available indices to a given grid index.
  *
  * arguments:
  *  @black: input tuple of black-listed indices.
- *  @mask: input tuple of masking information.
+ *  @mask: input array of availability flags of each stored index.
  *  @x: input tuple to search out from.
- *  @N: input tuple of search grid sizes.
+ *  @L: input storage order of the search grid.
  *  @xadj: output tuple of adjacent indices.
  */
-void jitsearch (tuple_t *black, tuple_t *mask,
-                tuple_t *x, tuple_t *N,
+void jitsearch (tuple_t *black, unsigned char *mask,
+                tuple_t *x, jitlay_t *L,
                 tuple_t *xadj) {
   /* declare required variables:
    *  @i: tuple element loop index.
-   *  @si: tuple stride value.
-   *  @xi: packed linear index.
+   *  @xi, @xs: packed stored indices of the point and of its neighbor.
    */
-  unsigned int i, si, xi;
+  unsigned int i, xi, xs;
 
-  /* pack the initial search index into a linear value. */
-  tuppack(x, N, &xi);
+  /* pack the initial search index into a stored value. */
+  xi = jitpack(L, x);
 
   /* loop over all possible search directions. */
   for (i = 0; i < tupsize(x); i++) {
-    /* get the linear string along the current direction. */
-    si = tupstride(N, i);
-
     /* check if the previous point is available. */
     if (tupget(x, i) > 0 &&
-        tupget(mask, xi - si) &&
-        !tupsearch(black, xi - si)) {
+        mask[xs = jitstep(L, xi, i, -1)] &&
+        !tupsearch(black, xs)) {
       /* yes. append it to the list. */
-      tupappend(xadj, xi - si);
+      tupappend(xadj, xs);
     }
 
     /* check if the next point is available. */
-    if (tupget(x, i) < tupget(N, i) - 1 &&
-        tupget(mask, xi + si) &&
-        !tupsearch(black, xi + si)) {
+    if (tupget(x, i) < tupget(L->N, i) - 1 &&
+        mask[xs = jitstep(L, xi, i, +1)] &&
+        !tupsearch(black, xs)) {
       /* yes. append it to the list. */
-      tupappend(xadj, xi + si);
+      tupappend(xadj, xs);
     }
   }
 }
 
-/* jitdist(): compute the distance of a linear index from a centroid.
+/* jitdist(): compute the distance of a stored index from a centroid.
  *
  * arguments:
- *  @xi: linear index from which to compute the distance.
+ *  @xi: stored index from which to compute the distance.
  *  @c: values of the current centroid.
  *  @x: temporary tuple for unpacking.
- *  @N: grid size for unpacking.
+ *  @L: storage order for unpacking.
  *
  * returns:
  *  squared euclidean distance from @xi to @c.
  */
-double jitdist (unsigned int xi, double *c, tuple_t *x, tuple_t *N) {
+double jitdist (unsigned int xi, double *c, tuple_t *x, jitlay_t *L) {
   /* declare required variables:
    *  @i: tuple element index.
    *  @d: output distance.
@@ -87,8 +462,8 @@ double jitdist (unsigned int xi, double *c, tuple_t *x, tuple_t *N) {
   unsigned int i;
   double d;
 
-  /* unpack the linear index. */
-  tupunpack(xi, N, x);
+  /* unpack the stored index. */
+  jitunpack(L, xi, x);
 
   /* compute the distance contributions from each index element. */
   for (i = 0, d = 0.0; i < tupsize(x); i++)
@@ -104,18 +479,18 @@ double jitdist (unsigned int xi, double *c, tuple_t *x, tuple_t *N) {
  *  @Y: tuple of elements, the last of which is new.
  *  @c: values of the centroid to update.
  *  @x: temporary tuple for unpacking.
- *  @N: grid size for unpacking.
+ *  @L: storage order for unpacking.
  */
-void jitcent (tuple_t *Y, double *c, tuple_t *x, tuple_t *N) {
+void jitcent (tuple_t *Y, double *c, tuple_t *x, jitlay_t *L) {
   /* declare required variables:
    *  @i: tuple element index.
-   *  @xi: new linear index.
+   *  @xi: new stored index.
    */
   unsigned int i, xi;
 
-  /* get the new linear index and unpack it. */
+  /* get the new stored index and unpack it. */
   xi = tupget(Y, tupsize(Y) - 1);
-  tupunpack(xi, N, x);
+  jitunpack(L, xi, x);
 
   /* update each centroid value. */
   for (i = 0; i < tupsize(x); i++)
@@ -126,17 +501,20 @@ void jitcent (tuple_t *Y, double *c, tuple_t *x, tuple_t *N) {
  *
  * arguments:
  *  @G: pointer to a quasirandom number generator structure.
- *  @pdf: array of normalized density function values.
+ *  @pdf: pointer to the normalized density function values.
  *  @pjit: target probability for jittered region selection.
- *  @mask: pointer to the tuple of available linear indices.
+ *  @mask: array of availability flags of each stored index.
+ *  @M: pointer to the tree of the most probable available index, which
+ *      is updated as the sampled region is masked off.
  *  @x: pointer to the tuple to be updated.
- *  @N: pointer to the tuple of sizes.
+ *  @L: pointer to the storage order of the grid.
  *
  * returns:
- *  integer indicating whether sampling succeeded (1) or failed (0).
+ *  integer indicating whether sampling succeeded (1), found no available
+ *  index on the grid (-1), or failed (0).
  */
-int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
-             tuple_t *x, tuple_t *N) {
+int jitsamp (qrng_t *G, const pdfview_t *pdf, double pjit,
+             unsigned char *mask, jitmax_t *M, tuple_t *x, jitlay_t *L) {
   /* declare required variables:
    *  @i: general-purpose loop index.
    *  @done: completion status of the region identification.
@@ -148,30 +526,26 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
   double pcur, p, pmax, d, dmax, *Yc;
   tuple_t Y, Yadj;
 
+  /* locate the most probable available index on the grid, and ensure
+   * that one was located.
+   */
+  imax = M->node[1];
+  if (imax == JIT_MAX_NONE)
+    return -1;
+
   /* initialize the region and adjacency tuples. */
   tupinit(&Y);
   tupinit(&Yadj);
 
   /* allocate the centroid array. */
-  Yc = (double*) calloc(tupsize(N), sizeof(double));
+  Yc = (double*) calloc(tupsize(L->N), sizeof(double));
   if (!Yc)
     return 0;
 
-  /* locate the most probable available index on the grid. */
-  for (i = 0, imax = 0; i < tupprod(N); i++) {
-    /* check for a better candidate. */
-    if (tupget(mask, i) && (!tupget(mask, imax) || pdf[i] > pdf[imax]))
-      imax = i;
-  }
-
-  /* ensure that a suitable index was located. */
-  if (!tupget(mask, imax))
-    return 1;
-
   /* append the index into the region tuple. */
   tupappend(&Y, imax);
-  jitcent(&Y, Yc, x, N);
-  pcur = pdf[imax];
+  jitcent(&Y, Yc, x, L);
+  pcur = pdfat(pdf, imax);
 
   /* loop until a new jittered region has been defined. */
   while (!done) {
@@ -179,8 +553,8 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
     tupfree(&Yadj);
 
     /* obtain a list of available adjacent indices. */
-    tupunpack(tupget(&Y, tupsize(&Y) - 1), N, x);
-    jitsearch(&Y, mask, x, N, &Yadj);
+    jitunpack(L, tupget(&Y, tupsize(&Y) - 1), x);
+    jitsearch(&Y, mask, x, L, &Yadj);
 
     /* ensure that candidates were found. */
     if (tupsize(&Yadj) == 0)
@@ -188,19 +562,19 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
 
     /* initialize the candidate search. */
     kmax = tupget(&Yadj, 0);
-    pmax = pdf[kmax];
+    pmax = pdfat(pdf, kmax);
 
     /* compute the initial best distance to centroid. */
-    dmax = jitdist(kmax, Yc, x, N);
+    dmax = jitdist(kmax, Yc, x, L);
 
     /* find the most probable adjacent candidate. */
     for (i = 1; i < tupsize(&Yadj); i++) {
       /* get the current probability value. */
       k = tupget(&Yadj, i);
-      p = pdf[k];
+      p = pdfat(pdf, k);
 
       /* compute the current distance to centroid. */
-      d = jitdist(k, Yc, x, N);
+      d = jitdist(k, Yc, x, L);
 
       /* check if the current index is a better one. */
       if (p > pmax || (p == pmax && d < dmax)) {
@@ -221,14 +595,14 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
 
     /* add the candidate index into the jittered region. */
     tupappend(&Y, kmax);
-    pcur += pdf[kmax];
-    jitcent(&Y, Yc, x, N);
+    pcur += pdfat(pdf, kmax);
+    jitcent(&Y, Yc, x, L);
   }
 
   /* identify the largest density value in the region. */
   for (i = 0, pmax = 0.0; i < tupsize(&Y); i++) {
     /* get the current density value. */
-    p = pdf[tupget(&Y, i)];
+    p = pdfat(pdf, tupget(&Y, i));
 
     /* update the maximum value. */
     if (p > pmax)
@@ -248,17 +622,22 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
     d = G->x[1] * pmax;
 
     /* extract the density value. */
-    p = pdf[tupget(&Y, imax)];
+    p = pdfat(pdf, tupget(&Y, imax));
   }
   while (d > p);
 
   /* retrieve the highest-ranked index from the jittered region. */
   i = tupget(&Y, imax);
-  tupunpack(i, N, x);
+  jitunpack(L, i, x);
 
-  /* mask off all indices in the jittered region. */
+  /* mask off all indices in the jittered region, and then remove them
+   * from the tree.
+   */
   for (i = 0; i < tupsize(&Y); i++)
-    tupset(mask, tupget(&Y, i), 0);
+    mask[tupget(&Y, i)] = 0;
+
+  for (i = 0; i < tupsize(&Y); i++)
+    jitmaxdrop(M, tupget(&Y, i));
 
   /* free the centroid array. */
   free(Yc);
@@ -272,126 +651,874 @@ int jitsamp (qrng_t *G, double *pdf, double pjit, tuple_t *mask,
   return 1;
 }
 
-/* jit(): generate a list of linear indices that represent the jittered
- * quasirandom sampling schedule over a multidimensional grid, given
- * a few input parameters.
+/* jittile(): sample the points of a single tile, using a density grid
+ * and region growth that are confined to the tile. each region targets
+ * the density mass left in the tile over the number of points left to
+ * sample, so regions shrink toward single points as the tile fills. a
+ * tile that still runs out of points keeps the points it sampled.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the threads.
+ *  @k: index of the tile.
+ *
+ * returns:
+ *  integer indicating whether sampling succeeded (1) or failed (0).
+ */
+int jittile (jitwork_t *W, unsigned int k) {
+  /* declare required variables:
+   *  @c: tile coordinates of the tile.
+   *  @S: sizes of the tile along each dimension.
+   *  @x, @y: global and local grid indices.
+   *  @mask: array of availability flags of each local index.
+   *  @L: linear storage order of the tile.
+   *  @M: tree of the most probable available point of the tile.
+   *  @G: quasirandom number generator of the tile.
+   *  @pdf: density values of the tile, normalized by their sum.
+   *  @V: view of the density values of the tile.
+   *  @sum: sum of the density values of the tile, or of those that are
+   *        still available.
+   *  @i, @j: dimension and grid point loop counters.
+   *  @o: first global index of the tile along a dimension.
+   *  @xi: packed global linear index.
+   */
+  tuple_t c, S, x, y;
+  unsigned int i, j, o, xi;
+  unsigned char *mask;
+  double *pdf, sum;
+  pdfview_t V;
+  jitlay_t L;
+  jitmax_t M;
+  qrng_t G;
+  int ret;
+
+  /* skip tiles that already hold their points, and clear the points of
+   * tiles that are sampled again with a larger share.
+   */
+  if (tupsize(W->out + k) == W->cnt[k])
+    return 1;
+
+  tupfree(W->out + k);
+
+  /* allocate the index tuples. */
+  if (!tupalloc(&c, tupsize(W->N)) || !tupalloc(&S, tupsize(W->N)) ||
+      !tupalloc(&x, tupsize(W->N)) || !tupalloc(&y, tupsize(W->N)))
+    return 0;
+
+  /* compute the sizes of the tile, which are smaller at the grid edges. */
+  tupunpack(k, W->T, &c);
+  for (i = 0; i < tupsize(W->N); i++) {
+    o = tupget(&c, i) * W->tile;
+    tupset(&S, i, (tupget(W->N, i) - o < W->tile ?
+                   tupget(W->N, i) - o : W->tile));
+  }
+
+  /* allocate the density values and mask of the tile. */
+  pdf = (double*) malloc(tupprod(&S) * sizeof(double));
+  mask = (unsigned char*) malloc(tupprod(&S));
+  if (!pdf || !mask || !qrngalloc(&G, 2))
+    return 0;
+
+  /* copy and sum the density values of the tile. */
+  jitlayout(&L, &S, 0);
+  for (j = 0, sum = 0.0; j < tupprod(&S); j++) {
+    L.P.unpack(&L.P, j, y.elem);
+    for (i = 0; i < tupsize(W->N); i++)
+      tupset(&x, i, tupget(&c, i) * W->tile + tupget(&y, i));
+
+    xi = W->P.pack(&W->P, x.elem);
+    pdf[j] = pdfat(&W->pdf, xi);
+    sum += pdf[j];
+  }
+
+  /* normalize the density values of the tile. */
+  for (j = 0; j < tupprod(&S) && sum > 0.0; j++)
+    pdf[j] /= sum;
+
+  /* view the density values of the tile in double precision. */
+  V.d = pdf;
+  V.f = NULL;
+
+  /* position the generator at the substream of the tile. */
+  qrngseek(&G, W->base + (unsigned long) k * JIT_TILE_TERMS);
+
+  /* sample the points of the tile. */
+  memset(mask, 1, tupprod(&S));
+  if (!jitmaxinit(&M, &V, mask, &L))
+    return 0;
+
+  for (j = 0, ret = 1; j < W->cnt[k] && ret == 1; j++) {
+    /* sum the density mass left in the tile. */
+    for (i = 0, sum = 0.0; i < tupprod(&S); i++)
+      sum += (mask[i] ? pdf[i] : 0.0);
+
+    /* sample a new point from the tile, unless it ran out of points. */
+    ret = jitsamp(&G, &V, sum / ((double) (W->cnt[k] - j)), mask, &M,
+                  &y, &L);
+    if (ret != 1)
+      break;
+
+    /* map the point back onto the grid and store it. */
+    for (i = 0; i < tupsize(W->N); i++)
+      tupset(&x, i, tupget(&c, i) * W->tile + tupget(&y, i));
+
+    xi = W->P.pack(&W->P, x.elem);
+    ret = tupappend(W->out + k, xi);
+  }
+
+  /* free the allocated memory. */
+  jitmaxfree(&M);
+  qrngfree(&G);
+  tupfree(&c);
+  tupfree(&S);
+  tupfree(&x);
+  tupfree(&y);
+  free(mask);
+  free(pdf);
+
+  /* return the sampling status. */
+  return (ret != 0);
+}
+
+/* jitthread(): claim and sample tiles until none remain, or a tile fails.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *jitthread (void *arg) {
+  /* declare required variables:
+   *  @W: pointer to the shared state of the threads.
+   *  @k: index of the claimed tile.
+   */
+  jitwork_t *W = (jitwork_t*) arg;
+  unsigned int k;
+
+  /* claim tiles until none remain, or a tile fails. */
+  while (__atomic_load_n(&W->ret, __ATOMIC_RELAXED)) {
+    k = __atomic_fetch_add(&W->next, 1, __ATOMIC_RELAXED);
+    if (k >= W->ntile)
+      break;
+
+    if (!jittile(W, k))
+      __atomic_store_n(&W->ret, 0, __ATOMIC_RELAXED);
+  }
+
+  return NULL;
+}
+
+/* jittiles(): sample a grid in independent tiles on several threads. each
+ * tile receives its share of the sampled points in proportion to its
+ * density mass, and its jittered regions never cross its edges, so the
+ * schedule does not depend on the number of threads.
+ *
+ * a share never exceeds the number of points in its tile. the points of
+ * any tile that runs out of points are carried into the following tiles
+ * in tile order, which are then sampled again, so that exactly n points
+ * are always sampled.
  *
  * arguments:
- *  @fn: string representation of the gap equation.
  *  @N: pointer to the tuple of Nyquist grid sizes.
- *  @d: desired sampling density.
- *  @lst: pointer to the output tuple of indices.
+ *  @pdf: pointer to the density values, normalized by their sum.
+ *  @n: number of points to sample.
+ *  @tile: edge length of each tile.
+ *  @nthr: number of threads to use.
+ *  @base: index of the first quasirandom term of the tile substreams.
+ *  @ord: pointer to the tuple to append samples to, in tile order.
+ *
+ * returns:
+ *  integer indicating whether sampling succeeded (1) or failed (0).
+ */
+int jittiles (tuple_t *N, const pdfview_t *pdf, unsigned int n,
+              unsigned int tile, unsigned int nthr, unsigned long base,
+              tuple_t *ord) {
+  /* declare required variables:
+   *  @W: shared state of the threads.
+   *  @P: index kernels of the tile counts.
+   *  @T: tuple of tile counts along each dimension.
+   *  @x: unpacked grid index.
+   *  @mass: density mass of each tile.
+   *  @cap: number of points each tile can hold.
+   *  @full: whether each tile is filled to its capacity.
+   *  @acc, @total: cumulative and total density mass of the open tiles.
+   *  @i, @k: general-purpose and tile loop counters.
+   *  @m: number of points apportioned over the open tiles.
+   *  @last: index of the last open tile.
+   *  @prev: cumulative point count of the preceding tiles.
+   *  @carry: number of points carried into the following tiles.
+   *  @more: whether the tiles must be apportioned or sampled again.
+   */
+  unsigned int i, k, m, last, prev, carry, *cap;
+  double *mass, acc, total;
+  unsigned char *full;
+  int more;
+  tupgrid_t P;
+  jitwork_t W;
+  tuple_t T, x;
+
+  /* check that the grid holds every point. */
+  if (n > tupprod(N)) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: cannot sample %u of %u grid points\n",
+            n, tupprod(N));
+    return 0;
+  }
+
+  /* count the tiles along each dimension. */
+  if (!tupalloc(&T, tupsize(N)) || !tupalloc(&x, tupsize(N)))
+    return 0;
+
+  for (i = 0; i < tupsize(N); i++)
+    tupset(&T, i, (tupget(N, i) + tile - 1) / tile);
+
+  /* initialize the shared state. */
+  W.N = N;
+  W.T = &T;
+  W.tile = tile;
+  W.pdf = *pdf;
+  W.base = base;
+  W.ntile = tupprod(&T);
+  W.next = 0;
+  W.ret = 1;
+  tupgridinit(&W.P, N);
+  tupgridinit(&P, &T);
+
+  /* allocate the per-tile arrays. */
+  mass = (double*) calloc(W.ntile, sizeof(double));
+  cap = (unsigned int*) calloc(W.ntile, sizeof(unsigned int));
+  full = (unsigned char*) calloc(W.ntile, sizeof(unsigned char));
+  W.cnt = (unsigned int*) calloc(W.ntile, sizeof(unsigned int));
+  W.out = (tuple_t*) calloc(W.ntile, sizeof(tuple_t));
+  if (!mass || !cap || !full || !W.cnt || !W.out)
+    return 0;
+
+  /* sum the density mass and count the points of each tile. */
+  for (i = 0; i < tupprod(N); i++) {
+    W.P.unpack(&W.P, i, x.elem);
+    for (k = 0; k < tupsize(N); k++)
+      tupset(&x, k, tupget(&x, k) / tile);
+
+    k = P.pack(&P, x.elem);
+    mass[k] += pdfat(pdf, i);
+    cap[k]++;
+  }
+
+  /* apportion the points by rounding the cumulative mass of the open
+   * tiles, which assigns every point and keeps each share within one
+   * point of its mass. tiles that cannot hold their share are filled and
+   * closed, and the points are apportioned again over the open tiles.
+   */
+  do {
+    /* remove the points of the full tiles, and sum the open mass. */
+    for (k = 0, m = n, total = 0.0, last = 0; k < W.ntile; k++) {
+      if (full[k]) {
+        m -= cap[k];
+      }
+      else {
+        total += mass[k];
+        last = k;
+      }
+    }
+
+    /* apportion the remaining points over the open tiles. */
+    for (k = 0, acc = 0.0, prev = 0, more = 0; k < W.ntile; k++) {
+      if (full[k])
+        continue;
+
+      acc += mass[k];
+      i = (k == last || total <= 0.0 ? m :
+           (unsigned int) round((double) m * acc / total));
+
+      W.cnt[k] = (i > prev ? i - prev : 0);
+      prev = (i > prev ? i : prev);
+
+      /* fill and close tiles that cannot hold their share. */
+      if (W.cnt[k] > cap[k]) {
+        W.cnt[k] = cap[k];
+        full[k] = 1;
+        more = 1;
+      }
+    }
+  }
+  while (more);
+
+  /* sample the tiles until every point has been placed, on no more
+   * threads than there are tiles.
+   */
+  nthr = (nthr < W.ntile ? nthr : W.ntile);
+  do {
+    /* sample the tiles from the first one. */
+    W.next = 0;
+    thrrun(jitthread, &W, nthr);
+
+    /* shrink the capacity of tiles that ran out of points to the points
+     * they hold, and carry their shortfall into the following tiles that
+     * can hold more points, wrapping around to the first tile.
+     */
+    for (i = 0, carry = 0, more = 0; W.ret && i < 2 * W.ntile; i++) {
+      k = i % W.ntile;
+      if (i < W.ntile && tupsize(W.out + k) < W.cnt[k]) {
+        carry += W.cnt[k] - tupsize(W.out + k);
+        W.cnt[k] = cap[k] = tupsize(W.out + k);
+      }
+      else if (carry && W.cnt[k] < cap[k]) {
+        m = (carry < cap[k] - W.cnt[k] ? carry : cap[k] - W.cnt[k]);
+        W.cnt[k] += m;
+        carry -= m;
+        more = 1;
+      }
+    }
+
+    /* fail if no tile can hold the remaining points. */
+    if (carry) {
+      fprintf(stderr, "error: tiles ran out of %u points\n", carry);
+      W.ret = 0;
+    }
+  }
+  while (W.ret && more);
+
+  /* append the samples of each tile. */
+  for (k = 0; k < W.ntile; k++) {
+    for (i = 0; i < tupsize(W.out + k); i++)
+      W.ret = (W.ret && tupappend(ord, tupget(W.out + k, i)));
+
+    tupfree(W.out + k);
+  }
+
+  /* free the allocated memory. */
+  free(mass);
+  free(cap);
+  free(full);
+  free(W.cnt);
+  free(W.out);
+  tupfree(&T);
+  tupfree(&x);
+
+  /* return the sampling status. */
+  return W.ret;
+}
+
+/* jitdraw(): draw the points of a jittered sampling schedule from an
+ * evaluated density grid, starting at a given term of the quasirandom
+ * sequence. the points are returned in the order they were drawn.
+ *
+ * points that were already sampled are placed first and masked off, and
+ * the draw only adds the remaining points. tiled draws cannot be extended.
+ *
+ * untiled draws may store the density values and the mask in z-order,
+ * which keeps the neighbors probed by region growth, and the points of
+ * each region, close in memory. the drawn points are identical in either
+ * order.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of grid sizes.
+ *  @pdf: pointer to the density values, normalized by their sum.
+ *  @n: number of points to sample.
+ *  @pjit: target probability of each sampling region.
+ *  @tile: edge length of independently sampled tiles, or zero.
+ *  @pre: pointer to the tuple of distinct points already sampled, or NULL.
+ *  @base: index of the first quasirandom term to draw.
+ *  @nthr: number of threads to sample tiles with.
+ *  @zorder: whether to store untiled grids in z-order.
+ *  @ord: pointer to the output tuple of indices, in draw order.
+ *  @end: pointer to the output index of the next undrawn term, or NULL.
  *
  * returns:
  *  integer indicating whether sampling succeeded (1) or not (0).
  */
-int jit (const char *fn, tuple_t *N, double d, tuple_t *lst) {
+int jitdraw (tuple_t *N, const pdfview_t *pdf, unsigned int n, double pjit,
+             unsigned int tile, tuple_t *pre, unsigned long base,
+             unsigned int nthr, int zorder, tuple_t *ord,
+             unsigned long *end) {
   /* declare required variables:
-   *  @pdf: probability density function, evaluated on the grid.
-   *  @pdfsum: summed values of @pdf over the entire data grid.
-   *  @x: unpacked grid point index for density evaluation.
-   *  @Tlst: binary search tree for index storage.
+   *  @x: unpacked grid point index of each sample.
+   *  @mask: array of availability flags of each stored index.
+   *  @L: storage order of the density values and the mask.
+   *  @M: tree of the most probable available point.
+   *  @V: view of the stored density values.
+   *  @zpdf: density values in z-order, or NULL.
    *  @G: quasirandom number generator structure.
    *  @i: term generation loop counter.
-   *  @n: term generation loop size.
-   *  @xi: packed linear index.
+   *  @xi: packed linear or stored index.
+   *  @ret: status of each sample.
    */
-  unsigned int i, n, xi;
-  double *pdf, pdfsum;
-  tuple_t x, mask;
-  bst_t *Tlst;
+  unsigned char *mask;
+  unsigned int i, xi;
+  pdfview_t V;
+  void *zpdf;
+  jitlay_t L;
+  jitmax_t M;
   qrng_t G;
+  tuple_t x;
+  int ret;
 
   /* initialize the output tuple. */
-  tupinit(lst);
+  tupinit(ord);
 
-  /* initialize the binary search tree. */
-  Tlst = NULL;
+  /* sample the grid in independent tiles, if requested. */
+  if (tile) {
+    if (!jittiles(N, pdf, n, tile, (nthr > 1 ? nthr : 1), base, ord)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to sample grid tiles\n");
+      return 0;
+    }
 
-  /* allocate the index and mask tuples. */
-  if (!tupalloc(&x, tupsize(N)) ||
-      !tupalloc(&mask, tupprod(N))) {
+    return 1;
+  }
+
+  /* allocate the index tuple and the mask, which is stored like a grid
+   * of density values.
+   */
+  jitlayout(&L, N, zorder);
+  mask = (unsigned char*) pdfalloc(L.n);
+  if (!tupalloc(&x, tupsize(N)) || !mask) {
     /* output an error message and return failure. */
     fprintf(stderr, "error: failed to allocate tuples\n");
     return 0;
   }
 
-  /* initialize the density function evaluation environment. */
-  if (!evalinit(fn, EVAL_PDF)) {
-    /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to compile density equation\n");
-    return 0;
+  /* initialize the mask, and reorder the density values into z-order in
+   * the precision they are stored in. the padding of the z-order grid is
+   * masked off.
+   */
+  V = *pdf;
+  zpdf = NULL;
+  if (L.z) {
+    zpdf = pdfalloc((size_t) L.n * (pdf->f ? sizeof(float) :
+                                             sizeof(double)));
+    if (!zpdf) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate z-order grid\n");
+      return 0;
+    }
+
+    memset(mask, 0, L.n);
+    for (i = 0; i < tupprod(N); i++) {
+      L.P.unpack(&L.P, i, x.elem);
+      xi = jitpack(&L, &x);
+      if (pdf->f)
+        ((float*) zpdf)[xi] = pdf->f[i];
+      else
+        ((double*) zpdf)[xi] = pdf->d[i];
+
+      mask[xi] = 1;
+    }
+
+    V.d = (pdf->f ? NULL : (double*) zpdf);
+    V.f = (pdf->f ? (float*) zpdf : NULL);
   }
+  else
+    memset(mask, 1, L.n);
 
-  /* initialize the quasirandom number generator. */
+  /* initialize the quasirandom number generator, and position it at the
+   * first term to draw.
+   */
   if (!qrngalloc(&G, 2)) {
     /* output an error message and return failure. */
     fprintf(stderr, "error: failed to initialize quasirandom generator\n");
     return 0;
   }
 
-  /* run the generator into a more suitable region. */
-  for (i = 0; i < 100; i++)
-    qrngeval(&G);
+  qrngseek(&G, base);
+
+  /* place and mask off the points that were already sampled. */
+  for (i = 0; pre && i < tupsize(pre); i++) {
+    L.P.unpack(&L.P, tupget(pre, i), x.elem);
+    mask[jitpack(&L, &x)] = 0;
+    if (!tupappend(ord, tupget(pre, i)))
+      return 0;
+  }
+
+  /* build the tree of the most probable available point. */
+  if (!jitmaxinit(&M, &V, mask, &L)) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate density tree\n");
+    return 0;
+  }
+
+  /* loop over the number of grid points to compute. */
+  for (i = tupsize(ord); i < n; i++) {
+    /* sample a new point from the grid, or stop when it is exhausted. */
+    ret = jitsamp(&G, &V, pjit, mask, &M, &x, &L);
+    if (!ret)
+      return 0;
+    else if (ret < 0) {
+      /* output a warning message and stop drawing. */
+      fprintf(stderr, "warning: grid exhausted after %u of %u points\n",
+              i, n);
+      break;
+    }
+
+    /* pack and store the new value as a linear index. */
+    xi = L.P.pack(&L.P, x.elem);
+    if (!tupappend(ord, xi))
+      return 0;
+  }
+
+  /* store the next undrawn term, and free the allocated tuples, the
+   * tree and the quasirandom number generator.
+   */
+  if (end)
+    *end = qrngtell(&G);
+
+  jitmaxfree(&M);
+  pdfrelease(zpdf);
+  pdfrelease(mask);
+  tupfree(&x);
+  qrngfree(&G);
+
+  /* return success. */
+  return 1;
+}
+
+/* jitnest(): select a subset of drawn points as the schedule of a smaller
+ * density. jittered regions are drawn from the most to the least probable,
+ * so the points are taken in bit-reversed draw order, which spreads every
+ * subset evenly over the draw. each subset contains all smaller ones.
+ * points that were already sampled before the draw are selected first.
+ *
+ * arguments:
+ *  @ord: pointer to the tuple of drawn indices, in draw order.
+ *  @npre: number of leading indices that were already sampled.
+ *  @m: number of points to select.
+ *  @lst: pointer to the output tuple of sorted indices.
+ */
+void jitnest (tuple_t *ord, unsigned int npre, unsigned int m,
+              tuple_t *lst) {
+  /* declare required variables:
+   *  @Tlst: binary search tree for sorting the selected points.
+   *  @b: number of bits needed to index the drawn points.
+   *  @i, @k, @r: selection counter, bit counter and reversed index.
+   *  @nsel, @ndraw: numbers of selected and newly drawn points.
+   */
+  unsigned int b, i, k, r, nsel, ndraw;
+  bst_t *Tlst;
+
+  /* select the points that were already sampled. */
+  for (nsel = 0, Tlst = NULL; nsel < m && nsel < npre; nsel++)
+    Tlst = bstinsert(Tlst, tupget(ord, nsel));
+
+  /* count the bits needed to index every newly drawn point. */
+  ndraw = tupsize(ord) - npre;
+  for (b = 0; b < 32 && (1UL << b) < ndraw; b++);
+
+  /* select the new points in bit-reversed order. */
+  for (i = 0; nsel < m && i < (1UL << b); i++) {
+    /* reverse the bits of the selection counter. */
+    for (k = 0, r = 0; k < b; k++)
+      r |= ((i >> k) & 1) << (b - 1 - k);
+
+    /* select the point, if it was drawn. */
+    if (r < ndraw) {
+      Tlst = bstinsert(Tlst, tupget(ord, npre + r));
+      nsel++;
+    }
+  }
+
+  /* dump the sorted selection from the search tree. */
+  bstsort(Tlst, lst);
+  bstfree(Tlst);
+}
+
+/* jitmember(): claim and draw the members of a schedule ensemble until
+ * none remain, or a member fails.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the ensemble threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *jitmember (void *arg) {
+  /* declare required variables:
+   *  @E: pointer to the shared state of the ensemble threads.
+   *  @e: index of the claimed member.
+   *  @j: density loop counter.
+   *  @base: first quasirandom term of the member.
+   *  @ord: points of the member, in draw order.
+   */
+  jitens_t *E = (jitens_t*) arg;
+  unsigned int e, j;
+  unsigned long base;
+  tuple_t ord;
+
+  /* claim members until none remain, or a member fails. */
+  while (__atomic_load_n(&E->ret, __ATOMIC_RELAXED)) {
+    e = __atomic_fetch_add(&E->next, 1, __ATOMIC_RELAXED);
+    if (e >= E->nens)
+      break;
+
+    /* draw the member from its own substream, or resume a single member
+     * from a given term.
+     */
+    base = JIT_WARMUP + ((unsigned long) e * E->nshard + E->shard) *
+           JIT_SHARD_TERMS;
+    base = (E->nens == 1 && E->pos ? E->pos : base);
+    if (!jitdraw(E->N, &E->pdf, E->n, E->pjit, E->tile, E->pre, base,
+                 E->nthr, E->zorder, &ord,
+                 E->nens == 1 ? &E->pos : NULL)) {
+      __atomic_store_n(&E->ret, 0, __ATOMIC_RELAXED);
+      break;
+    }
+
+    /* select the schedule of each density from the drawn points. */
+    for (j = 0; j < E->nd; j++)
+      jitnest(&ord, tupsize(E->pre), E->cnt[j], E->lst + e * E->nd + j);
+
+    /* free the drawn points. */
+    tupfree(&ord);
+  }
+
+  return NULL;
+}
+
+/* jit(): generate a list of linear indices that represent the jittered
+ * quasirandom sampling schedule over a multidimensional grid, given
+ * a few input parameters.
+ *
+ * arguments:
+ *  @E: pointer to the evaluation context of the density function.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @d: array of desired sampling densities.
+ *  @nd: number of sampling densities.
+ *  @opt: pointer to the sampling options.
+ *  @lst: array of output tuples of indices, holding the schedule of each
+ *        density for the first ensemble member, then the second, etc.
+ *
+ * returns:
+ *  integer indicating whether sampling succeeded (1) or not (0).
+ */
+int jit (evalctx_t *E, tuple_t *N, const double *d, unsigned int nd,
+         const jitopt_t *opt, tuple_t *lst) {
+  /* declare required variables:
+   *  @pdf: probability density function, evaluated on the grid.
+   *  @M: shared state of the ensemble threads.
+   *  @n: term generation loop size.
+   *  @cnt: number of points in the schedule of each density.
+   *  @Nk: grid sizes of the sampled shard.
+   *  @lo, @hi: first and final (exclusive) linear indices of the sampled
+   *            shard.
+   *  @mass: fraction of the density mass in the sampled shard.
+   *  @c: cumulative density mass at the edges of an evaluated shard.
+   *  @pk: density values of the sampled shard.
+   *  @flt: single precision density values of the sampled shard.
+   *  @V: view of the sampled density values.
+   *  @pre: distinct points already sampled within the shard.
+   *  @Tpre: binary search tree for removing duplicate points.
+   *  @e, @j, @k: member, density and index loop counters.
+   *  @nthr: number of ensemble threads.
+   */
+  unsigned int n, lo, hi, e, j, k, nthr, *cnt;
+  double *pdf, *pk, mass, c[3];
+  pdfview_t V;
+  float *flt;
+  tuple_t Nk, pre;
+  bst_t *Tpre;
+  jitens_t M;
+
+  /* initialize the output tuples. */
+  for (e = 0; e < opt->nens * nd; e++)
+    tupinit(lst + e);
+
+  /* check that only a single untiled schedule is extended or resumed. */
+  if ((opt->pre || opt->pos) && opt->tile) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: tiled schedules cannot be extended\n");
+    return 0;
+  }
+  else if (opt->pos && opt->nens > 1) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: an ensemble cannot be resumed\n");
+    return 0;
+  }
+
+  /* allocate the schedule sizes. */
+  cnt = (unsigned int*) calloc(nd, sizeof(unsigned int));
+  if (!cnt) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate schedule sizes\n");
+    return 0;
+  }
 
-  /* allocate the density values array. */
-  pdf = (double*) calloc(tupprod(N), sizeof(double));
-  if (!pdf) {
+  /* evaluate the densities, normalized by their sum, unless they were
+   * given. a single shard only keeps its own values, and single precision
+   * grids are evaluated without a double precision copy.
+   */
+  pdf = NULL;
+  flt = NULL;
+  if (opt->pdf)
+    pdf = opt->pdf;
+  else if (opt->nshard > 1)
+    pdf = pdfslab(E, N, PDF_NORM_SUM, opt->shard, opt->nshard, opt->nthr, c);
+  else if (opt->prec == PDF_PREC_FLOAT)
+    flt = pdfgrid32(E, N, PDF_NORM_SUM, opt->nthr, opt->err);
+  else
+    pdf = pdfgrid(E, N, PDF_NORM_SUM, opt->nthr);
+
+  if (!pdf && !flt) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to allocate density values array\n");
+    fprintf(stderr, "error: failed to evaluate density values array\n");
     return 0;
   }
 
-  /* compute the desired number of sampled grid points. */
-  n = (unsigned int) round(d * (double) tupprod(N));
+  /* compute the desired number of sampled grid points of each density,
+   * and draw enough points for the largest.
+   */
+  for (j = 0, n = 0; j < nd; j++) {
+    cnt[j] = (unsigned int) round(d[j] * (double) tupprod(N));
 
-  /* loop over the grid points. */
-  for (i = 0, pdfsum = 0.0; i < tupprod(N); i++) {
-    /* unpack the linear index. */
-    tupunpack(i, N, &x);
+    /* restrict sampling to a single shard of the grid, if requested. */
+    if (opt->nshard > 1 && opt->pdf) {
+      if (!pdfshard(N, pdf, cnt[j], opt->shard, opt->nshard,
+                    &Nk, &lo, cnt + j, &mass)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compute grid shard\n");
+        return 0;
+      }
+    }
+    else if (opt->nshard > 1) {
+      /* a shard of an evaluated grid only holds its own values, and its
+       * points are apportioned by the sums of the evaluation.
+       */
+      if (!pdfrows(N, opt->shard, opt->nshard, &Nk, &lo, &hi)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compute grid shard\n");
+        return 0;
+      }
 
-    /* evaluate the density function. */
-    if (evalpdf(pdf + i, &x, N) != EVAL_OK)
+      pdfsplit(c, cnt[j], opt->shard, opt->nshard, cnt + j, &mass);
+    }
+    else if (tupdup(&Nk, N)) {
+      /* sample the entire grid. */
+      mass = 1.0;
+      lo = 0;
+    }
+    else {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate tuples\n");
       return 0;
+    }
 
-    /* sum the current value into the normalization factor. */
-    pdfsum += pdf[i];
+    /* keep the shard sizes of the final density. */
+    n = (cnt[j] > n ? cnt[j] : n);
+    if (j < nd - 1)
+      tupfree(&Nk);
   }
 
-  /* normalize the evaluated densities. */
-  for (i = 0; i < tupprod(N); i++)
-    pdf[i] /= pdfsum;
+  /* locate the density values of the sampled shard, which are the only
+   * values of an evaluated shard.
+   */
+  pk = (!pdf ? NULL : opt->pdf || opt->nshard <= 1 ? pdf + lo : pdf);
 
-  /* compute the target probability of each sampling region. */
-  pdfsum = 1.0 / ((double) n);
+  /* narrow the values of the sampled shard to single precision, if they
+   * were not evaluated that way.
+   */
+  if (opt->prec == PDF_PREC_FLOAT && !flt) {
+    flt = pdfnarrow(pk, tupprod(&Nk), opt->err);
+    if (!flt) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate density values\n");
+      return 0;
+    }
 
-  /* initialize the mask. */
-  tupfill(&mask, 1);
+    /* release the double precision values, unless they were given. */
+    if (!opt->pdf)
+      pdfrelease(pdf);
 
-  /* loop over the number of grid points to compute. */
-  for (i = 0; i < n; i++) {
-    /* sample a new point from the grid. */
-    if (!jitsamp(&G, pdf, pdfsum, &mask, &x, N))
+    pdf = NULL;
+  }
+
+  /* view the sampled density values. */
+  V.d = (flt ? NULL : pk);
+  V.f = flt;
+
+  /* gather the distinct points already sampled within the shard, and
+   * remove their density from the mass left to the new points.
+   */
+  tupinit(&pre);
+  for (k = 0, Tpre = NULL; opt->pre && k < tupsize(opt->pre); k++) {
+    e = tupget(opt->pre, k);
+    if (e < lo || e - lo >= tupprod(&Nk))
+      continue;
+
+    j = (Tpre ? Tpre->n + 1 : 0);
+    Tpre = bstinsert(Tpre, e - lo);
+    if (Tpre->n + 1 == j)
+      continue;
+
+    mass -= pdfat(&V, e - lo);
+    if (!tupappend(&pre, e - lo)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate sampled points\n");
       return 0;
+    }
+  }
+
+  /* free the duplicate search tree. */
+  bstfree(Tpre);
+
+  /* initialize the shared state of the ensemble threads. each member is
+   * drawn by one thread, and the remaining threads sample its tiles.
+   */
+  nthr = (opt->nthr > 1 ? opt->nthr : 1);
+  nthr = (nthr < opt->nens ? nthr : opt->nens);
+  M.N = &Nk;
+  M.pdf = V;
+  M.lst = lst;
+  M.pjit = (n > tupsize(&pre) ?
+            mass / ((double) (n - tupsize(&pre))) : mass);
+  M.cnt = cnt;
+  M.pre = &pre;
+  M.pos = (opt->pos ? *opt->pos : 0);
+  M.n = n;
+  M.nd = nd;
+  M.tile = opt->tile;
+  M.shard = (opt->nshard > 1 ? opt->shard : 0);
+  M.nshard = (opt->nshard > 1 ? opt->nshard : 1);
+  M.nens = opt->nens;
+  M.nthr = (opt->nthr > nthr ? opt->nthr / nthr : 1);
+  M.zorder = opt->zorder;
+  M.next = 0;
+  M.ret = 1;
+
+  /* draw the members on the ensemble threads. */
+  thrrun(jitmember, &M, nthr);
 
-    /* pack and insert the new value into the search tree. */
-    tuppack(&x, N, &xi);
-    Tlst = bstinsert(Tlst, xi);
+  /* check that every member was drawn. */
+  if (!M.ret)
+    return 0;
+
+  /* count the points that the schedules lack, if the grid was exhausted
+   * before the largest density was reached.
+   */
+  if (opt->miss) {
+    *opt->miss = 0;
+    for (e = 0; e < opt->nens * nd; e++) {
+      if (tupsize(lst + e) < cnt[e % nd])
+        *opt->miss += cnt[e % nd] - tupsize(lst + e);
+    }
   }
 
-  /* dumped the sorted samples from the search tree. */
-  bstsort(Tlst, lst);
-  bstfree(Tlst);
+  /* store the term to resume the schedule from. */
+  if (opt->pos)
+    *opt->pos = M.pos;
 
-  /* free the allocated tuples. */
-  tupfree(&mask);
-  tupfree(&x);
+  /* shift the samples from the shard grid onto the entire grid. */
+  for (e = 0; e < opt->nens * nd; e++) {
+    for (k = 0; k < tupsize(lst + e); k++)
+      tupset(lst + e, k, tupget(lst + e, k) + lo);
+  }
 
-  /* free the quasirandom number generator and density array. */
-  qrngfree(&G);
-  free(pdf);
+  /* free the allocated memory. */
+  tupfree(&pre);
+  tupfree(&Nk);
+  free(cnt);
+  if (!opt->pdf)
+    pdfrelease(pdf);
+
+  pdfrelease(flt);
 
   /* return success. */
   return 1;
 }
-
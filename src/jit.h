@@ -29,18 +29,214 @@
 #include <stdlib.h>
 #include <math.h>
 
+/* include the posix threads header. */
+#include <pthread.h>
+
+/* include the bit manipulation intrinsics, if they are available. */
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 /* include the julia library header. */
 #include <julia.h>
 
-/* include the tuple, search tree, qrng and evaluation headers. */
+/* include the tuple, search tree, qrng, evaluation, density grid and
+ * thread headers.
+ */
 #include "tup.h"
 #include "bst.h"
 #include "qrng.h"
 #include "eval.h"
+#include "pdf.h"
+#include "thr.h"
+
+/* define the number of quasirandom terms skipped before sampling, and the
+ * spacing between the quasirandom substreams of successive tiles, and of
+ * successive grid shards and ensemble members.
+ */
+#define JIT_WARMUP       100UL
+#define JIT_TILE_TERMS   1048573UL
+#define JIT_SHARD_TERMS  4294967291UL
+
+/* define the largest number of bits in a z-order grid index. */
+#define JIT_ZBITS  32
+
+/* define the number of stored indices in each leaf of the tree that
+ * locates the most probable available point, and the empty node value.
+ */
+#define JIT_MAX_BLOCK  64
+#define JIT_MAX_NONE   0xffffffffU
+
+/* jitlay_t: type definition of the storage order of the density values
+ * and the mask of a grid. linear grids vary fastest along the first
+ * dimension. z-order grids interleave the bits of the indices along each
+ * dimension, so the neighbors of a point along every dimension are stored
+ * close to it. z-order grids are padded to a power of two along each
+ * dimension, and the padding is never sampled.
+ */
+typedef struct {
+  /* @N: pointer to the tuple of grid sizes.
+   * @n: number of stored points, including any padding.
+   * @z: whether the grid is stored in z-order (1) or linearly (0).
+   * @P: index kernels of the linear order.
+   */
+  tuple_t *N;
+  unsigned int n;
+  int z;
+  tupgrid_t P;
+
+  /* @zm: bits of z-order indices that hold the index of each dimension.
+   * @st: linear strides of each dimension.
+   * @lt: linear index contributed by each value of each byte of a
+   *      z-order index.
+   */
+  unsigned int zm[JIT_ZBITS], st[JIT_ZBITS];
+  unsigned int lt[JIT_ZBITS / 8][256];
+}
+jitlay_t;
+
+/* jitmax_t: type definition of a tournament tree over the stored indices
+ * of a grid, which locates its most probable available point. each leaf
+ * holds the best point of a block of stored indices, and every other node
+ * the better of its two children, so masking off a point only revisits
+ * its block and the nodes above it. ties are won by the smallest linear
+ * index, in either storage order.
+ */
+typedef struct {
+  /* @pdf: pointer to the view of the stored density values.
+   * @mask: array of availability flags of each stored index.
+   * @L: pointer to the storage order of the grid.
+   */
+  const pdfview_t *pdf;
+  const unsigned char *mask;
+  jitlay_t *L;
+
+  /* @nleaf: number of leaves, which is a power of two.
+   * @node: best stored index below each node, or JIT_MAX_NONE. the root
+   *        is the second node, and the leaves are the last @nleaf nodes.
+   */
+  unsigned int nleaf;
+  unsigned int *node;
+}
+jitmax_t;
+
+/* jitwork_t: type definition of the shared state of the threads that
+ * sample the tiles of a grid.
+ */
+typedef struct {
+  /* @N: pointer to the tuple of Nyquist grid sizes.
+   * @T: pointer to the tuple of tile counts along each dimension.
+   * @P: index kernels of the grid.
+   * @tile: edge length of each tile.
+   * @pdf: view of the normalized density values.
+   * @base: index of the first quasirandom term of the tile substreams.
+   */
+  tuple_t *N, *T;
+  tupgrid_t P;
+  unsigned int tile;
+  pdfview_t pdf;
+  unsigned long base;
+
+  /* @cnt: number of points to sample from each tile.
+   * @out: sampled linear indices of each tile.
+   */
+  unsigned int *cnt;
+  tuple_t *out;
+
+  /* @ntile: number of tiles.
+   * @next: index of the next tile to claim.
+   * @ret: status of the sampling.
+   */
+  unsigned int ntile, next;
+  int ret;
+}
+jitwork_t;
+
+/* jitens_t: type definition of the shared state of the threads that draw
+ * the members of a schedule ensemble.
+ */
+typedef struct {
+  /* @N: pointer to the tuple of shard grid sizes.
+   * @pdf: view of the normalized density values of the shard.
+   * @lst: array of output tuples of each member and density.
+   * @cnt: number of points in the schedule of each density.
+   * @pjit: target probability of each sampling region.
+   * @pre: pointer to the tuple of points already in every schedule.
+   */
+  tuple_t *N;
+  pdfview_t pdf;
+  tuple_t *lst;
+  unsigned int *cnt;
+  double pjit;
+  tuple_t *pre;
+
+  /* @pos: first quasirandom term of a single member, or zero to start
+   *       at its substream. updated to the next undrawn term.
+   */
+  unsigned long pos;
+
+  /* @n: number of points to draw for the largest density.
+   * @nd: number of sampling densities.
+   * @tile: edge length of independently sampled tiles, or zero.
+   * @shard, @nshard: index and number of grid shards.
+   * @nens: number of ensemble members.
+   * @nthr: number of threads to sample the tiles of each member with.
+   * @next: index of the next member to claim.
+   * @zorder: whether untiled members are drawn on z-order grids.
+   * @ret: status of the ensemble.
+   */
+  unsigned int n, nd, tile, shard, nshard, nens, nthr, next;
+  int zorder, ret;
+}
+jitens_t;
+
+/* jitopt_t: type definition of the options of jittered sampling. */
+typedef struct {
+  /* @nthr: number of threads to evaluate and sample the density with.
+   * @tile: edge length of independently sampled tiles, or zero.
+   * @shard: index of the grid shard to sample, in [0,nshard).
+   * @nshard: number of grid shards, or one to sample the entire grid.
+   * @nens: number of decorrelated schedules to draw.
+   * @zorder: whether untiled grids are stored in z-order while sampling,
+   *          which yields the same schedules.
+   */
+  unsigned int nthr, tile, shard, nshard, nens;
+  int zorder;
+
+  /* @pre: pointer to the tuple of packed indices already sampled, which
+   *       every schedule is extended from, or NULL.
+   * @pos: pointer to the quasirandom term to resume a single schedule
+   *       from, or NULL. a zero term starts at the substream of the
+   *       shard. updated to the next undrawn term.
+   */
+  tuple_t *pre;
+  unsigned long *pos;
+
+  /* @pdf: density values on the entire grid, normalized by their sum
+   *       as computed by pdfgrid(), or NULL to evaluate them. the values
+   *       are only read, and remain owned by the caller.
+   */
+  double *pdf;
+
+  /* @prec: precision of the sampled density values. single precision
+   *        halves their memory, and given values are narrowed.
+   * @err: pointer to the output maximum relative error of the single
+   *       precision values, or NULL.
+   */
+  pdfprec_t prec;
+  double *err;
+
+  /* @miss: pointer to the output number of points that the schedules
+   *        lack after the grid was exhausted, or NULL.
+   */
+  unsigned int *miss;
+}
+jitopt_t;
 
 /* function declarations: */
 
-int jit (const char *fn, tuple_t *N, double d, tuple_t *lst);
+int jit (evalctx_t *E, tuple_t *N, const double *d, unsigned int nd,
+         const jitopt_t *opt, tuple_t *lst);
 
 #endif /* !__NUSUTILS_JIT_H__ */
 
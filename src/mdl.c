@@ -0,0 +1,268 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the count model header. */
+#include "mdl.h"
+
+/* define constants that determine the behavior of the mdlguess() solver.
+ */
+#define MDL_MAX_ITER  100     /* maximum number of bisection iterations. */
+#define MDL_EPSILON   1.0e-6  /* relative width of the final bracket. */
+
+/* define the number of midpoint rule intervals used by mdlcount() to
+ * integrate the point density over each grid cell.
+ */
+#define MDL_SUBDIV  16
+
+/* mdltype(): identify whether a gap equation string is a bare call to
+ * one of the preprogrammed gap equations that has a count model. the
+ * sine-burst equation is left unmodeled, as its bursts are narrower than
+ * its steps at useful scaling factors.
+ *
+ * arguments:
+ *  @fn: string representation of the gap equation.
+ *
+ * returns:
+ *  the preprogrammed equation type, or MDL_NONE.
+ */
+mdltype_t mdltype (const char *fn) {
+  /* declare required variables:
+   *  @buf: whitespace-free copy of the equation string.
+   *  @i, @j: character indices.
+   */
+  char buf[64];
+  unsigned int i, j;
+
+  /* copy the string without whitespace, giving up on long strings. */
+  for (i = 0, j = 0; fn[i]; i++) {
+    if (fn[i] == ' ' || fn[i] == '\t' || fn[i] == '\n')
+      continue;
+
+    if (j >= sizeof(buf) - 1)
+      return MDL_NONE;
+
+    buf[j++] = fn[i];
+  }
+  buf[j] = '\0';
+
+  /* compare the string against the preprogrammed calls. */
+  if (strcmp(buf, "sinegap(x,d,O,N,L)") == 0)
+    return MDL_SINEGAP;
+  else if (strcmp(buf, "poissongap(x,d,O,N,L)") == 0)
+    return MDL_POISSONGAP;
+
+  /* the string holds an arbitrary equation. */
+  return MDL_NONE;
+}
+
+/* mdlhist(): compute the number of grid points having each possible sum
+ * of their grid indices.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @nH: pointer to the output histogram size.
+ *
+ * returns:
+ *  newly allocated histogram array, or null on failure.
+ */
+double *mdlhist (tuple_t *N, unsigned int *nH) {
+  /* declare required variables:
+   *  @i, @s, @j: dimension, sum and index loop counters.
+   *  @ns: number of sums reachable by the current dimensions.
+   *  @H, @Hnew: current and next histogram arrays.
+   */
+  unsigned int i, s, j, ns;
+  double *H, *Hnew;
+
+  /* allocate the histogram arrays. */
+  *nH = tupsum(N) - tupsize(N) + 1;
+  H = (double*) calloc(*nH, sizeof(double));
+  Hnew = (double*) calloc(*nH, sizeof(double));
+  if (!H || !Hnew) {
+    free(H);
+    free(Hnew);
+    return NULL;
+  }
+
+  /* a zero-dimensional grid has a single point, with a zero sum. */
+  H[0] = 1.0;
+  ns = 1;
+
+  /* convolve in the uniform index distribution of each dimension. */
+  for (i = 0; i < tupsize(N); i++) {
+    memset(Hnew, 0, *nH * sizeof(double));
+    for (s = 0; s < ns; s++) {
+      for (j = 0; j < tupget(N, i); j++)
+        Hnew[s + j] += H[s];
+    }
+
+    /* store the new histogram. */
+    memcpy(H, Hnew, *nH * sizeof(double));
+    ns += tupget(N, i) - 1;
+  }
+
+  /* free the temporary array and return the histogram. */
+  free(Hnew);
+  return H;
+}
+
+/* mdlcount(): compute the expected number of distinct points placed on
+ * the grid by a preprogrammed gap equation.
+ *
+ * the gap sequence along a line places points at a local density equal
+ * to the reciprocal of its expected step size, 1 + L * f(theta), where
+ * theta = (x + sum(O)) / sum(N). a grid point y is hit when the term x
+ * along a line through y rounds to y[d] + 1, so its hit probability is
+ * the density integrated over (sum(y) + 1/2, sum(y) + 3/2) in units of
+ * sum(N) on lines of every direction. assuming the lines through a point
+ * miss it independently, the count only depends on the histogram of grid
+ * index sums. lines in each direction are traversed (D - 1)! times by
+ * seqfn(), which only places new points for the quasirandom poisson-gap
+ * equation.
+ *
+ * arguments:
+ *  @type: preprogrammed equation type.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @H: histogram of grid index sums.
+ *  @nH: size of the histogram.
+ *  @L: sequence term scaling factor.
+ *
+ * returns:
+ *  expected number of distinct points.
+ */
+double mdlcount (mdltype_t type, tuple_t *N, double *H, unsigned int nH,
+                 double L) {
+  /* declare required variables:
+   *  @s, @c, @k: grid index sum, direction and interval loop counters.
+   *  @m: number of times each line is traversed.
+   *  @theta: angular term value.
+   *  @f: unscaled gap equation value.
+   *  @p: probability that a grid point is hit by a single line.
+   *  @q: probability that a grid point is missed by all lines.
+   *  @n: expected point count.
+   */
+  unsigned int s, c, k, m;
+  double theta, f, p, q, n;
+
+  /* compute the effective number of traversals of each line. */
+  for (c = 1, m = 1; c < tupsize(N); c++)
+    m *= (type == MDL_POISSONGAP ? c : 1);
+
+  /* loop over the grid index sums. */
+  for (s = 0, n = 0.0; s < nH; s++) {
+    /* compute the probability of missing the point along each direction. */
+    for (c = 0, q = 1.0; c < tupsize(N); c++) {
+      /* integrate the point density over the grid cell. */
+      for (k = 0, p = 0.0; k < MDL_SUBDIV; k++) {
+        /* compute the angular term value at the interval midpoint. */
+        theta = ((double) s + 0.5 + ((double) k + 0.5) / MDL_SUBDIV) /
+                (double) tupsum(N);
+
+        /* compute the unscaled gap size. */
+        f = sin((M_PI / 2.0) * theta);
+
+        /* sum the density over the interval. */
+        p += 1.0 / (1.0 + L * f) / MDL_SUBDIV;
+      }
+
+      /* include the misses of every traversal of the line. */
+      q *= pow(1.0 - p, (double) m);
+    }
+
+    /* sum the expected hits at the current sum. */
+    n += H[s] * (1.0 - q);
+  }
+
+  /* return the computed result. */
+  return n;
+}
+
+/* mdlguess(): predict the scaling factor at which a preprogrammed gap
+ * equation places a given number of points on the grid, by bisection
+ * of the count model computed by mdlcount().
+ *
+ * arguments:
+ *  @fn: string representation of the gap equation.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @n: desired number of sampled grid points.
+ *  @L: pointer to the output scaling factor.
+ *
+ * returns:
+ *  integer indicating whether a prediction was made (1) or whether the
+ *  equation has no count model (0).
+ */
+int mdlguess (const char *fn, tuple_t *N, double n, double *L) {
+  /* declare required variables:
+   *  @type: preprogrammed equation type.
+   *  @H: histogram of grid index sums.
+   *  @nH: size of the histogram.
+   *  @iter: bisection iteration counter.
+   *  @Llo, @Lhi: bracket of scaling factors.
+   */
+  unsigned int nH, iter;
+  double *H, Llo, Lhi;
+  mdltype_t type;
+
+  /* check that the equation has a count model. */
+  type = mdltype(fn);
+  if (type == MDL_NONE || n <= 0.0 || n >= (double) tupprod(N))
+    return 0;
+
+  /* compute the histogram of grid index sums. */
+  H = mdlhist(N, &nH);
+  if (!H)
+    return 0;
+
+  /* grow the bracket until its upper end gives too few points. */
+  for (iter = 0, Llo = 0.0, Lhi = 1.0; iter < MDL_MAX_ITER; iter++) {
+    if (mdlcount(type, N, H, nH, Lhi) < n)
+      break;
+
+    Llo = Lhi;
+    Lhi *= 2.0;
+  }
+
+  /* give up if the model never places few enough points. */
+  if (iter == MDL_MAX_ITER) {
+    free(H);
+    return 0;
+  }
+
+  /* bisect the bracket. */
+  for (iter = 0; iter < MDL_MAX_ITER &&
+       Lhi - Llo > MDL_EPSILON * Lhi; iter++) {
+    /* keep the half of the bracket that contains the desired count. */
+    *L = 0.5 * (Llo + Lhi);
+    if (mdlcount(type, N, H, nH, *L) > n)
+      Llo = *L;
+    else
+      Lhi = *L;
+  }
+
+  /* store the prediction and free the histogram. */
+  *L = 0.5 * (Llo + Lhi);
+  free(H);
+
+  /* return success. */
+  return 1;
+}
+
@@ -0,0 +1,56 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_MDL_H__
+#define __NUSUTILS_MDL_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* include the tuple header. */
+#include "tup.h"
+
+/* mdltype_t: enumerated type for which preprogrammed gap equation a gap
+ * equation string refers to, if any.
+ *  => MDL_NONE: an arbitrary gap equation, with no count model.
+ *  => MDL_SINEGAP: the sine-gap equation.
+ *  => MDL_POISSONGAP: the poisson-gap equation.
+ */
+typedef enum {
+  MDL_NONE = 0,
+  MDL_SINEGAP,
+  MDL_POISSONGAP
+}
+mdltype_t;
+
+/* function declarations: */
+
+mdltype_t mdltype (const char *fn);
+
+int mdlguess (const char *fn, tuple_t *N, double n, double *L);
+
+#endif /* !__NUSUTILS_MDL_H__ */
+
@@ -0,0 +1,299 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the library header. */
+#include "nus.h"
+
+/* include the posix threads and unistd headers. */
+#include <pthread.h>
+#include <unistd.h>
+
+/* include the gap, rejection and jittered sampling headers. */
+#include "seq.h"
+#include "rej.h"
+#include "jit.h"
+
+/* nuslock: lock held while the julia environment is started or stopped.
+ * each handle owns its compiled equation, so schedules may be built from
+ * several handles at once.
+ */
+static pthread_mutex_t nuslock = PTHREAD_MUTEX_INITIALIZER;
+
+/* nusjulia: whether the julia environment has been initialized. */
+static int nusjulia;
+
+/* nusinit(): initialize the julia environment of the library on its own
+ * thread. this must be called once before any handle is allocated, after
+ * which handles may be used from any thread.
+ *
+ * returns:
+ *  integer indicating whether initialization succeeded (1) or not (0).
+ */
+int nusinit (void) {
+  /* declare required variables:
+   *  @ret: status of the initialization.
+   */
+  int ret = 1;
+
+  /* initialize the julia environment once. */
+  pthread_mutex_lock(&nuslock);
+  if (!nusjulia) {
+    ret = evalstart();
+    nusjulia = ret;
+  }
+
+  /* check that the julia thread was started. */
+  pthread_mutex_unlock(&nuslock);
+  if (!ret)
+    fprintf(stderr, "error: failed to start julia thread\n");
+
+  /* return the status. */
+  return ret;
+}
+
+/* nusexit(): release the evaluation engine and the julia environment,
+ * after every handle has been freed.
+ */
+void nusexit (void) {
+  /* clean up the julia environment, if it was initialized. */
+  pthread_mutex_lock(&nuslock);
+  if (nusjulia) {
+    evalexit();
+    nusjulia = 0;
+  }
+
+  pthread_mutex_unlock(&nuslock);
+}
+
+/* nusalloc(): allocate a schedule generation handle, and compile its
+ * equation into the evaluation context of the handle. every schedule
+ * built from the handle reuses the compiled equation.
+ *
+ * arguments:
+ *  @method: sampling method of the handle.
+ *  @fn: gap equation or density function string of the handle.
+ *
+ * returns:
+ *  pointer to the newly allocated handle, or NULL on failure.
+ */
+nus_t *nusalloc (nusmethod_t method, const char *fn) {
+  /* declare required variables:
+   *  @h: pointer to the new handle.
+   *  @ret: status of the equation compilation.
+   *  @arg: number of online processors.
+   */
+  nus_t *h;
+  int ret, arg;
+
+  /* check that the library was initialized. */
+  if (!nusjulia || !fn) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: library is not initialized\n");
+    return NULL;
+  }
+
+  /* allocate the handle and its equation string. */
+  h = (nus_t*) malloc(sizeof(nus_t));
+  if (!h)
+    return NULL;
+
+  h->fn = (char*) malloc(strlen(fn) + 1);
+  h->E = (evalctx_t*) malloc(sizeof(evalctx_t));
+  if (!h->fn || !h->E) {
+    free(h->fn);
+    free(h->E);
+    free(h);
+    return NULL;
+  }
+
+  /* store the method and the equation. */
+  strcpy(h->fn, fn);
+  h->method = method;
+
+  /* use every online processor and approximate gap counts by default. */
+  arg = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  h->nthr = (arg < 1 ? 1 : (unsigned int) arg);
+  h->exact = 0;
+
+  /* compile the equation. */
+  ret = evalinit(h->E, fn, method == NUS_GAP ? EVAL_GAP : EVAL_PDF);
+
+  /* check that the equation was compiled. */
+  if (ret != EVAL_OK) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to compile equation\n");
+    nusfree(h);
+    return NULL;
+  }
+
+  /* return the new handle. */
+  return h;
+}
+
+/* nusfree(): free a schedule generation handle.
+ *
+ * arguments:
+ *  @h: pointer to the handle to free.
+ */
+void nusfree (nus_t *h) {
+  /* ensure the pointer is valid. */
+  if (!h)
+    return;
+
+  /* free the evaluation context, the equation string and the handle. */
+  evalfree(h->E);
+  free(h->E);
+  free(h->fn);
+  free(h);
+}
+
+/* nusgen(): build a sampling schedule from a handle, and store its
+ * sorted linear indices into a caller-provided buffer. the first grid
+ * dimension varies fastest along the linear indices. handles may be
+ * used from several threads at once, and equations that are evaluated
+ * natively are never serialized.
+ *
+ * arguments:
+ *  @h: pointer to the schedule generation handle.
+ *  @N: array of Nyquist grid sizes.
+ *  @D: number of grid dimensions.
+ *  @d: desired sampling density, in (0,1).
+ *  @buf: output array of linear indices.
+ *  @nbuf: number of indices that fit in the output array.
+ *  @n: pointer to the output number of indices in the schedule, which is
+ *      also stored if the schedule does not fit into the output array.
+ *
+ * returns:
+ *  integer indicating whether the schedule was built and stored (1)
+ *  or not (0).
+ */
+int nusgen (nus_t *h, const unsigned int *N, unsigned int D, double d,
+            unsigned int *buf, unsigned int nbuf, unsigned int *n) {
+  /* declare required variables:
+   *  @Nt: tuple of grid sizes.
+   *  @lst: tuple of linear indices in the schedule.
+   *  @sopt, @ropt, @jopt: options of each sampling method.
+   *  @i: dimension and index loop counter.
+   *  @ret: status of the schedule generation.
+   */
+  seqopt_t sopt;
+  rejopt_t ropt;
+  jitopt_t jopt;
+  tuple_t Nt, lst;
+  unsigned int i;
+  int ret;
+
+  /* check the handle and the output pointers. */
+  if (!h || !N || !n || (nbuf && !buf)) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: invalid schedule arguments\n");
+    return 0;
+  }
+
+  /* check the grid dimensionality and the sampling density. */
+  if (D < 1 || D > NUS_DIMS_MAX || d <= 0.0 || d >= 1.0) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: invalid grid or sampling density\n");
+    return 0;
+  }
+
+  /* build the tuple of grid sizes. */
+  if (!tupalloc(&Nt, D)) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate grid size tuple\n");
+    return 0;
+  }
+
+  for (i = 0; i < D; i++) {
+    /* check and store the grid size. */
+    if (N[i] == 0) {
+      fprintf(stderr, "error: invalid N%u grid size\n", i + 1);
+      tupfree(&Nt);
+      return 0;
+    }
+
+    tupset(&Nt, i, N[i]);
+  }
+
+  /* build the schedule using the method of the handle. */
+  switch (h->method) {
+    /* gap sampling. */
+    case NUS_GAP:
+      sopt.exact = h->exact;
+      sopt.nthr = h->nthr;
+      sopt.ncand = SEQ_LANES;
+      sopt.T = NULL;
+      sopt.store = 0;
+      sopt.pre = NULL;
+      ret = seq(h->E, &Nt, d, &sopt, &lst);
+      break;
+
+    /* rejection sampling. */
+    case NUS_REJ:
+      ropt.nthr = h->nthr;
+      ropt.shard = 0;
+      ropt.nshard = ropt.nens = 1;
+      ropt.pre = NULL;
+      ropt.pos = NULL;
+      ropt.pdf = NULL;
+      ropt.prec = PDF_PREC_DOUBLE;
+      ropt.err = NULL;
+      ret = rej(h->E, &Nt, &d, 1, &ropt, &lst);
+      break;
+
+    /* jittered sampling. */
+    case NUS_JIT:
+      jopt.nthr = h->nthr;
+      jopt.tile = jopt.shard = 0;
+      jopt.nshard = jopt.nens = 1;
+      jopt.zorder = 0;
+      jopt.pre = NULL;
+      jopt.pos = NULL;
+      jopt.pdf = NULL;
+      jopt.prec = PDF_PREC_DOUBLE;
+      jopt.err = NULL;
+      jopt.miss = NULL;
+      ret = jit(h->E, &Nt, &d, 1, &jopt, &lst);
+      break;
+
+    /* otherwise. */
+    default:
+      tupinit(&lst);
+      ret = 0;
+  }
+
+  /* store the schedule size, and check that the schedule fits. */
+  *n = tupsize(&lst);
+  if (ret && *n > nbuf) {
+    fprintf(stderr, "error: schedule of %u points exceeds buffer\n", *n);
+    ret = 0;
+  }
+
+  /* copy the schedule into the output array. */
+  for (i = 0; ret && i < *n; i++)
+    buf[i] = tupget(&lst, i);
+
+  /* free the tuples and return the status. */
+  tupfree(&lst);
+  tupfree(&Nt);
+  return (ret ? 1 : 0);
+}
@@ -0,0 +1,79 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_NUS_H__
+#define __NUSUTILS_NUS_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* define the largest number of grid dimensions of a schedule. */
+#define NUS_DIMS_MAX  3
+
+/* nusmethod_t: enumerated type for the sampling method of a handle.
+ *  => NUS_GAP: gap sampling from a gap equation (see gaputil(1)).
+ *  => NUS_REJ: rejection sampling from a density (see rejutil(1)).
+ *  => NUS_JIT: jittered sampling from a density (see jitutil(1)).
+ */
+typedef enum {
+  NUS_GAP = 0,
+  NUS_REJ = 1,
+  NUS_JIT = 2
+}
+nusmethod_t;
+
+/* nus_t: type definition of a schedule generation handle, which holds
+ * a compiled equation and the options of every schedule built from it.
+ */
+typedef struct {
+  /* @method: sampling method of the handle.
+   * @fn: string of the compiled equation.
+   * @E: evaluation context holding the compiled equation.
+   */
+  nusmethod_t method;
+  char *fn;
+  struct evalctx *E;
+
+  /* @nthr: number of threads to build each schedule with.
+   * @exact: whether gap schedules hold exactly the desired point count.
+   */
+  unsigned int nthr;
+  int exact;
+}
+nus_t;
+
+/* function declarations: */
+
+int nusinit (void);
+
+void nusexit (void);
+
+nus_t *nusalloc (nusmethod_t method, const char *fn);
+
+void nusfree (nus_t *h);
+
+int nusgen (nus_t *h, const unsigned int *N, unsigned int D, double d,
+            unsigned int *buf, unsigned int nbuf, unsigned int *n);
+
+#endif /* !__NUSUTILS_NUS_H__ */
@@ -0,0 +1,1065 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the density grid header. */
+#include "pdf.h"
+
+/* pdfvec_t: vector type used by the normalization pass. */
+typedef double pdfvec_t __attribute__ ((vector_size (32)));
+
+/* define the number of density values in each vector. */
+#define PDF_VEC  (sizeof(pdfvec_t) / sizeof(double))
+
+/* pdfsum(): compute the pairwise sum of an array of values. the order of
+ * the additions only depends on the number of values.
+ *
+ * arguments:
+ *  @v: array of values to sum.
+ *  @n: number of values.
+ *
+ * returns:
+ *  sum of the values.
+ */
+double pdfsum (const double *v, unsigned int n) {
+  /* declare required variables:
+   *  @i: value loop counter.
+   *  @s: running sum of short arrays.
+   */
+  unsigned int i;
+  double s;
+
+  /* sum short arrays directly. */
+  if (n <= 8) {
+    for (i = 0, s = 0.0; i < n; i++)
+      s += v[i];
+
+    return s;
+  }
+
+  /* sum each half of longer arrays. */
+  return pdfsum(v, n / 2) + pdfsum(v + n / 2, n - n / 2);
+}
+
+/* pdfmax(): compute the largest of an array of values, or zero if every
+ * value is negative.
+ *
+ * arguments:
+ *  @v: array of values.
+ *  @n: number of values.
+ *
+ * returns:
+ *  largest value.
+ */
+double pdfmax (const double *v, unsigned int n) {
+  /* declare required variables:
+   *  @i: value loop counter.
+   *  @m: running maximum.
+   */
+  unsigned int i;
+  double m;
+
+  /* find the maximum. */
+  for (i = 0, m = 0.0; i < n; i++)
+    m = (v[i] > m ? v[i] : m);
+
+  return m;
+}
+
+/* pdfchunk(): evaluate or normalize a single chunk of a density grid. the
+ * values of grids without a density function are checked instead of
+ * being evaluated. when only a slab of the grid is kept, the chunk is
+ * evaluated into scratch values, and only its values within the slab are
+ * kept.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the threads.
+ *  @c: index of the chunk.
+ *  @x: tuple to hold unpacked grid indices.
+ *  @buf: array of scratch values of a chunk, or NULL.
+ *
+ * returns:
+ *  integer indicating whether the chunk succeeded (1) or not (0).
+ */
+int pdfchunk (pdfwork_t *W, unsigned int c, tuple_t *x, double *buf) {
+  /* declare required variables:
+   *  @i, @end: first and final grid indices of the chunk.
+   *  @j: value index within the chunk.
+   *  @v: pointer to the vectors of the chunk.
+   *  @s: vector of normalization divisors.
+   *  @k: vector element and edge index.
+   *  @val: values of the chunk.
+   *  @p, @e: normalized value and its relative error in single precision.
+   */
+  unsigned int i, j, end, k;
+  pdfvec_t *v, s;
+  double *val, p, e;
+
+  /* compute the extent of the chunk. */
+  i = c * PDF_CHUNK;
+  end = (i + PDF_CHUNK < W->n ? i + PDF_CHUNK : W->n);
+
+  /* evaluate and normalize the chunk in double precision, store it in
+   * single precision, and reduce the relative error of each value.
+   */
+  if (W->phase == 2) {
+    for (j = i, W->part[c] = 0.0; j < end; j++) {
+      W->P.unpack(&W->P, j, x->elem);
+      if (evalpdf(W->E, &p, x, W->N) != EVAL_OK)
+        return 0;
+
+      p /= W->scale;
+      W->flt[j] = (float) p;
+      e = (p > 0.0 ? fabs((double) W->flt[j] - p) / p : 0.0);
+      W->part[c] = (e > W->part[c] ? e : W->part[c]);
+    }
+
+    return 1;
+  }
+
+  /* normalize the chunk. */
+  if (W->phase) {
+    /* divide whole vectors, which the grid is aligned to. */
+    for (k = 0; k < PDF_VEC; k++)
+      s[k] = W->scale;
+
+    for (v = (pdfvec_t*) (W->pdf + i); i + PDF_VEC <= end; i += PDF_VEC)
+      *v++ /= s;
+
+    /* divide the remaining values. */
+    for (; i < end; i++)
+      W->pdf[i] /= W->scale;
+
+    return 1;
+  }
+
+  /* evaluate the density function at each grid point. */
+  val = (buf ? buf : W->pdf + i);
+  for (j = 0; W->E && i + j < end; j++) {
+    W->P.unpack(&W->P, i + j, x->elem);
+    if (evalpdf(W->E, val + j, x, W->N) != EVAL_OK)
+      return 0;
+  }
+
+  /* check that evaluated and given density values are finite and
+   * non-negative.
+   */
+  for (j = 0; i + j < end; j++) {
+    if (!isfinite(val[j]) || val[j] < 0.0) {
+      if (W->E)
+        fprintf(stderr, "error: density value %g is not finite and "
+                        "non-negative\n", val[j]);
+
+      return 0;
+    }
+  }
+
+  /* reduce the chunk. */
+  W->part[c] = (W->norm == PDF_NORM_SUM ?
+                pdfsum(val, end - i) :
+                pdfmax(val, end - i));
+
+  /* when only a slab is kept, sum the chunk and its values up to each
+   * edge of the slab within it, and keep its values within the slab.
+   */
+  if (buf) {
+    W->sum[c] = pdfsum(val, end - i);
+    for (k = 0; k < 2; k++) {
+      j = (k ? W->hi : W->lo);
+      if (j / PDF_CHUNK == c)
+        W->head[k] = pdfsum(val, j - i);
+    }
+
+    for (j = (i > W->lo ? i : W->lo); j < end && j < W->hi; j++)
+      W->pdf[j - W->lo] = val[j - i];
+  }
+
+  return 1;
+}
+
+/* pdfthread(): claim and process chunks of a density grid until none
+ * remain.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *pdfthread (void *arg) {
+  /* declare required variables:
+   *  @W: pointer to the shared state of the threads.
+   *  @x: tuple to hold unpacked grid indices.
+   *  @buf: scratch values of a chunk, when only a slab is kept.
+   *  @c: index of the claimed chunk.
+   */
+  pdfwork_t *W = (pdfwork_t*) arg;
+  double *buf = NULL;
+  unsigned int c;
+  tuple_t x;
+
+  /* allocate the index tuple. */
+  if (!tupalloc(&x, tupsize(W->N))) {
+    W->ret = 0;
+    return NULL;
+  }
+
+  /* allocate the scratch values. */
+  if (W->sum && !W->phase) {
+    buf = (double*) malloc(PDF_CHUNK * sizeof(double));
+    if (!buf) {
+      W->ret = 0;
+      tupfree(&x);
+      return NULL;
+    }
+  }
+
+  /* claim chunks until none remain, or a chunk fails. */
+  while (__atomic_load_n(&W->ret, __ATOMIC_RELAXED)) {
+    c = __atomic_fetch_add(&W->next, 1, __ATOMIC_RELAXED);
+    if (c >= W->nchunk)
+      break;
+
+    if (!pdfchunk(W, c, &x, buf))
+      __atomic_store_n(&W->ret, 0, __ATOMIC_RELAXED);
+  }
+
+  /* free the index tuple and the scratch values. */
+  tupfree(&x);
+  free(buf);
+  return NULL;
+}
+
+/* pdfrun(): run a phase of density grid processing on several threads,
+ * including the calling thread.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the threads.
+ *  @nthr: number of threads to use.
+ */
+void pdfrun (pdfwork_t *W, unsigned int nthr) {
+  /* process the chunks from the first one. */
+  W->next = 0;
+  thrrun(pdfthread, W, nthr);
+}
+
+/* pdfalloc(): allocate storage for a grid of values. large grids are
+ * mapped, with a hint to back them by huge pages, or are backed by an
+ * unlinked file in the scratch directory named by the environment, which
+ * lets the kernel page them out to that file instead of holding them in
+ * memory.
+ *
+ * arguments:
+ *  @size: number of bytes to allocate.
+ *
+ * returns:
+ *  pointer to the allocated storage, aligned to whole vectors, or NULL on
+ *  failure. the storage must be released by pdfrelease().
+ */
+void *pdfalloc (size_t size) {
+  /* declare required variables:
+   *  @M: header of the allocation.
+   *  @dir: scratch directory, or NULL.
+   *  @path: path of the scratch file.
+   *  @fd: file descriptor of the scratch file.
+   */
+  const char *dir;
+  pdfmem_t *M;
+  char *path;
+  int fd;
+
+  /* allocate small grids from the heap. */
+  size += PDF_HEAD;
+  if (size < PDF_MAP_MIN) {
+    if (posix_memalign((void**) &M, PDF_HEAD, size))
+      return NULL;
+
+    M->size = size;
+    M->mapped = 0;
+    return (char*) M + PDF_HEAD;
+  }
+
+  /* back large grids by a scratch file, if a directory was given. */
+  M = (pdfmem_t*) MAP_FAILED;
+  dir = getenv(PDF_SCRATCH_ENV);
+  if (dir && *dir) {
+    /* create and unlink the scratch file, which is then removed when the
+     * grid is released, or when the process exits.
+     */
+    path = (char*) malloc(strlen(dir) + 16);
+    fd = -1;
+    if (path) {
+      sprintf(path, "%s/.gridXXXXXX", dir);
+      fd = mkstemp(path);
+      if (fd >= 0)
+        unlink(path);
+
+      free(path);
+    }
+
+    /* size and map the scratch file. */
+    if (fd >= 0 && ftruncate(fd, size) == 0)
+      M = (pdfmem_t*) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0);
+
+    if (fd >= 0)
+      close(fd);
+
+    if (M == MAP_FAILED)
+      fprintf(stderr, "warning: failed to map scratch file in '%s'\n", dir);
+  }
+
+  /* otherwise, map anonymous memory backed by huge pages. */
+  if (M == MAP_FAILED) {
+    M = (pdfmem_t*) mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (M == MAP_FAILED)
+      return NULL;
+
+#ifdef MADV_HUGEPAGE
+    madvise(M, size, MADV_HUGEPAGE);
+#endif
+  }
+
+  /* store the header and return the grid storage. */
+  M->size = size;
+  M->mapped = 1;
+  return (char*) M + PDF_HEAD;
+}
+
+/* pdfrelease(): release the storage of a grid allocated by pdfalloc().
+ *
+ * arguments:
+ *  @ptr: pointer to the storage to release, or NULL.
+ */
+void pdfrelease (void *ptr) {
+  /* declare required variables:
+   *  @M: header of the allocation.
+   */
+  pdfmem_t *M;
+
+  /* ignore null pointers. */
+  if (!ptr)
+    return;
+
+  /* unmap or free the storage. */
+  M = (pdfmem_t*) ((char*) ptr - PDF_HEAD);
+  if (M->mapped)
+    munmap(M, M->size);
+  else
+    free(M);
+}
+
+/* pdfproc(): evaluate, or check, and normalize the values of a density
+ * grid. the grid is divided into fixed chunks that are processed by
+ * several threads. each chunk is reduced on its own, and the chunks are
+ * combined in a fixed pairwise order, so the normalized values are
+ * identical for any number of threads.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the threads, holding the grid.
+ *  @nthr: number of threads to use.
+ *
+ * returns:
+ *  integer indicating whether the grid was normalized (1) or not (0).
+ */
+int pdfproc (pdfwork_t *W, unsigned int nthr) {
+  /* initialize the shared state. */
+  W->n = tupprod(W->N);
+  tupgridinit(&W->P, W->N);
+  W->nchunk = (W->n + PDF_CHUNK - 1) / PDF_CHUNK;
+  W->sum = NULL;
+  W->flt = NULL;
+  W->phase = 0;
+  W->ret = 1;
+
+  /* allocate the reduced values of each chunk. */
+  W->part = (double*) calloc(W->nchunk ? W->nchunk : 1, sizeof(double));
+  if (!W->part)
+    return 0;
+
+  /* evaluate or check the density values over the grid. */
+  pdfrun(W, nthr);
+  if (!W->ret) {
+    free(W->part);
+    return 0;
+  }
+
+  /* combine the reduced values of each chunk. */
+  W->scale = (W->norm == PDF_NORM_SUM ?
+              pdfsum(W->part, W->nchunk) :
+              pdfmax(W->part, W->nchunk));
+
+  /* free the reduced values. */
+  free(W->part);
+
+  /* given density values must hold some mass. */
+  if (!W->E && W->scale <= 0.0)
+    return 0;
+
+  /* normalize the density values. */
+  W->phase = 1;
+  pdfrun(W, nthr);
+
+  /* return success. */
+  return 1;
+}
+
+/* pdfgrid(): evaluate the density function over every point of a grid
+ * and normalize the values, using several threads when the density
+ * function is evaluated natively (see evalnative()). the normalized
+ * values are identical for any number of threads (see pdfproc()).
+ *
+ * arguments:
+ *  @E: pointer to the evaluation context of the density function.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @norm: kind of normalization to apply.
+ *  @nthr: number of threads to use.
+ *
+ * returns:
+ *  newly allocated array of normalized density values, which must be
+ *  released by pdfrelease(), or NULL on failure.
+ */
+double *pdfgrid (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                 unsigned int nthr) {
+  /* declare required variables:
+   *  @W: shared state of the threads.
+   *  @pdf: aligned array of density values.
+   */
+  pdfwork_t W;
+  void *pdf;
+
+  /* allocate the density values, aligned to whole vectors. */
+  pdf = pdfalloc((size_t) tupprod(N) * sizeof(double));
+  if (!pdf)
+    return NULL;
+
+  /* calls into julia are made one at a time, so only native density
+   * functions are evaluated by several threads.
+   */
+  nthr = (evalnative(E) && nthr > 1 ? nthr : 1);
+
+  /* evaluate and normalize the density values. */
+  W.E = E;
+  W.N = N;
+  W.pdf = (double*) pdf;
+  W.norm = norm;
+  if (!pdfproc(&W, nthr)) {
+    pdfrelease(pdf);
+    return NULL;
+  }
+
+  /* return the density values. */
+  return W.pdf;
+}
+
+/* pdfgrid32(): evaluate the density function over every point of a grid,
+ * and store the normalized values in single precision, without ever
+ * holding the grid in double precision. the grid is evaluated twice: once
+ * to reduce its chunks as in pdfgrid(), and once to store the values,
+ * which are exactly those of pdfgrid() rounded to single precision.
+ *
+ * arguments:
+ *  @E: pointer to the evaluation context of the density function.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @norm: kind of normalization to apply.
+ *  @nthr: number of threads to use.
+ *  @err: pointer to the output maximum relative error of the stored
+ *        values, or NULL.
+ *
+ * returns:
+ *  newly allocated array of normalized density values, which must be
+ *  released by pdfrelease(), or NULL on failure.
+ */
+float *pdfgrid32 (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                  unsigned int nthr, double *err) {
+  /* declare required variables:
+   *  @W: shared state of the threads.
+   *  @flt: aligned array of single precision density values.
+   */
+  pdfwork_t W;
+  void *flt;
+
+  /* allocate the single precision density values. */
+  flt = pdfalloc((size_t) tupprod(N) * sizeof(float));
+  if (!flt)
+    return NULL;
+
+  /* calls into julia are made one at a time, so only native density
+   * functions are evaluated by several threads.
+   */
+  nthr = (evalnative(E) && nthr > 1 ? nthr : 1);
+
+  /* initialize the shared state of the evaluation, which reduces the
+   * chunks of the grid without keeping any of its values.
+   */
+  W.E = E;
+  W.N = N;
+  W.pdf = NULL;
+  W.flt = (float*) flt;
+  W.norm = norm;
+  W.n = tupprod(N);
+  tupgridinit(&W.P, N);
+  W.nchunk = (W.n + PDF_CHUNK - 1) / PDF_CHUNK;
+  W.lo = W.hi = 0;
+  W.phase = 0;
+  W.ret = 1;
+
+  /* allocate the reduced and summed values of each chunk, and reduce
+   * the chunks.
+   */
+  W.part = (double*) calloc(W.nchunk ? W.nchunk : 1, sizeof(double));
+  W.sum = (double*) calloc(W.nchunk ? W.nchunk : 1, sizeof(double));
+  if (W.part && W.sum)
+    pdfrun(&W, nthr);
+
+  /* combine the reduced values of each chunk. */
+  if (W.part && W.sum && W.ret)
+    W.scale = (norm == PDF_NORM_SUM ?
+               pdfsum(W.part, W.nchunk) :
+               pdfmax(W.part, W.nchunk));
+  else
+    W.ret = 0;
+
+  /* evaluate, normalize and store the values, and find the largest
+   * relative error of each chunk.
+   */
+  free(W.sum);
+  W.sum = NULL;
+  if (W.ret) {
+    W.phase = 2;
+    pdfrun(&W, nthr);
+  }
+
+  /* combine the relative errors of each chunk. */
+  if (W.ret && err)
+    *err = pdfmax(W.part, W.nchunk);
+
+  /* free the reduced values. */
+  free(W.part);
+  if (!W.ret) {
+    pdfrelease(flt);
+    return NULL;
+  }
+
+  /* return the density values. */
+  return W.flt;
+}
+
+/* pdfnarrow(): copy density values into single precision.
+ *
+ * arguments:
+ *  @pdf: array of density values.
+ *  @n: number of values.
+ *  @err: pointer to the output maximum relative error of the copied
+ *        values, or NULL.
+ *
+ * returns:
+ *  newly allocated array of single precision values, which must be
+ *  released by pdfrelease(), or NULL on failure.
+ */
+float *pdfnarrow (const double *pdf, unsigned int n, double *err) {
+  /* declare required variables:
+   *  @flt: array of single precision values.
+   *  @e, @emax: relative error of each value, and the largest error.
+   *  @i: value loop counter.
+   */
+  double e, emax;
+  unsigned int i;
+  float *flt;
+
+  /* allocate the single precision values. */
+  flt = (float*) pdfalloc((size_t) n * sizeof(float));
+  if (!flt)
+    return NULL;
+
+  /* copy the values and find the largest relative error. */
+  for (i = 0, emax = 0.0; i < n; i++) {
+    flt[i] = (float) pdf[i];
+    e = (pdf[i] > 0.0 ? fabs((double) flt[i] - pdf[i]) / pdf[i] : 0.0);
+    emax = (e > emax ? e : emax);
+  }
+
+  /* return the single precision values. */
+  if (err)
+    *err = emax;
+
+  return flt;
+}
+
+/* pdfload(): read a density grid from a file of raw values, in the order
+ * of linear grid indices, and normalize it. files of double precision
+ * values are mapped privately and normalized in place, without copying
+ * the grid. files of single precision values are converted.
+ *
+ * arguments:
+ *  @F: pointer to the output density grid.
+ *  @fname: name of the file to read.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @norm: kind of normalization to apply.
+ *  @nthr: number of threads to use.
+ *
+ * returns:
+ *  integer indicating whether the grid was read (1) or not (0).
+ */
+int pdfload (pdffile_t *F, const char *fname, tuple_t *N, pdfnorm_t norm,
+             unsigned int nthr) {
+  /* declare required variables:
+   *  @W: shared state of the threads.
+   *  @st: status of the file.
+   *  @map: mapped contents of the file.
+   *  @n: number of grid points.
+   *  @i: grid point loop counter.
+   *  @fd: file descriptor of the file.
+   */
+  pdfwork_t W;
+  struct stat st;
+  void *map;
+  size_t n, i;
+  int fd;
+
+  /* open the file and check that its size matches the grid. */
+  F->map = NULL;
+  F->pdf = NULL;
+  n = tupprod(N);
+  fd = open(fname, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "error: failed to open density grid '%s'\n", fname);
+    if (fd >= 0)
+      close(fd);
+
+    return 0;
+  }
+
+  if (n == 0 || ((size_t) st.st_size != n * sizeof(double) &&
+                 (size_t) st.st_size != n * sizeof(float))) {
+    fprintf(stderr, "error: '%s' does not hold %lu single or double "
+                    "precision values\n", fname, (unsigned long) n);
+    close(fd);
+    return 0;
+  }
+
+  /* map the file privately, so it is never modified. */
+  map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "error: failed to map density grid '%s'\n", fname);
+    return 0;
+  }
+
+  /* use double precision values in place. */
+  if ((size_t) st.st_size == n * sizeof(double)) {
+    F->map = map;
+    F->nmap = st.st_size;
+    F->pdf = (double*) map;
+  }
+  else {
+    /* convert single precision values. */
+    F->map = pdfalloc(n * sizeof(double));
+    if (!F->map) {
+      fprintf(stderr, "error: failed to allocate density grid\n");
+      munmap(map, st.st_size);
+      F->map = NULL;
+      return 0;
+    }
+
+    F->pdf = (double*) F->map;
+    F->nmap = 0;
+    for (i = 0; i < n; i++)
+      F->pdf[i] = ((float*) map)[i];
+
+    munmap(map, st.st_size);
+  }
+
+  /* check and normalize the density values. */
+  W.E = NULL;
+  W.N = N;
+  W.pdf = F->pdf;
+  W.norm = norm;
+  if (!pdfproc(&W, nthr)) {
+    fprintf(stderr, "error: '%s' holds invalid density values\n", fname);
+    pdffree(F);
+    return 0;
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* pdffree(): free a density grid read by pdfload().
+ *
+ * arguments:
+ *  @F: pointer to the density grid to free.
+ */
+void pdffree (pdffile_t *F) {
+  /* unmap or release the density values. */
+  if (F->map && F->nmap)
+    munmap(F->map, F->nmap);
+  else
+    pdfrelease(F->map);
+
+  F->map = NULL;
+  F->pdf = NULL;
+}
+
+/* pdfrows(): compute the extent of one of several shards of a grid. the
+ * shards are contiguous slabs along the slowest varying grid dimension,
+ * so each is itself a grid whose points occupy a contiguous range of
+ * linear indices.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @k: index of the shard, in [0,K).
+ *  @K: number of shards, no more than the slowest grid size.
+ *  @Nk: pointer to the output tuple of shard grid sizes.
+ *  @lo: pointer to the output first linear index of the shard.
+ *  @hi: pointer to the output final (exclusive) linear index of the shard.
+ *
+ * returns:
+ *  integer indicating whether the extent was computed (1) or not (0).
+ */
+int pdfrows (tuple_t *N, unsigned int k, unsigned int K,
+             tuple_t *Nk, unsigned int *lo, unsigned int *hi) {
+  /* declare required variables:
+   *  @D: index of the slowest varying grid dimension.
+   *  @r0, @r1: first and final (exclusive) rows of the shard.
+   */
+  unsigned int D, r0, r1;
+
+  /* ensure the shard index is valid. */
+  D = tupsize(N) - 1;
+  if (K == 0 || k >= K || K > tupget(N, D))
+    return 0;
+
+  /* compute the rows and linear index range of the shard. */
+  r0 = (unsigned int) ((unsigned long) k * tupget(N, D) / K);
+  r1 = (unsigned int) ((unsigned long) (k + 1) * tupget(N, D) / K);
+  *lo = r0 * tupstride(N, D);
+  *hi = r1 * tupstride(N, D);
+
+  /* build the grid sizes of the shard. */
+  if (!tupdup(Nk, N))
+    return 0;
+
+  tupset(Nk, D, r1 - r0);
+  return 1;
+}
+
+/* pdfsplit(): apportion points and density mass to one of several shards
+ * by rounding the cumulative density mass at its edges, so the counts of
+ * all shards always sum to the total count.
+ *
+ * arguments:
+ *  @c: cumulative density mass at the first and final edges of the shard,
+ *      and over the entire grid.
+ *  @n: total number of points to sample from the grid.
+ *  @k: index of the shard, in [0,K).
+ *  @K: number of shards.
+ *  @nk: pointer to the output number of points to sample from the shard.
+ *  @mass: pointer to the output fraction of density mass in the shard.
+ */
+void pdfsplit (const double *c, unsigned int n,
+               unsigned int k, unsigned int K,
+               unsigned int *nk, double *mass) {
+  /* apportion the points and the density mass. */
+  if (c[2] > 0.0) {
+    *nk = (unsigned int) (round((double) n * c[1] / c[2]) -
+                          round((double) n * c[0] / c[2]));
+    *mass = (c[1] - c[0]) / c[2];
+  }
+  else {
+    *nk = (unsigned int) ((unsigned long) (k + 1) * n / K -
+                          (unsigned long) k * n / K);
+    *mass = 1.0 / ((double) K);
+  }
+}
+
+/* pdfshard(): compute the extent and point count of one of several shards
+ * of a density grid (see pdfrows() and pdfsplit()).
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @pdf: array of density values of the grid.
+ *  @n: total number of points to sample from the grid.
+ *  @k: index of the shard, in [0,K).
+ *  @K: number of shards, no more than the slowest grid size.
+ *  @Nk: pointer to the output tuple of shard grid sizes.
+ *  @lo: pointer to the output first linear index of the shard.
+ *  @nk: pointer to the output number of points to sample from the shard.
+ *  @mass: pointer to the output fraction of density mass in the shard.
+ *
+ * returns:
+ *  integer indicating whether the shard was computed (1) or not (0).
+ */
+int pdfshard (tuple_t *N, double *pdf, unsigned int n,
+              unsigned int k, unsigned int K,
+              tuple_t *Nk, unsigned int *lo,
+              unsigned int *nk, double *mass) {
+  /* declare required variables:
+   *  @hi: final (exclusive) linear index of the shard.
+   *  @c: cumulative density mass at the shard edges, and over the
+   *      entire grid.
+   */
+  unsigned int hi;
+  double c[3];
+
+  /* compute the extent of the shard. */
+  if (!pdfrows(N, k, K, Nk, lo, &hi))
+    return 0;
+
+  /* compute the cumulative density mass at each edge of the shard. the
+   * same sums are computed by every shard that shares an edge.
+   */
+  c[0] = pdfsum(pdf, *lo);
+  c[1] = pdfsum(pdf, hi);
+  c[2] = pdfsum(pdf, tupprod(N));
+
+  /* apportion the points and the density mass. */
+  pdfsplit(c, n, k, K, nk, mass);
+  return 1;
+}
+
+/* pdfslab(): evaluate the density function over one of several shards of
+ * a grid, without keeping the values of the other shards. the whole grid
+ * is evaluated once, in the same chunks as pdfgrid(), so the kept values
+ * are normalized exactly as pdfgrid() would normalize them. the chunks
+ * are also summed to give the cumulative density mass at the edges of the
+ * shard, which are the same for every shard that shares an edge.
+ *
+ * arguments:
+ *  @E: pointer to the evaluation context of the density function.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @norm: kind of normalization to apply.
+ *  @k: index of the shard, in [0,K).
+ *  @K: number of shards, no more than the slowest grid size.
+ *  @nthr: number of threads to use.
+ *  @c: output cumulative density mass at the first and final edges of the
+ *      shard, and over the entire grid (see pdfsplit()).
+ *
+ * returns:
+ *  newly allocated array of normalized density values of the shard, which
+ *  must be released by pdfrelease(), or NULL on failure.
+ */
+double *pdfslab (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                 unsigned int k, unsigned int K, unsigned int nthr,
+                 double *c) {
+  /* declare required variables:
+   *  @W: shared state of the threads.
+   *  @Nk: grid sizes of the shard.
+   *  @pdf: aligned array of density values of the shard.
+   */
+  pdfwork_t W;
+  tuple_t Nk;
+  void *pdf;
+
+  /* compute the extent of the shard. */
+  if (!pdfrows(N, k, K, &Nk, &W.lo, &W.hi))
+    return NULL;
+
+  tupfree(&Nk);
+
+  /* allocate the density values of the shard, aligned to whole vectors. */
+  pdf = pdfalloc((size_t) (W.hi - W.lo) * sizeof(double));
+  if (!pdf)
+    return NULL;
+
+  /* calls into julia are made one at a time, so only native density
+   * functions are evaluated by several threads.
+   */
+  nthr = (evalnative(E) && nthr > 1 ? nthr : 1);
+
+  /* initialize the shared state of the evaluation. */
+  W.E = E;
+  W.N = N;
+  W.pdf = (double*) pdf;
+  W.flt = NULL;
+  W.norm = norm;
+  W.n = tupprod(N);
+  tupgridinit(&W.P, N);
+  W.nchunk = (W.n + PDF_CHUNK - 1) / PDF_CHUNK;
+  W.head[0] = W.head[1] = 0.0;
+  W.phase = 0;
+  W.ret = 1;
+
+  /* allocate the reduced and summed values of each chunk. */
+  W.part = (double*) calloc(W.nchunk ? W.nchunk : 1, sizeof(double));
+  W.sum = (double*) calloc(W.nchunk ? W.nchunk : 1, sizeof(double));
+  if (W.part && W.sum)
+    pdfrun(&W, nthr);
+
+  /* combine the reduced values of each chunk, and the summed values up
+   * to each edge of the shard.
+   */
+  if (W.part && W.sum && W.ret) {
+    W.scale = (norm == PDF_NORM_SUM ?
+               pdfsum(W.part, W.nchunk) :
+               pdfmax(W.part, W.nchunk));
+
+    c[0] = pdfsum(W.sum, W.lo / PDF_CHUNK) + W.head[0];
+    c[1] = pdfsum(W.sum, W.hi / PDF_CHUNK) + W.head[1];
+    c[2] = pdfsum(W.sum, W.nchunk);
+  }
+  else
+    W.ret = 0;
+
+  /* free the reduced and summed values. */
+  free(W.part);
+  free(W.sum);
+  if (!W.ret) {
+    pdfrelease(pdf);
+    return NULL;
+  }
+
+  /* normalize the density values of the shard. */
+  W.sum = NULL;
+  W.n = W.hi - W.lo;
+  W.nchunk = (W.n + PDF_CHUNK - 1) / PDF_CHUNK;
+  W.phase = 1;
+  pdfrun(&W, nthr);
+
+  /* return the density values. */
+  return W.pdf;
+}
+
+/* pdfkey(): build the cache key of a density grid.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @fn: density function string.
+ *  @norm: kind of normalization of the grid.
+ *
+ * returns:
+ *  newly allocated key string, or NULL on failure.
+ */
+char *pdfkey (tuple_t *N, const char *fn, pdfnorm_t norm) {
+  /* build the key from the grid, the function and the normalization. */
+  return cachekey("pdf", norm == PDF_NORM_MAX ? "norm max" : "norm sum",
+                  N, NULL, 0, fn);
+}
+
+/* pdfget(): map a density grid from a cache, without evaluating the
+ * density function. the grid remains valid until the entry is released
+ * by cacherelease().
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @fn: density function string.
+ *  @norm: kind of normalization of the grid.
+ *  @ent: pointer to the output mapped cache entry.
+ *
+ * returns:
+ *  pointer to the cached density values, or NULL if none were found.
+ */
+double *pdfget (cache_t *C, tuple_t *N, const char *fn, pdfnorm_t norm,
+                cacheent_t *ent) {
+  /* declare required variables:
+   *  @hdr: header of the cached grid.
+   *  @pdf: cached density values.
+   *  @key: cache key of the grid.
+   *  @i: grid point loop counter.
+   *  @ok: whether the grid was found.
+   */
+  pdfhdr_t *hdr;
+  unsigned int i;
+  double *pdf;
+  char *key;
+  int ok;
+
+  /* map the cache entry. */
+  key = pdfkey(N, fn, norm);
+  ok = (key && cacheget(C, key, ent));
+  free(key);
+  if (!ok)
+    return NULL;
+
+  /* check that the header matches the grid. */
+  hdr = (pdfhdr_t*) ent->data;
+  if (ent->ndata < sizeof(pdfhdr_t) || hdr->norm != (uint32_t) norm ||
+      hdr->n != tupprod(N) ||
+      ent->ndata != sizeof(pdfhdr_t) + hdr->n * sizeof(double)) {
+    cacherelease(ent);
+    return NULL;
+  }
+
+  /* check that the density values are finite and non-negative, as the
+   * values of a density grid file must be.
+   */
+  pdf = (double*) (hdr + 1);
+  for (i = 0; i < hdr->n; i++) {
+    if (!isfinite(pdf[i]) || pdf[i] < 0.0) {
+      cacherelease(ent);
+      return NULL;
+    }
+  }
+
+  /* return the density values. */
+  return pdf;
+}
+
+/* pdfput(): store a density grid in a cache.
+ *
+ * arguments:
+ *  @C: pointer to the cache.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @fn: density function string.
+ *  @norm: kind of normalization of the grid.
+ *  @pdf: array of normalized density values.
+ *
+ * returns:
+ *  integer indicating whether the grid was stored (1) or not (0).
+ */
+int pdfput (cache_t *C, tuple_t *N, const char *fn, pdfnorm_t norm,
+            const double *pdf) {
+  /* declare required variables:
+   *  @hdr: header of the cached grid.
+   *  @buf: buffer of the cache entry data.
+   *  @key: cache key of the grid.
+   *  @n: number of bytes of entry data.
+   *  @ok: whether the grid was stored.
+   */
+  pdfhdr_t *hdr;
+  char *key;
+  size_t n;
+  int ok;
+
+  /* build the entry data. */
+  n = sizeof(pdfhdr_t) + (size_t) tupprod(N) * sizeof(double);
+  hdr = (pdfhdr_t*) malloc(n);
+  key = pdfkey(N, fn, norm);
+  if (!hdr || !key) {
+    free(hdr);
+    free(key);
+    return 0;
+  }
+
+  hdr->norm = (uint32_t) norm;
+  hdr->n = tupprod(N);
+  memcpy(hdr + 1, pdf, (size_t) hdr->n * sizeof(double));
+
+  /* store the entry. */
+  ok = cacheput(C, key, hdr, n);
+  free(hdr);
+  free(key);
+
+  /* return the status. */
+  return ok;
+}
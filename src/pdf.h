@@ -0,0 +1,220 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_PDF_H__
+#define __NUSUTILS_PDF_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* include the posix threads, file and memory mapping headers. */
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* include the tuple, evaluation, cache and thread headers. */
+#include "tup.h"
+#include "eval.h"
+#include "cache.h"
+#include "thr.h"
+
+/* define the number of grid points in each chunk of a density grid. the
+ * chunks fix the order of every reduction, regardless of how many threads
+ * evaluate them.
+ */
+#define PDF_CHUNK  4096
+
+/* define the environment variable that names a scratch directory, in which
+ * large grids are backed by files instead of memory, and the size above
+ * which grids are mapped, in bytes.
+ */
+#define PDF_SCRATCH_ENV  "NUSUTILS_SCRATCH"
+#define PDF_MAP_MIN      (1UL << 21)
+
+/* define the size of the header that precedes every allocated grid. it
+ * keeps the grid values aligned to whole vectors.
+ */
+#define PDF_HEAD  64
+
+/* pdfnorm_t: enumerated type for how a density grid is normalized.
+ *  => PDF_NORM_MAX: divide by the largest density value.
+ *  => PDF_NORM_SUM: divide by the sum of all density values.
+ */
+typedef enum {
+  PDF_NORM_MAX = 0,
+  PDF_NORM_SUM = 1
+}
+pdfnorm_t;
+
+/* pdfprec_t: enumerated type for the precision of sampled density values.
+ *  => PDF_PREC_DOUBLE: double precision values.
+ *  => PDF_PREC_FLOAT: single precision values, which halve the storage of
+ *     a grid at the cost of a small relative error in each value.
+ */
+typedef enum {
+  PDF_PREC_DOUBLE = 0,
+  PDF_PREC_FLOAT = 1
+}
+pdfprec_t;
+
+/* pdfview_t: type definition of an array of density values, which are
+ * stored in either double or single precision.
+ */
+typedef struct {
+  /* @d: double precision values, or NULL.
+   * @f: single precision values, or NULL.
+   */
+  const double *d;
+  const float *f;
+}
+pdfview_t;
+
+/* pdfat(): read a density value from a view, in double precision. */
+#define pdfat(v, i)  ((v)->f ? (double) (v)->f[i] : (v)->d[i])
+
+/* pdfhdr_t: type definition of the header that precedes the values of a
+ * cached density grid.
+ */
+typedef struct {
+  /* @norm: kind of normalization of the grid, as a pdfnorm_t.
+   * @n: number of grid points.
+   */
+  uint32_t norm, n;
+}
+pdfhdr_t;
+
+/* pdfmem_t: type definition of the header that precedes an allocated
+ * grid, which records how it must be released.
+ */
+typedef struct {
+  /* @size: number of allocated bytes, including the header.
+   * @mapped: whether the grid was mapped (1) or allocated (0).
+   */
+  size_t size;
+  int mapped;
+}
+pdfmem_t;
+
+/* pdffile_t: type definition of a density grid read from a file.
+ */
+typedef struct {
+  /* @map: mapped file contents, or allocated converted values.
+   * @nmap: number of mapped bytes, or zero if the values were converted.
+   * @pdf: array of normalized density values.
+   */
+  void *map;
+  size_t nmap;
+  double *pdf;
+}
+pdffile_t;
+
+/* pdfwork_t: type definition of the shared state of the threads that
+ * evaluate and normalize a density grid.
+ */
+typedef struct {
+  /* @E: pointer to the evaluation context of the density function.
+   * @N: pointer to the tuple of Nyquist grid sizes.
+   * @P: index kernels of the grid.
+   * @pdf: array of density values.
+   * @flt: array of single precision density values, or NULL.
+   * @part: array of reduced values of each chunk.
+   * @norm: kind of normalization to apply.
+   * @scale: normalization divisor of the density values.
+   */
+  evalctx_t *E;
+  tuple_t *N;
+  tupgrid_t P;
+  double *pdf, *part;
+  float *flt;
+  pdfnorm_t norm;
+  double scale;
+
+  /* @sum: array of summed values of each chunk, or NULL if the whole
+   *       grid is kept.
+   * @head: summed values of the chunks that hold @lo and @hi, up to them.
+   * @lo, @hi: first and final (exclusive) linear indices of the values
+   *           that are kept in @pdf, when @sum is used.
+   */
+  double *sum, head[2];
+  unsigned int lo, hi;
+
+  /* @n: number of grid points.
+   * @nchunk: number of chunks.
+   * @next: index of the next chunk to claim.
+   * @phase: whether chunks are evaluated (0), normalized (1), or
+   *         evaluated and narrowed to single precision (2).
+   * @ret: status of the evaluation.
+   */
+  unsigned int n, nchunk, next;
+  int phase, ret;
+}
+pdfwork_t;
+
+/* function declarations: */
+
+void *pdfalloc (size_t size);
+
+void pdfrelease (void *ptr);
+
+double *pdfgrid (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                 unsigned int nthr);
+
+float *pdfgrid32 (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                  unsigned int nthr, double *err);
+
+float *pdfnarrow (const double *pdf, unsigned int n, double *err);
+
+int pdfload (pdffile_t *F, const char *fname, tuple_t *N, pdfnorm_t norm,
+             unsigned int nthr);
+
+void pdffree (pdffile_t *F);
+
+int pdfrows (tuple_t *N, unsigned int k, unsigned int K,
+             tuple_t *Nk, unsigned int *lo, unsigned int *hi);
+
+void pdfsplit (const double *c, unsigned int n,
+               unsigned int k, unsigned int K,
+               unsigned int *nk, double *mass);
+
+int pdfshard (tuple_t *N, double *pdf, unsigned int n,
+              unsigned int k, unsigned int K,
+              tuple_t *Nk, unsigned int *lo,
+              unsigned int *nk, double *mass);
+
+double *pdfslab (evalctx_t *E, tuple_t *N, pdfnorm_t norm,
+                 unsigned int k, unsigned int K, unsigned int nthr,
+                 double *c);
+
+double *pdfget (cache_t *C, tuple_t *N, const char *fn, pdfnorm_t norm,
+                cacheent_t *ent);
+
+int pdfput (cache_t *C, tuple_t *N, const char *fn, pdfnorm_t norm,
+            const double *pdf);
+
+#endif /* !__NUSUTILS_PDF_H__ */
+
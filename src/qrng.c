@@ -63,6 +63,11 @@ int qrngalloc (qrng_t *g, unsigned int n) {
   if (!g->sv)
     return 0;
 
+  /* allocate the digit count array. */
+  g->nv = (unsigned int*) calloc(n, sizeof(unsigned int));
+  if (!g->nv)
+    return 0;
+
   /* allocate the individual states. */
   for (i = 0; i < n; i++) {
     /* allocate the state. */
@@ -88,8 +93,9 @@ int qrngalloc (qrng_t *g, unsigned int n) {
     }
   }
 
-  /* store the generator size. */
+  /* store the generator size, and start at the first term. */
   g->n = n;
+  g->idx = 0;
 
   /* return success. */
   return 1;
@@ -132,10 +138,92 @@ void qrngfree (qrng_t *g) {
   free(g->sv);
   g->sv = NULL;
 
+  /* free the digit count array. */
+  free(g->nv);
+  g->nv = NULL;
+
   /* initialize the size. */
   g->n = 0;
 }
 
+/* qrngreset(): return a quasirandom number generator to the beginning
+ * of its sequence.
+ *
+ * arguments:
+ *  @g: pointer to the generator structure to reset.
+ */
+void qrngreset (qrng_t *g) {
+  /* declare required variables:
+   *  @i: general state counter.
+   */
+  unsigned int i;
+
+  /* ensure the pointer is valid. */
+  if (!g || g->n == 0)
+    return;
+
+  /* zero the outputs and the "bits" of each state. */
+  memset(g->x, 0, g->n * sizeof(double));
+  for (i = 0; i < g->n; i++) {
+    memset(g->sv[i], 0, g->nv[i] * sizeof(unsigned int));
+    g->nv[i] = 0;
+  }
+
+  /* start at the first term. */
+  g->idx = 0;
+}
+
+/* qrngseek(): position a quasirandom number generator at an arbitrary
+ * index of its sequence, so that the next call to qrngeval() produces
+ * the same term as the idx-th call after qrngreset().
+ *
+ * arguments:
+ *  @g: pointer to the generator structure to position.
+ *  @idx: index of the next sequence term.
+ */
+void qrngseek (qrng_t *g, unsigned long idx) {
+  /* declare required variables:
+   *  @i: general state counter.
+   *  @v: remaining value to expand into "bits".
+   */
+  unsigned long v;
+  unsigned int i;
+
+  /* ensure the pointer is valid. */
+  if (!g || g->n == 0)
+    return;
+
+  /* loop over each state. */
+  memset(g->x, 0, g->n * sizeof(double));
+  for (i = 0; i < g->n; i++) {
+    /* zero the "bits" of the state. */
+    memset(g->sv[i], 0, g->nv[i] * sizeof(unsigned int));
+
+    /* expand the index into the "bits" of the state. */
+    for (v = idx, g->nv[i] = 0; v && g->nv[i] < QRNG_MAX; g->nv[i]++) {
+      g->sv[i][g->nv[i]] = (unsigned int) (v % g->bv[i]);
+      v /= g->bv[i];
+    }
+  }
+
+  /* store the index of the next term. */
+  g->idx = idx;
+}
+
+/* qrngtell(): return the position of a quasirandom number generator in
+ * its sequence, which may be passed to qrngseek() to resume it.
+ *
+ * arguments:
+ *  @g: pointer to the generator structure to query.
+ *
+ * returns:
+ *  index of the next sequence term, or zero.
+ */
+unsigned long qrngtell (qrng_t *g) {
+  /* return the stored position. */
+  return (g ? g->idx : 0);
+}
+
 /* qrngeval(): evaluate the next term in a quasirandom sequence.
  *
  * arguments:
@@ -150,16 +238,17 @@ void qrngeval (qrng_t *g) {
   unsigned int i, k;
   double kpow;
 
-  /* initialize the outputs. */
+  /* initialize the outputs, and advance the position. */
   memset(g->x, 0, g->n * sizeof(double));
+  g->idx++;
 
   /* loop over the states. */
   for (i = 0; i < g->n; i++) {
     /* initialize the multiplier. */
     kpow = 1.0 / ((double) g->bv[i]);
 
-    /* loop over the bits in the state. */
-    for (k = 0; k < QRNG_MAX; k++) {
+    /* loop over the significant bits in the state. */
+    for (k = 0; k < g->nv[i]; k++) {
       /* update the current state's output value. */
       g->x[i] += ((double) g->sv[i][k]) * kpow;
 
@@ -181,7 +270,8 @@ void qrngeval (qrng_t *g) {
         g->sv[i][k] = 0;
       }
       else {
-        /* keep the bit and break the loop. */
+        /* keep the bit, count it if it is new, and break the loop. */
+        g->nv[i] = (k >= g->nv[i] ? k + 1 : g->nv[i]);
         break;
       }
     }
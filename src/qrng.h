@@ -40,13 +40,17 @@ typedef struct {
 
   /* @bv: array of relatively prime bases.
    * @sv: current state of the quasirandom sequence.
+   * @nv: number of significant digits in each state.
    */
   unsigned int *bv;
   unsigned int **sv;
+  unsigned int *nv;
 
   /* @x: array of quasirandom iterates.
+   * @idx: index of the next sequence term.
    */
   double *x;
+  unsigned long idx;
 }
 qrng_t;
 
@@ -56,6 +60,12 @@ int qrngalloc (qrng_t *g, unsigned int n);
 
 void qrngfree (qrng_t *g);
 
+void qrngreset (qrng_t *g);
+
+void qrngseek (qrng_t *g, unsigned long idx);
+
+unsigned long qrngtell (qrng_t *g);
+
 void qrngeval (qrng_t *g);
 
 double qrngget (qrng_t *g, unsigned int i);
@@ -23,15 +23,21 @@
 /* include the rejection header. */
 #include "rej.h"
 
-/* rejsamp(): compute a new multidimensional index via rejection sampling.
+/* rejsamp(): compute a candidate multidimensional index from the next
+ * quasirandom term and test it for acceptance.
  *
  * arguments:
  *  @G: pointer to a quasirandom number generator structure.
- *  @pdf: array of normalized density function values.
+ *  @pdf: pointer to the normalized density function values.
  *  @x: pointer to the tuple to be updated.
- *  @N: pointer to the tuple of sizes.
+ *  @G: pointer to the index kernels of the grid.
+ *  @xi: pointer to the output packed index of the candidate.
+ *
+ * returns:
+ *  integer indicating whether the candidate was accepted (1) or not (0).
  */
-void rejsamp (qrng_t *G, double *pdf, tuple_t *x, tuple_t *N) {
+int rejsamp (qrng_t *G, const pdfview_t *pdf, tuple_t *x, tupgrid_t *P,
+             unsigned int *xi) {
   /* declare required variables:
    *  @i: dimension loop counter.
    *  @p: current grid density value.
@@ -40,25 +46,284 @@ void rejsamp (qrng_t *G, double *pdf, tuple_t *x, tuple_t *N) {
   unsigned int i;
   double p, u;
 
-  /* loop until a candidate index is accepted. */
-  do {
-    /* sample a new quasirandom iterate. */
-    qrngeval(G);
+  /* sample a new quasirandom iterate. */
+  qrngeval(G);
+
+  /* construct the grid index. */
+  for (i = 0; i < tupsize(x); i++) {
+    G->x[i] *= ((double) (tupget(P->N, i) - 1));
+    tupset(x, i, (unsigned int) round(G->x[i]));
+  }
+
+  /* extract the uniform deviate. */
+  u = G->x[G->n - 1];
+
+  /* extract the density value. */
+  *xi = P->pack(P, x->elem);
+  p = pdfat(pdf, *xi);
+
+  /* accept or reject the candidate. */
+  return (u <= p);
+}
+
+/* rejthread(): claim blocks of sequence terms and record the packed
+ * indices of the accepted candidates in each, until none remain.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *rejthread (void *arg) {
+  /* declare required variables:
+   *  @W: pointer to the shared state of the threads.
+   *  @x: unpacked grid point index of each candidate.
+   *  @G: quasirandom number generator structure.
+   *  @b: index of the claimed block.
+   *  @k: term loop counter.
+   *  @acc: accepted indices of the claimed block.
+   */
+  rejwork_t *W = (rejwork_t*) arg;
+  unsigned int b, k, *acc;
+  tuple_t x;
+  qrng_t G;
+
+  /* allocate the index tuple and the generator. */
+  if (!tupalloc(&x, tupsize(W->N)) || !qrngalloc(&G, tupsize(W->N) + 1)) {
+    W->ret = 0;
+    return NULL;
+  }
+
+  /* claim blocks until none remain. */
+  while ((b = __atomic_fetch_add(&W->next, 1, __ATOMIC_RELAXED)) <
+         W->nblk) {
+    /* position the generator at the first term of the block. */
+    qrngseek(&G, W->base + (unsigned long) b * REJ_BLOCK);
+
+    /* record the accepted candidates of the block, in sequence order. */
+    acc = W->acc + b * REJ_BLOCK;
+    for (k = 0, W->nacc[b] = 0; k < REJ_BLOCK; k++) {
+      if (rejsamp(&G, &W->pdf, &x, &W->P, acc + W->nacc[b])) {
+        W->term[b * REJ_BLOCK + W->nacc[b]] = k;
+        W->nacc[b]++;
+      }
+    }
+  }
+
+  /* free the generator and the index tuple. */
+  qrngfree(&G);
+  tupfree(&x);
+  return NULL;
+}
+
+/* rejround(): draw a round of candidate blocks on several threads,
+ * including the calling thread.
+ *
+ * arguments:
+ *  @W: pointer to the shared state of the threads.
+ *  @nthr: number of threads to use.
+ */
+void rejround (rejwork_t *W, unsigned int nthr) {
+  /* draw the blocks from the first one, on no more threads than there
+   * are blocks.
+   */
+  W->next = 0;
+  thrrun(rejthread, W, nthr < W->nblk ? nthr : W->nblk);
+}
+
+/* rejdraw(): draw the points of a rejection sampling schedule from an
+ * evaluated density grid, starting at a given term of the quasirandom
+ * sequence. the points are returned in the order they were first drawn,
+ * so any prefix of them is the schedule of a smaller draw.
+ *
+ * points that were already sampled are placed first, and the draw only
+ * adds the remaining points. resuming a draw at the term that followed
+ * its last point thus yields the same points as a single larger draw.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of grid sizes.
+ *  @pdf: pointer to the density values, normalized by their largest value.
+ *  @n: number of points to sample.
+ *  @pre: pointer to the tuple of points already sampled, or NULL.
+ *  @base: index of the first quasirandom term to draw.
+ *  @nthr: number of threads to draw candidates with.
+ *  @ord: pointer to the output tuple of indices, in draw order.
+ *  @end: pointer to the output index of the next undrawn term, or NULL.
+ *
+ * returns:
+ *  integer indicating whether sampling succeeded (1) or not (0).
+ */
+int rejdraw (tuple_t *N, const pdfview_t *pdf, unsigned int n,
+             tuple_t *pre, unsigned long base, unsigned int nthr,
+             tuple_t *ord, unsigned long *end) {
+  /* declare required variables:
+   *  @W: shared state of the candidate drawing threads.
+   *  @Tlst: binary search tree for index storage.
+   *  @b, @k: block and accepted index loop counters.
+   *  @m: number of points drawn before each insertion.
+   *  @pos: index of the term after the last drawn point.
+   *  @ret: whether sampling succeeded.
+   */
+  unsigned int b, k, m;
+  unsigned long pos;
+  rejwork_t W;
+  bst_t *Tlst;
+  int ret;
+
+  /* initialize the output tuple, the binary search tree, and the
+   * accepted indices, so that all failures may share the same cleanup.
+   */
+  tupinit(ord);
+  Tlst = NULL;
+  pos = base;
+  W.acc = W.term = W.nacc = NULL;
+  ret = 0;
+
+  /* place the points that were already sampled. */
+  for (k = 0; pre && k < tupsize(pre); k++) {
+    m = (Tlst ? Tlst->n + 1 : 0);
+    Tlst = bstinsert(Tlst, tupget(pre, k));
+    if (Tlst->n + 1 > m && !tupappend(ord, tupget(pre, k)))
+      goto done;
+  }
+
+  /* allocate the accepted indices of each block. */
+  W.N = N;
+  W.pdf = *pdf;
+  tupgridinit(&W.P, N);
+  W.acc = (unsigned int*)
+    malloc(REJ_BLOCKS_MAX * REJ_BLOCK * sizeof(unsigned int));
+  W.term = (unsigned int*)
+    malloc(REJ_BLOCKS_MAX * REJ_BLOCK * sizeof(unsigned int));
+  W.nacc = (unsigned int*) malloc(REJ_BLOCKS_MAX * sizeof(unsigned int));
+  if (!W.acc || !W.term || !W.nacc) {
+    /* output an error message and return failure. */
+    fprintf(stderr, "error: failed to allocate candidate blocks\n");
+    goto done;
+  }
+
+  /* draw candidates from at least one thread. */
+  nthr = (nthr > 1 ? nthr : 1);
+
+  /* draw rounds of candidate blocks, starting at the first sequence term
+   * and growing each round, until enough points have been accepted.
+   */
+  W.base = base;
+  W.nblk = (nthr < REJ_BLOCKS_MAX ? nthr : REJ_BLOCKS_MAX);
+  while (n && !(Tlst && Tlst->n + 1 >= n)) {
+    /* draw the candidates of the round. */
+    W.ret = 1;
+    rejround(&W, nthr);
+    if (!W.ret) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to draw candidate blocks\n");
+      goto done;
+    }
+
+    /* replay the accepted candidates in sequence order, stopping at the
+     * same term as a serial draw would.
+     */
+    for (b = 0; b < W.nblk && !(Tlst && Tlst->n + 1 >= n); b++) {
+      for (k = 0; k < W.nacc[b]; k++) {
+        /* insert the accepted value into the search tree. */
+        m = (Tlst ? Tlst->n + 1 : 0);
+        Tlst = bstinsert(Tlst, W.acc[b * REJ_BLOCK + k]);
+
+        /* record values that were not drawn before. */
+        if (Tlst->n + 1 > m && !tupappend(ord, W.acc[b * REJ_BLOCK + k]))
+          goto done;
+
+        /* stop after the term of the final point. */
+        if (Tlst->n + 1 >= n) {
+          pos = W.base + (unsigned long) b * REJ_BLOCK +
+                W.term[b * REJ_BLOCK + k] + 1;
+          break;
+        }
+      }
+    }
+
+    /* advance to the next round. */
+    W.base += (unsigned long) W.nblk * REJ_BLOCK;
+    W.nblk = (2 * W.nblk < REJ_BLOCKS_MAX ? 2 * W.nblk : REJ_BLOCKS_MAX);
+  }
+
+  /* store the next undrawn term. */
+  if (end)
+    *end = pos;
+
+  ret = 1;
+
+  /* free the search tree and the accepted indices, and on failure the
+   * output tuple. every failure returns through here.
+   */
+done:
+  bstfree(Tlst);
+  free(W.nacc);
+  free(W.term);
+  free(W.acc);
+  if (!ret)
+    tupfree(ord);
 
-    /* construct the grid index. */
-    for (i = 0; i < tupsize(x); i++) {
-      G->x[i] *= ((double) (tupget(N, i) - 1));
-      tupset(x, i, (unsigned int) round(G->x[i]));
+  /* return the final status. */
+  return ret;
+}
+
+/* rejmember(): claim and draw the members of a schedule ensemble until
+ * none remain, or a member fails.
+ *
+ * arguments:
+ *  @arg: pointer to the shared state of the ensemble threads.
+ *
+ * returns:
+ *  NULL.
+ */
+void *rejmember (void *arg) {
+  /* declare required variables:
+   *  @E: pointer to the shared state of the ensemble threads.
+   *  @e: index of the claimed member.
+   *  @i, @j: point and density loop counters.
+   *  @base: first quasirandom term of the member.
+   *  @Tlst: binary search tree for sorting each schedule.
+   *  @ord: points of the member, in draw order.
+   */
+  rejens_t *E = (rejens_t*) arg;
+  unsigned int e, i, j;
+  unsigned long base;
+  bst_t *Tlst;
+  tuple_t ord;
+
+  /* claim members until none remain, or a member fails. */
+  while (__atomic_load_n(&E->ret, __ATOMIC_RELAXED)) {
+    e = __atomic_fetch_add(&E->next, 1, __ATOMIC_RELAXED);
+    if (e >= E->nens)
+      break;
+
+    /* draw the member from its own substream, or resume a single member
+     * from a given term.
+     */
+    base = ((unsigned long) e * E->nshard + E->shard) * REJ_SHARD_TERMS;
+    base = (E->nens == 1 && E->pos ? E->pos : base);
+    if (!rejdraw(E->N, &E->pdf, E->n, E->pre, base, E->nthr, &ord,
+                 E->nens == 1 ? &E->pos : NULL)) {
+      __atomic_store_n(&E->ret, 0, __ATOMIC_RELAXED);
+      break;
     }
 
-    /* extract the uniform deviate. */
-    u = G->x[G->n - 1];
+    /* sort the first points drawn into the schedule of each density. */
+    for (j = 0; j < E->nd; j++) {
+      for (i = 0, Tlst = NULL; i < E->cnt[j] && i < tupsize(&ord); i++)
+        Tlst = bstinsert(Tlst, tupget(&ord, i));
 
-    /* extract the density value. */
-    tuppack(x, N, &i);
-    p = pdf[i];
+      bstsort(Tlst, E->lst + e * E->nd + j);
+      bstfree(Tlst);
+    }
+
+    /* free the drawn points. */
+    tupfree(&ord);
   }
-  while (u > p);
+
+  return NULL;
 }
 
 /* rej(): generate a list of linear indices that represent the quasirandom
@@ -66,108 +331,217 @@ void rejsamp (qrng_t *G, double *pdf, tuple_t *x, tuple_t *N) {
  * parameters.
  *
  * arguments:
- *  @fn: string representation of the gap equation.
+ *  @E: pointer to the evaluation context of the density function.
  *  @N: pointer to the tuple of Nyquist grid sizes.
- *  @d: desired sampling density.
- *  @lst: pointer to the output tuple of indices.
+ *  @d: array of desired sampling densities.
+ *  @nd: number of sampling densities.
+ *  @opt: pointer to the sampling options.
+ *  @lst: array of output tuples of indices, holding the schedule of each
+ *        density for the first ensemble member, then the second, etc.
  *
  * returns:
  *  integer indicating whether sampling succeeded (1) or not (0).
  */
-int rej (const char *fn, tuple_t *N, double d, tuple_t *lst) {
+int rej (evalctx_t *E, tuple_t *N, const double *d, unsigned int nd,
+         const rejopt_t *opt, tuple_t *lst) {
   /* declare required variables:
    *  @pdf: probability density function, evaluated on the grid.
-   *  @pdfmax: largest value of @pdf over the entire data grid.
-   *  @x: unpacked grid point index for density evaluation.
-   *  @Tlst: binary search tree for index storage.
-   *  @G: quasirandom number generator structure.
-   *  @i: term generation loop counter.
+   *  @M: shared state of the ensemble threads.
    *  @n: term generation loop size.
-   *  @xi: packed linear index.
+   *  @cnt: number of points in the schedule of each density.
+   *  @Nk: grid sizes of the sampled shard.
+   *  @lo, @hi: first and final (exclusive) linear indices of the sampled
+   *            shard.
+   *  @mass: fraction of the density mass in the sampled shard.
+   *  @c: cumulative density mass at the edges of an evaluated shard.
+   *  @pk: density values of the sampled shard.
+   *  @flt: single precision density values of the sampled shard.
+   *  @V: view of the sampled density values.
+   *  @pre: points already sampled within the shard.
+   *  @e, @j, @k: member, density and index loop counters.
+   *  @nthr: number of ensemble threads.
    */
-  unsigned int i, n, xi;
-  double *pdf, pdfmax;
-  bst_t *Tlst;
-  tuple_t x;
-  qrng_t G;
+  unsigned int n, lo, hi, e, j, k, nthr, *cnt;
+  double *pdf, *pk, mass, c[3];
+  pdfview_t V;
+  float *flt;
+  tuple_t Nk, pre;
+  rejens_t M;
 
-  /* initialize the output tuple. */
-  tupinit(lst);
+  /* initialize the output tuples. */
+  for (e = 0; e < opt->nens * nd; e++)
+    tupinit(lst + e);
 
-  /* initialize the binary search tree. */
-  Tlst = NULL;
-
-  /* allocate the index tuple. */
-  if (!tupalloc(&x, tupsize(N))) {
+  /* check that only a single schedule is resumed. */
+  if (opt->pos && opt->nens > 1) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to allocate index tuple\n");
+    fprintf(stderr, "error: an ensemble cannot be resumed\n");
     return 0;
   }
 
-  /* initialize the density function evaluation environment. */
-  if (!evalinit(fn, EVAL_PDF)) {
+  /* allocate the schedule sizes. */
+  cnt = (unsigned int*) calloc(nd, sizeof(unsigned int));
+  if (!cnt) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to compile density equation\n");
+    fprintf(stderr, "error: failed to allocate schedule sizes\n");
     return 0;
   }
 
-  /* initialize the quasirandom number generator. */
-  if (!qrngalloc(&G, tupsize(N) + 1)) {
-    /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to initialize quasirandom generator\n");
-    return 0;
-  }
+  /* evaluate the densities, normalized by their largest value, unless
+   * they were given. a single shard only keeps its own values, and single
+   * precision grids are evaluated without a double precision copy.
+   */
+  pdf = NULL;
+  flt = NULL;
+  if (opt->pdf)
+    pdf = opt->pdf;
+  else if (opt->nshard > 1)
+    pdf = pdfslab(E, N, PDF_NORM_MAX, opt->shard, opt->nshard, opt->nthr, c);
+  else if (opt->prec == PDF_PREC_FLOAT)
+    flt = pdfgrid32(E, N, PDF_NORM_MAX, opt->nthr, opt->err);
+  else
+    pdf = pdfgrid(E, N, PDF_NORM_MAX, opt->nthr);
 
-  /* allocate the density values array. */
-  pdf = (double*) calloc(tupprod(N), sizeof(double));
-  if (!pdf) {
+  if (!pdf && !flt) {
     /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to allocate density values array\n");
+    fprintf(stderr, "error: failed to evaluate density values array\n");
     return 0;
   }
 
-  /* compute the desired number of sampled grid points. */
-  n = (unsigned int) round(d * (double) tupprod(N));
+  /* compute the desired number of sampled grid points of each density,
+   * and draw enough points for the largest.
+   */
+  for (j = 0, n = 0; j < nd; j++) {
+    cnt[j] = (unsigned int) round(d[j] * (double) tupprod(N));
 
-  /* loop over the grid points. */
-  for (i = 0, pdfmax = 0.0; i < tupprod(N); i++) {
-    /* unpack the linear index. */
-    tupunpack(i, N, &x);
+    /* restrict sampling to a single shard of the grid, if requested. */
+    if (opt->nshard > 1 && opt->pdf) {
+      if (!pdfshard(N, pdf, cnt[j], opt->shard, opt->nshard,
+                    &Nk, &lo, cnt + j, &mass)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compute grid shard\n");
+        return 0;
+      }
+    }
+    else if (opt->nshard > 1) {
+      /* a shard of an evaluated grid only holds its own values, and its
+       * points are apportioned by the sums of the evaluation.
+       */
+      if (!pdfrows(N, opt->shard, opt->nshard, &Nk, &lo, &hi)) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to compute grid shard\n");
+        return 0;
+      }
 
-    /* evaluate the density function. */
-    if (evalpdf(pdf + i, &x, N) != EVAL_OK)
+      pdfsplit(c, cnt[j], opt->shard, opt->nshard, cnt + j, &mass);
+    }
+    else if (tupdup(&Nk, N)) {
+      /* sample the entire grid. */
+      lo = 0;
+    }
+    else {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate tuples\n");
       return 0;
+    }
 
-    /* check for a new maximum value. */
-    if (pdf[i] > pdfmax)
-      pdfmax = pdf[i];
+    /* the historical schedule holds one more point than its density
+     * implies, as the search tree does not count its root. assign that
+     * point to the final shard, so the merged shards match an unsharded
+     * schedule in size.
+     */
+    cnt[j] += (opt->shard == opt->nshard - 1 || opt->nshard <= 1 ? 1 : 0);
+    n = (cnt[j] > n ? cnt[j] : n);
+
+    /* keep the shard sizes of the final density. */
+    if (j < nd - 1)
+      tupfree(&Nk);
   }
 
-  /* normalize the evaluated densities. */
-  for (i = 0; i < tupprod(N); i++)
-    pdf[i] /= pdfmax;
+  /* locate the density values of the sampled shard, which are the only
+   * values of an evaluated shard.
+   */
+  pk = (!pdf ? NULL : opt->pdf || opt->nshard <= 1 ? pdf + lo : pdf);
+
+  /* narrow the values of the sampled shard to single precision, if they
+   * were not evaluated that way.
+   */
+  if (opt->prec == PDF_PREC_FLOAT && !flt) {
+    flt = pdfnarrow(pk, tupprod(&Nk), opt->err);
+    if (!flt) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate density values\n");
+      return 0;
+    }
 
-  /* loop over the number of grid points to compute. */
-  do {
-    /* sample a new value on the grid. */
-    rejsamp(&G, pdf, &x, N);
+    /* release the double precision values, unless they were given. */
+    if (!opt->pdf)
+      pdfrelease(pdf);
 
-    /* pack and insert the new value into the search tree. */
-    tuppack(&x, N, &xi);
-    Tlst = bstinsert(Tlst, xi);
+    pdf = NULL;
   }
-  while (Tlst->n < n);
 
-  /* dump the sorted samples from the search tree. */
-  bstsort(Tlst, lst);
-  bstfree(Tlst);
+  /* view the sampled density values. */
+  V.d = (flt ? NULL : pk);
+  V.f = flt;
+
+  /* gather the points already sampled within the shard. */
+  tupinit(&pre);
+  for (k = 0; opt->pre && k < tupsize(opt->pre); k++) {
+    e = tupget(opt->pre, k);
+    if (e >= lo && e - lo < tupprod(&Nk) && !tupappend(&pre, e - lo)) {
+      /* output an error message and return failure. */
+      fprintf(stderr, "error: failed to allocate sampled points\n");
+      return 0;
+    }
+  }
+
+  /* initialize the shared state of the ensemble threads. each member is
+   * drawn by one thread, and the remaining threads draw its candidates.
+   */
+  nthr = (opt->nthr > 1 ? opt->nthr : 1);
+  nthr = (nthr < opt->nens ? nthr : opt->nens);
+  M.N = &Nk;
+  M.pdf = V;
+  M.lst = lst;
+  M.cnt = cnt;
+  M.pre = &pre;
+  M.pos = (opt->pos ? *opt->pos : 0);
+  M.n = n;
+  M.nd = nd;
+  M.shard = (opt->nshard > 1 ? opt->shard : 0);
+  M.nshard = (opt->nshard > 1 ? opt->nshard : 1);
+  M.nens = opt->nens;
+  M.nthr = (opt->nthr > nthr ? opt->nthr / nthr : 1);
+  M.next = 0;
+  M.ret = 1;
+
+  /* draw the members on the ensemble threads. */
+  thrrun(rejmember, &M, nthr);
+
+  /* check that every member was drawn. */
+  if (!M.ret)
+    return 0;
+
+  /* store the term to resume the schedule from. */
+  if (opt->pos)
+    *opt->pos = M.pos;
+
+  /* shift the samples from the shard grid onto the entire grid. */
+  for (e = 0; e < opt->nens * nd; e++) {
+    for (k = 0; k < tupsize(lst + e); k++)
+      tupset(lst + e, k, tupget(lst + e, k) + lo);
+  }
 
   /* free the allocated memory. */
-  qrngfree(&G);
-  tupfree(&x);
-  free(pdf);
+  tupfree(&pre);
+  tupfree(&Nk);
+  free(cnt);
+  if (!opt->pdf)
+    pdfrelease(pdf);
+
+  pdfrelease(flt);
 
   /* return success. */
   return 1;
 }
-
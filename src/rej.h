@@ -29,18 +29,133 @@
 #include <stdlib.h>
 #include <math.h>
 
+/* include the posix threads header. */
+#include <pthread.h>
+
 /* include the julia library header. */
 #include <julia.h>
 
-/* include the tuple, search tree, qrng and evaluation headers. */
+/* include the tuple, search tree, qrng, evaluation, density grid and
+ * thread headers.
+ */
 #include "tup.h"
 #include "bst.h"
 #include "qrng.h"
 #include "eval.h"
+#include "pdf.h"
+#include "thr.h"
+
+/* define the number of sequence terms in each block of candidates, and
+ * the largest number of blocks drawn in each round. the blocks are drawn
+ * in parallel, and their acceptances are replayed in sequence order.
+ */
+#define REJ_BLOCK       1024
+#define REJ_BLOCKS_MAX  256
+
+/* define the spacing between the quasirandom substreams of successive
+ * grid shards and ensemble members.
+ */
+#define REJ_SHARD_TERMS  4294967291UL
+
+/* rejwork_t: type definition of the shared state of the threads that
+ * draw blocks of rejection sampling candidates.
+ */
+typedef struct {
+  /* @N: pointer to the tuple of Nyquist grid sizes.
+   * @P: index kernels of the grid.
+   * @pdf: view of the normalized density values.
+   * @acc: array of accepted packed indices of each block.
+   * @term: array of the term offsets of the accepted indices.
+   * @nacc: number of accepted indices in each block.
+   */
+  tuple_t *N;
+  tupgrid_t P;
+  pdfview_t pdf;
+  unsigned int *acc, *term, *nacc;
+
+  /* @base: sequence index of the first term of the round.
+   * @nblk: number of blocks in the round.
+   * @next: index of the next block to claim.
+   * @ret: status of the round.
+   */
+  unsigned long base;
+  unsigned int nblk, next;
+  int ret;
+}
+rejwork_t;
+
+/* rejens_t: type definition of the shared state of the threads that draw
+ * the members of a schedule ensemble.
+ */
+typedef struct {
+  /* @N: pointer to the tuple of shard grid sizes.
+   * @pdf: view of the normalized density values of the shard.
+   * @lst: array of output tuples of each member and density.
+   * @cnt: number of points in the schedule of each density.
+   * @pre: pointer to the tuple of points already in every schedule.
+   */
+  tuple_t *N;
+  pdfview_t pdf;
+  tuple_t *lst;
+  unsigned int *cnt;
+  tuple_t *pre;
+
+  /* @pos: first quasirandom term of a single member, or zero to start
+   *       at its substream. updated to the next undrawn term.
+   */
+  unsigned long pos;
+
+  /* @n: number of points to draw for the largest density.
+   * @nd: number of sampling densities.
+   * @shard, @nshard: index and number of grid shards.
+   * @nens: number of ensemble members.
+   * @nthr: number of threads to draw the candidates of each member with.
+   * @next: index of the next member to claim.
+   * @ret: status of the ensemble.
+   */
+  unsigned int n, nd, shard, nshard, nens, nthr, next;
+  int ret;
+}
+rejens_t;
+
+/* rejopt_t: type definition of the options of rejection sampling. */
+typedef struct {
+  /* @nthr: number of threads to evaluate and sample the density with.
+   * @shard: index of the grid shard to sample, in [0,nshard).
+   * @nshard: number of grid shards, or one to sample the entire grid.
+   * @nens: number of decorrelated schedules to draw.
+   */
+  unsigned int nthr, shard, nshard, nens;
+
+  /* @pre: pointer to the tuple of packed indices already sampled, which
+   *       every schedule is extended from, or NULL.
+   * @pos: pointer to the quasirandom term to resume a single schedule
+   *       from, or NULL. a zero term starts at the substream of the
+   *       shard. updated to the next undrawn term.
+   */
+  tuple_t *pre;
+  unsigned long *pos;
+
+  /* @pdf: density values on the entire grid, normalized by their
+   *       largest value as computed by pdfgrid(), or NULL to evaluate
+   *       them. the values are only read, and remain owned by the caller.
+   */
+  double *pdf;
+
+  /* @prec: precision of the sampled density values. single precision
+   *        halves their memory, and given values are narrowed.
+   * @err: pointer to the output maximum relative error of the single
+   *       precision values, or NULL.
+   */
+  pdfprec_t prec;
+  double *err;
+}
+rejopt_t;
 
 /* function declarations: */
 
-int rej (const char *fn, tuple_t *N, double d, tuple_t *lst);
+int rej (evalctx_t *E, tuple_t *N, const double *d, unsigned int nd,
+         const rejopt_t *opt, tuple_t *lst);
 
 #endif /* !__NUSUTILS_REJ_H__ */
 
@@ -27,89 +27,200 @@
  */
 #define SEQ_MAX_ITER  100     /* maximum number of iterations. */
 #define SEQ_EPSILON   0.005   /* error threshold of convergence. */
+#define SEQ_SPREAD    0.05    /* maximum relative spread of the lanes. */
+#define SEQ_EXACT     0.02    /* error threshold of exact-count mode. */
+#define SEQ_NARROW    1.0e-6  /* relative width of a collapsed bracket. */
 
-/* seqappend(): append a single vector of linear indices that represent
- * the deterministic gap sequence along a unidimensional path,
- * given a few input parameters.
+/* define constants that determine when and how the seq() optimizer first
+ * converges on a subset of grid lines before running full passes.
+ */
+#define SEQ_COARSE_LINES   512   /* target number of subset lines. */
+#define SEQ_COARSE_MIN      64   /* minimum line count ratio to subset. */
+#define SEQ_COARSE_ROUNDS    2   /* full passes preceded by subset runs. */
+
+/* seqgaps(): record a sequence step in the gaps of the grid points that
+ * it reached or passed over. the gaps may be updated by several threads
+ * at once.
  *
  * arguments:
- *  @N: pointer to the tuple of Nyquist grid sizes.
- *  @L: sequence term scaling factor to use during computation.
- *  @origin: origin at which to begin the sequence.
- *  @dir: direction along which to append the vector.
- *  @Tlst: pointer to the output tree of indices.
+ *  @P: pointer to the state of the current pass.
+ *  @oridx: linear index value of the line origin.
+ *  @stride: linear index stride along the line.
+ *  @x0: sequence term before the step.
+ *  @x1: sequence term after the step.
+ *  @xend: maximum value allowed for sequence terms.
+ */
+void seqgaps (seqpass_t *P, unsigned int oridx, unsigned int stride,
+              double x0, double x1, double xend) {
+  /* declare required variables:
+   *  @q, @qend: first and last grid positions along the line.
+   *  @xi: linear grid index.
+   *  @g, @gx: step size and recorded gap.
+   */
+  double q, qend;
+  unsigned int xi;
+  float g, gx;
+
+  /* compute the step size and the positions covered by the step. */
+  g = (float) (x1 - x0);
+  q = round(x0 - 1.0) + 1.0;
+  qend = round(x1 - 1.0);
+  qend = (qend > xend - 1.0 ? xend - 1.0 : qend);
+
+  /* keep the smallest step at each position. */
+  for (; q <= qend; q += 1.0) {
+    xi = oridx + stride * (unsigned int) q;
+    __atomic_load(P->gap + xi, &gx, __ATOMIC_RELAXED);
+    while (g < gx && !__atomic_compare_exchange(P->gap + xi, &gx, &g, 0,
+                                                __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED));
+  }
+}
+
+/* seqline(): traverse a single line of the pass, inserting the linear
+ * indices of the deterministic gap sequence along the line into the set
+ * of every running lane. the poisson-distributed terms of each line are
+ * drawn from a substream of quasirandom terms positioned by the line
+ * index, so each line only depends on its index and the scaling factors.
+ *
+ * arguments:
+ *  @W: pointer to the state of the traversing worker.
+ *  @j: index of the line in the pass.
  *
  * returns:
- *  integer indicating whether the function succeeded (1) or not (0).
+ *  integer indicating whether the function succeeded (1) or not.
  */
-int seqappend (tuple_t *N, double L, tuple_t *origin, unsigned int dir,
-               bst_t *Tlst) {
+int seqline (seqwork_t *W, unsigned int j) {
   /* declare required variables:
+   *  @P: pointer to the state of the pass.
    *  @xi: output packed linear sequence index.
    *  @oridx: linear index value of the origin.
    *  @stride: linear index stride from the origin.
-   *  @x: current floating-point sequence term.
+   *  @dir: direction of the line.
+   *  @insub: whether the line belongs to the coarse subset.
+   *  @i, @k: lane loop counters.
+   *  @K: number of lanes still advancing along the line.
+   *  @act: indices of the lanes still advancing along the line.
+   *  @x: current floating-point sequence terms of each lane.
+   *  @x0: previous sequence term of the first lane.
+   *  @L: sequence term scaling factors of each lane.
+   *  @rng: quasirandom number generators of each lane.
+   *  @st: well-behaved flags of each lane.
    *  @xend: maximum value allowed for @x.
    *  @ret: return value from the term() function.
    */
-  unsigned int xi, oridx, stride;
-  double x, xend;
+  unsigned int xi, oridx, stride, dir, insub, i, k, K;
+  unsigned int act[SEQ_MAX_LANES];
+  int st[SEQ_MAX_LANES];
+  double x[SEQ_MAX_LANES], L[SEQ_MAX_LANES];
+  qrng_t *rng[SEQ_MAX_LANES];
+  seqpass_t *P = W->P;
+  double xend, x0;
   int ret;
 
-  /* pack the origin into a linear index. */
-  tuppack(origin, N, &oridx);
+  /* determine whether the line belongs to the coarse subset, and skip
+   * it if only subset lines are being traversed.
+   */
+  insub = (P->sub && j % P->sub == 0);
+  if (P->coarse && !insub)
+    return 1;
+
+  /* gather the running lanes, and position their quasirandom terms. */
+  for (k = 0, K = 0; k < P->K; k++) {
+    if (P->lane[k].stat != EVAL_OK || W->inv[k])
+      continue;
+
+    act[K] = k;
+    x[K] = 0.0;
+    L[K] = P->lane[k].L;
+    rng[K] = W->rng + k;
+    qrngseek(rng[K], (unsigned long) j * SEQ_BLOCK + 1);
+    K++;
+  }
+
+  /* unpack the origin of the line. */
+  oridx = P->lines[j].oridx;
+  dir = P->lines[j].dir;
+  tupunpack(oridx, P->N, &W->O);
 
   /* compute the linear stride along the current direction. */
-  stride = tupstride(N, dir);
+  stride = tupstride(P->N, dir);
 
   /* compute the maximum allowed sequence value. */
-  xend = (double) tupget(N, dir) - (double) tupget(origin, dir);
+  xend = (double) tupget(P->N, dir) - (double) tupget(&W->O, dir);
 
-  /* initialize the sequence value. */
-  x = 0.0;
-
-  /* loop over the terms of the sequence. */
-  do {
-    /* compute the next term in the sequence, but return failure
-     * if the sequence is not well-behaved.
-     */
-    ret = evalgap(&x, dir, origin, N, L);
+  /* loop over the terms of the sequences. */
+  while (K) {
+    /* compute the next term in every sequence. */
+    x0 = x[0];
+    ret = evalgapv(P->E, x, dir, &W->O, P->N, L, rng, st, K);
     if (ret != EVAL_OK)
       return ret;
 
-    /* ensure the computed term is in bounds. */
-    if (round(x) <= xend) {
+    /* record the step of a single-lane pass. */
+    if (P->gap && st[0] == EVAL_OK)
+      seqgaps(P, oridx, stride, x0, x[0], xend);
+
+    /* loop over the lanes that computed a new term. */
+    for (i = 0; i < K;) {
+      /* stop the lane if its sequence is not well-behaved. */
+      if (st[i] != EVAL_OK)
+        W->inv[act[i]] = 1;
+
+      /* drop the lane from the line once its term leaves the grid. */
+      if (st[i] != EVAL_OK || round(x[i]) > xend) {
+        K--;
+        act[i] = act[K];
+        x[i] = x[K];
+        L[i] = L[K];
+        rng[i] = rng[K];
+        st[i] = st[K];
+        continue;
+      }
+
       /* compute the new index value. */
-      xi = oridx + stride * (unsigned int) round(x - 1.0);
+      k = act[i];
+      xi = oridx + stride * (unsigned int) round(x[i] - 1.0);
+
+      /* insert the new value into the lane set. */
+      if (setinsertmt(&P->lane[k].S, xi))
+        W->nnew[k]++;
 
-      /* insert the new value to the output search tree. */
-      bstinsert(Tlst, xi);
+      /* count the term towards the coarse estimate. */
+      if (insub)
+        W->hsub[k]++;
+
+      i++;
     }
   }
-  while (round(x) <= xend);
+
+  /* count the completed subset line in each running lane. */
+  for (k = 0; insub && k < P->K; k++) {
+    if (P->lane[k].stat == EVAL_OK && !W->inv[k])
+      W->nsub[k]++;
+  }
 
   /* return success. */
   return 1;
 }
 
-/* seqfn(): generate a sub-sequence of deterministic gap samples originating
- * from a specified point and filling a specified region. recursively
- * calls itself until the lowest level (a single vector of samples)
- * is reached at each (origin, mask) pair.
+/* seqfn(): enumerate the lines of a sub-sequence of deterministic gap
+ * samples originating from a specified point and filling a specified
+ * region. recursively calls itself until the lowest level (a single
+ * vector of samples) is reached at each (origin, mask) pair, where the
+ * line is appended to the pass.
  *
  * arguments:
  *  @N: pointer to the tuple of Nyquist grid sizes.
- *  @L: sequence term scaling factor to use during computation.
  *  @origin: current origin from which to generate subsequences.
  *  @mask: current available dimensions for new subsequences.
- *  @Tlst: pointer to the output tree of indices.
+ *  @P: pointer to the state of the pass.
  *
  * returns:
  *  integer indicating whether sub-sequence generation
  *  succeeded (1) or not (0).
  */
-int seqfn (tuple_t *N, double L, tuple_t *origin, tuple_t *mask,
-           bst_t *Tlst) {
+int seqfn (tuple_t *N, tuple_t *origin, tuple_t *mask, seqpass_t *P) {
   /* declare required variables:
    *  @i: general-purpose loop index.
    *  @pos: offset position of the current sub-sequence.
@@ -128,8 +239,11 @@ int seqfn (tuple_t *N, double L, tuple_t *origin, tuple_t *mask,
     /* determine the append direction. */
     dir = tupfind(mask) - 1;
 
-    /* drop a single vector of sequence terms down. */
-    return seqappend(N, L, origin, dir, Tlst);
+    /* append a single line to the pass. */
+    tuppack(origin, N, &P->lines[P->nlines].oridx);
+    P->lines[P->nlines].dir = dir;
+    P->nlines++;
+    return 1;
   }
 
   /* allocate the sub-level origin and mask tuples. */
@@ -158,11 +272,15 @@ int seqfn (tuple_t *N, double L, tuple_t *origin, tuple_t *mask,
         tupset(&suborigin, i, i == dir ? pos : tupget(origin, i));
 
       /* execute this function at a lower level of recursion. */
-      ret = seqfn(N, L, &suborigin, &submask, Tlst);
+      ret = seqfn(N, &suborigin, &submask, P);
 
       /* check that execution succeeded. */
-      if (ret != EVAL_OK)
+      if (ret != EVAL_OK) {
+        /* free the allocated tuples and pass the failure upwards. */
+        tupfree(&suborigin);
+        tupfree(&submask);
         return ret;
+      }
     }
   }
 
@@ -174,125 +292,1083 @@ int seqfn (tuple_t *N, double L, tuple_t *origin, tuple_t *mask,
   return 1;
 }
 
+/* seqlines(): compute the number of lines that seqfn() traverses when
+ * called with a given mask.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @mask: current available dimensions for new subsequences.
+ *
+ * returns:
+ *  number of lines traversed by the recursion.
+ */
+unsigned int seqlines (tuple_t *N, tuple_t *mask) {
+  /* declare required variables:
+   *  @dir: pivot direction of the current sub-sequence.
+   *  @n: number of lines traversed.
+   */
+  unsigned int dir, n;
+
+  /* a leaf of the recursion tree is a single line. */
+  if (tupsum(mask) == 1)
+    return 1;
+
+  /* sum the lines below each position along each pivot direction. */
+  for (dir = 0, n = 0; dir < tupsize(mask); dir++) {
+    if (!tupget(mask, dir))
+      continue;
+
+    /* descend with the current direction masked off. */
+    tupset(mask, dir, 0);
+    n += tupget(N, dir) * seqlines(N, mask);
+    tupset(mask, dir, 1);
+  }
+
+  /* return the computed result. */
+  return n;
+}
+
+/* seqsync(): wait until every worker thread of a pass has reached the
+ * same point of execution.
+ *
+ * arguments:
+ *  @P: pointer to the state of the pass.
+ *
+ * returns:
+ *  integer indicating whether the calling thread was the last to arrive
+ *  (1) or not (0). exactly one thread receives a nonzero value.
+ */
+int seqsync (seqpass_t *P) {
+  /* declare required variables:
+   *  @gen: synchronization count on arrival.
+   *  @last: whether the calling thread arrived last.
+   */
+  unsigned int gen;
+  int last;
+
+  /* a single thread is always synchronized. */
+  if (P->nthr <= 1)
+    return 1;
+
+  /* count the arrival, releasing the others if it is the last. */
+  pthread_mutex_lock(&P->mtx);
+  last = (++P->nsync >= P->nthr);
+  if (last) {
+    P->nsync = 0;
+    P->gen++;
+    pthread_cond_broadcast(&P->cond);
+  }
+  else {
+    /* wait for the last thread to arrive. */
+    for (gen = P->gen; gen == P->gen;)
+      pthread_cond_wait(&P->cond, &P->mtx);
+  }
+
+  /* return whether the thread arrived last. */
+  pthread_mutex_unlock(&P->mtx);
+  return last;
+}
+
+/* seqwave(): complete the current wave of a pass, by merging the counts of
+ * every worker into the lanes and aborting lanes that have grown beyond the
+ * point count limit. only called by a single thread.
+ *
+ * arguments:
+ *  @P: pointer to the state of the pass.
+ */
+void seqwave (seqpass_t *P) {
+  /* declare required variables:
+   *  @W: pointer to the state of the current worker.
+   *  @lane: pointer to the state of the current lane.
+   *  @t, @k: worker and lane loop counters.
+   *  @K: number of lanes still running.
+   */
+  unsigned int t, k, K;
+  seqlane_t *lane;
+  seqwork_t *W;
+
+  /* merge the counts of each worker into the lanes. */
+  for (t = 0; t < P->nthr; t++) {
+    W = P->work + t;
+    for (k = 0; k < P->K; k++) {
+      lane = P->lane + k;
+      lane->S.n += W->nnew[k];
+      lane->nsub += W->nsub[k];
+      lane->hsub += W->hsub[k];
+      W->nnew[k] = W->nsub[k] = W->hsub[k] = 0;
+
+      /* stop the lane if its sequence is not well-behaved. */
+      if (W->inv[k] && lane->stat == EVAL_OK)
+        lane->stat = EVAL_INVALID;
+    }
+
+    /* keep the first failure of any worker. */
+    if (W->ret != EVAL_OK && P->ret == EVAL_OK)
+      P->ret = W->ret;
+  }
+
+  /* complete the wave in each running lane. */
+  for (k = 0, K = 0; k < P->K; k++) {
+    lane = P->lane + k;
+    if (lane->stat != EVAL_OK)
+      continue;
+
+    /* record the running point count after the completed wave. */
+    if (lane->nwaves < tupsize(&lane->cnt))
+      tupset(&lane->cnt, lane->nwaves, lane->S.n);
+    else if (!tupappend(&lane->cnt, lane->S.n))
+      P->ret = 0;
+
+    /* count the completed wave. */
+    lane->nwaves++;
+
+    /* abort the lane once its distinct point count grows beyond the
+     * limit, otherwise keep it running.
+     */
+    if (P->nmax && lane->S.n > P->nmax)
+      lane->stat = SEQ_ABORT;
+    else
+      K++;
+  }
+
+  /* move on to the next wave, or complete the pass. */
+  P->next = P->end;
+  P->end = (P->end + P->wave < P->nlines ? P->end + P->wave : P->nlines);
+  P->done = (P->ret != EVAL_OK || K == 0 || P->next >= P->nlines);
+  if (P->ret == EVAL_OK && K == 0)
+    P->ret = SEQ_ABORT;
+}
+
+/* seqwaves(): wait for a pass to start, and traverse its waves from a
+ * single worker thread. the lines of each wave are claimed one at a time
+ * by the workers, so the lines are balanced between the threads regardless
+ * of their length.
+ *
+ * arguments:
+ *  @W: pointer to the state of the worker.
+ *
+ * returns:
+ *  integer indicating whether a pass was traversed (1) or the worker
+ *  threads must exit (0).
+ */
+int seqwaves (seqwork_t *W) {
+  /* declare required variables:
+   *  @P: pointer to the state of the pass.
+   *  @j: index of the claimed line.
+   */
+  seqpass_t *P = W->P;
+  unsigned int j;
+
+  /* wait for every worker to start the pass. the completion flag of the
+   * previous pass is only reset once every worker has read it.
+   */
+  if (seqsync(P))
+    P->done = 0;
+
+  /* check whether the threads must exit. */
+  if (P->quit)
+    return 0;
+
+  /* loop over the waves of the pass. */
+  do {
+    /* claim and traverse lines until the wave is exhausted. */
+    while (W->ret == EVAL_OK) {
+      j = __atomic_fetch_add(&P->next, 1, __ATOMIC_RELAXED);
+      if (j >= P->end)
+        break;
+
+      W->ret = seqline(W, j);
+    }
+
+    /* let the last thread to finish the wave complete it. */
+    if (seqsync(P))
+      seqwave(P);
+
+    /* wait for the wave to be completed. */
+    seqsync(P);
+  }
+  while (!P->done);
+
+  /* return success. */
+  return 1;
+}
+
+/* seqthread(): main function of the worker threads of a pass, which
+ * traverse the waves of every pass until they are told to exit.
+ *
+ * arguments:
+ *  @arg: pointer to the state of the worker.
+ *
+ * returns:
+ *  NULL.
+ */
+void *seqthread (void *arg) {
+  /* declare required variables:
+   *  @W: pointer to the state of the worker.
+   */
+  seqwork_t *W = (seqwork_t*) arg;
+
+  /* traverse every pass. */
+  while (seqwaves(W));
+
+  /* return nothing. */
+  return NULL;
+}
+
+/* seqpass(): run a single sequence generation pass over the grid.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @P: pointer to the pass state, whose lane count and scaling factors,
+ *      limit and subset are preserved.
+ *
+ * returns:
+ *  integer indicating whether the pass succeeded (1) or not, or
+ *  SEQ_ABORT if every lane of the pass was stopped.
+ */
+int seqpass (tuple_t *N, seqpass_t *P) {
+  /* declare required variables:
+   *  @lane: pointer to the state of the current lane.
+   *  @W: pointer to the state of the current worker.
+   *  @t, @k: worker and lane loop counters.
+   */
+  unsigned int t, k;
+  seqlane_t *lane;
+  seqwork_t *W;
+
+  /* initialize the lanes, holding any points already sampled. */
+  for (k = 0; k < P->K; k++) {
+    lane = P->lane + k;
+    setclear(&lane->S);
+    for (t = 0; P->pre && t < tupsize(P->pre); t++)
+      setinsert(&lane->S, tupget(P->pre, t));
+
+    lane->nwaves = lane->nsub = lane->hsub = 0;
+    lane->stat = EVAL_OK;
+  }
+
+  /* initialize the workers. */
+  for (t = 0; t < P->nthr; t++) {
+    W = P->work + t;
+    for (k = 0; k < SEQ_MAX_LANES; k++) {
+      W->nnew[k] = W->nsub[k] = W->hsub[k] = 0;
+      W->inv[k] = 0;
+    }
+
+    W->ret = EVAL_OK;
+  }
+
+  /* initialize the first wave. */
+  P->N = N;
+  P->next = 0;
+  P->end = (P->wave < P->nlines ? P->wave : P->nlines);
+  P->ret = EVAL_OK;
+
+  /* start the other workers, and traverse the pass. */
+  seqwaves(P->work);
+
+  /* return the final status. */
+  return P->ret;
+}
+
+/* seqstart(): allocate the workers of the passes and start their threads.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @P: pointer to the pass state.
+ *  @nthr: requested number of threads, including the calling thread.
+ *  @K: number of lanes advanced by each worker.
+ *
+ * returns:
+ *  integer indicating whether the workers were allocated (1) or not (0).
+ *  fewer threads than requested are used if they cannot be started.
+ */
+int seqstart (tuple_t *N, seqpass_t *P, unsigned int nthr,
+              unsigned int K) {
+  /* declare required variables:
+   *  @W: pointer to the state of the current worker.
+   *  @t, @k: worker and lane loop counters.
+   */
+  unsigned int t, k;
+  seqwork_t *W;
+
+  /* allocate the worker array. */
+  nthr = (nthr < 1 ? 1 : nthr);
+  P->work = (seqwork_t*) calloc(nthr, sizeof(seqwork_t));
+  if (!P->work)
+    return 0;
+
+  /* allocate the generators and origin of each worker. */
+  for (t = 0; t < nthr; t++) {
+    W = P->work + t;
+    W->P = P;
+    if (!tupalloc(&W->O, tupsize(N)))
+      break;
+
+    for (k = 0; k < K; k++) {
+      if (!qrngalloc(W->rng + k, 1))
+        break;
+    }
+
+    if (k < K)
+      break;
+  }
+
+  /* on failure, free the workers allocated so far. */
+  if (t < nthr) {
+    for (t = 0; t < nthr; t++) {
+      tupfree(&P->work[t].O);
+      for (k = 0; k < SEQ_MAX_LANES; k++)
+        qrngfree(P->work[t].rng + k);
+    }
+
+    free(P->work);
+    P->work = NULL;
+    return 0;
+  }
+
+  /* initialize the synchronization state. */
+  pthread_mutex_init(&P->mtx, NULL);
+  pthread_cond_init(&P->cond, NULL);
+  P->nthr = nthr;
+  P->nsync = P->gen = 0;
+  P->done = P->quit = 0;
+
+  /* start the threads of every worker but the first. */
+  for (t = 1; t < nthr; t++) {
+    if (pthread_create(&P->work[t].thr, NULL, seqthread, P->work + t)) {
+      /* run with the threads started so far. */
+      pthread_mutex_lock(&P->mtx);
+      P->nthr = t;
+      pthread_mutex_unlock(&P->mtx);
+
+      /* free the workers that were not started. */
+      for (; t < nthr; t++) {
+        tupfree(&P->work[t].O);
+        for (k = 0; k < SEQ_MAX_LANES; k++)
+          qrngfree(P->work[t].rng + k);
+      }
+    }
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* seqstop(): stop the threads of the passes and free their workers.
+ *
+ * arguments:
+ *  @P: pointer to the pass state.
+ */
+void seqstop (seqpass_t *P) {
+  /* declare required variables:
+   *  @t, @k: worker and lane loop counters.
+   */
+  unsigned int t, k;
+
+  /* check that workers were allocated. */
+  if (!P->work)
+    return;
+
+  /* tell the threads to exit, and wait for them. */
+  P->quit = 1;
+  seqsync(P);
+  for (t = 1; t < P->nthr; t++)
+    pthread_join(P->work[t].thr, NULL);
+
+  /* free the synchronization primitives. */
+  pthread_mutex_destroy(&P->mtx);
+  pthread_cond_destroy(&P->cond);
+
+  /* free the workers. */
+  for (t = 0; t < P->nthr; t++) {
+    tupfree(&P->work[t].O);
+    for (k = 0; k < SEQ_MAX_LANES; k++)
+      qrngfree(P->work[t].rng + k);
+  }
+
+  free(P->work);
+  P->work = NULL;
+}
+
+/* seqcoarse(): adjust the weight of a scaling factor until the point count
+ * estimated from the subset of grid lines matches the desired count.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @n: desired number of sampled grid points.
+ *  @L: unweighted sequence term scaling factor.
+ *  @w: pointer to the weight of the scaling factor.
+ *  @k: pointer to the ratio of distinct points to estimated terms, which
+ *      is initialized from the subset if zero.
+ *  @nest: pointer to the final estimated point count of a full pass.
+ *  @P: pointer to the pass state, whose subset stride must be set.
+ *
+ * returns:
+ *  integer indicating whether the estimation succeeded (1) or not.
+ */
+int seqcoarse (tuple_t *N, int n, double L, double *w, double *k,
+               int *nest, seqpass_t *P) {
+  /* declare required variables:
+   *  @ret: return value from the seqpass() call.
+   *  @iter: estimation iteration counter.
+   *  @nlines: number of lines in a complete pass.
+   *  @nerr: discrepancy between desired and estimated point counts.
+   *  @ntol: tolerable discrepancy, which is no finer than the count
+   *         represented by a single term on a subset line.
+   *  @lane: pointer to the state of the estimation lane.
+   */
+  unsigned int iter, nlines;
+  seqlane_t *lane;
+  int ret, nerr, ntol;
+
+  /* compute the tolerated estimate error. */
+  ntol = (int) round(SEQ_EPSILON * (double) n);
+  ntol = (ntol < (signed int) P->sub ? (signed int) P->sub : ntol);
+
+  /* only traverse the subset lines in a single lane, without a point
+   * count limit.
+   */
+  P->coarse = 1;
+  P->nmax = 0;
+  P->K = 1;
+
+  /* loop until the estimated size matches the desired sample count. */
+  for (iter = 0; iter < SEQ_MAX_ITER; iter++) {
+    /* run a pass over the subset lines. */
+    P->lane[0].L = *w * L;
+    ret = seqpass(N, P);
+    nlines = P->nlines;
+    lane = P->lane;
+
+    /* check the function's return value. */
+    if (ret != EVAL_OK && ret != SEQ_ABORT)
+      break;
+
+    /* check the status of the lane. */
+    if (lane->stat == EVAL_OK && lane->hsub) {
+      /* initialize the distinct point ratio from the subset itself.
+       * lines from every direction cross at each grid point, so the
+       * subset ratio is divided by the number of directions. this
+       * overestimates the true overlap, so that the first full pass
+       * tends to overshoot and abort early.
+       */
+      if (*k == 0.0)
+        *k = (double) lane->S.n / (double) lane->hsub /
+             (double) tupsize(N);
+
+      /* extrapolate the subset terms to the full grid. */
+      *nest = (signed int) round(*k * (double) lane->hsub *
+                                 (double) nlines / (double) lane->nsub);
+    }
+    else {
+      /* the sequence is empty or poorly behaved. */
+      *nest = (signed int) tupprod(N);
+    }
+
+    /* check if the estimate has converged. */
+    nerr = *nest - n;
+    if (abs(nerr) <= ntol)
+      break;
+
+    /* adjust the scaling factor by an amount proportional to the error. */
+    *w *= (1.0 + 0.5 * (double) nerr / (double) n);
+  }
+
+  /* return to traversing all lines. */
+  P->coarse = 0;
+
+  /* return the final status. */
+  return (ret == SEQ_ABORT ? EVAL_OK : ret);
+}
+
+/* seqrankcmp(): compare two ranked grid points, ordering them by their
+ * recorded step sizes and then by their linear indices.
+ *
+ * arguments:
+ *  @a, @b: pointers to the ranked grid points.
+ *
+ * returns:
+ *  negative, zero or positive integer, for use by qsort().
+ */
+int seqrankcmp (const void *a, const void *b) {
+  /* declare required variables:
+   *  @ra, @rb: typed pointers to the ranked grid points.
+   */
+  const seqrank_t *ra = (const seqrank_t*) a;
+  const seqrank_t *rb = (const seqrank_t*) b;
+
+  /* compare the step sizes, and then the indices. */
+  if (ra->g != rb->g)
+    return (ra->g < rb->g ? -1 : 1);
+
+  return (ra->idx < rb->idx ? -1 : ra->idx > rb->idx ? 1 : 0);
+}
+
+/* seqexact(): add or remove points from the set of a single-lane pass
+ * until it holds exactly the desired number of points. the points that
+ * were reached or passed over by the smallest sequence steps are chosen
+ * first, so surplus points are removed where the schedule is densest,
+ * and missing points are added where the sequence nearly placed them.
+ *
+ * arguments:
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @P: pointer to the pass state, holding the recorded step sizes.
+ *  @n: desired number of sampled grid points.
+ *
+ * returns:
+ *  integer indicating whether the adjustment succeeded (1) or not (0).
+ */
+int seqexact (tuple_t *N, seqpass_t *P, unsigned int n) {
+  /* declare required variables:
+   *  @S: pointer to the set of the pass.
+   *  @R: array of ranked candidate points.
+   *  @nR: number of candidate points.
+   *  @nchg: number of points to add or remove.
+   *  @del: whether points are removed (1) or added (0).
+   *  @i: grid index and candidate loop counter.
+   */
+  unsigned int i, nR, nchg, del;
+  seqrank_t *R;
+  set_t *S;
+
+  /* determine whether points must be added or removed. */
+  S = &P->lane[0].S;
+  if (S->n == n)
+    return 1;
+
+  del = (S->n > n);
+  nchg = (del ? S->n - n : n - S->n);
+
+  /* allocate the candidate array. */
+  R = (seqrank_t*) malloc((del ? S->n : tupprod(N) - S->n) *
+                          sizeof(seqrank_t));
+  if (!R)
+    return 0;
+
+  /* gather the sampled points for removal, or the unsampled points
+   * for addition.
+   */
+  for (i = 0, nR = 0; i < tupprod(N); i++) {
+    if (setget(S, i) != (int) del || P->gap[i] < 0.0f)
+      continue;
+
+    R[nR].g = P->gap[i];
+    R[nR].idx = i;
+    nR++;
+  }
+
+  /* rank the candidates and change the first few. */
+  qsort(R, nR, sizeof(seqrank_t), seqrankcmp);
+  for (i = 0; i < nchg && i < nR; i++) {
+    if (del)
+      setremove(S, R[i].idx);
+    else
+      setinsert(S, R[i].idx);
+  }
+
+  /* free the candidate array and return success. */
+  free(R);
+  return 1;
+}
+
 /* seq(): generate a sequence of linear indices that represent the
  * deterministic gap sequence over a multidimensional grid,
  * given a few input parameters.
  *
+ * the scaling factor is optimized by repeated passes over the grid that
+ * only count the distinct points they hit. each pass advances several
+ * lanes at once, spread around the current scaling factor, so that every
+ * pass samples the point count curve at several scaling factors for the
+ * cost of a single line enumeration. the samples narrow a bracket of
+ * scaling factors, within which the next factor is interpolated. once a
+ * complete lane has been run, lanes of later passes are aborted at the end
+ * of the first wave of lines that takes them beyond the tolerated count,
+ * and their totals are extrapolated from the running point counts of the
+ * complete lane. the sorted schedule is only read out of the final pass.
+ *
+ * more lanes may be requested than the usual three. such passes spread
+ * their lanes evenly across a known bracket, trading more work per pass
+ * for fewer passes, which pays off when many threads share each pass.
+ *
+ * the lines of each wave are shared between several threads when the gap
+ * equation is evaluated natively (see evalnative()). as every line draws
+ * its quasirandom terms from its own substream, and lanes are only counted
+ * between waves, the schedule is identical for any number of threads.
+ *
+ * if a table of converged scaling factors is provided, the first pass is
+ * run at the scaling factor interpolated from neighboring densities of the
+ * same gap equation and grid (see tblguess()), and the converged scaling
+ * factor is stored back into the table, unless the table is only read.
+ * otherwise, for the preprogrammed gap equations, the first pass is run at
+ * the scaling factor predicted by their count model (see mdlguess()).
+ *
+ * on grids with many lines, the first few full passes are preceded by
+ * cheap passes over an evenly strided subset of lines, whose term counts
+ * are extrapolated to the full grid and calibrated against the preceding
+ * full pass.
+ *
+ * in exact-count mode, the scaling factor is only converged to a looser
+ * tolerance, and the final pass is repeated to record the step sizes
+ * around every grid point. the schedule is then trimmed or padded to the
+ * exact desired point count by seqexact().
+ *
+ * if points were already sampled, they are held in every lane, and the
+ * scaling factor is converged on the total point count. the points are
+ * never removed by seqexact(), and neither the table nor the line subset
+ * are used, as both only describe the gap equation itself.
+ *
  * arguments:
- *  @fn: string representation of the gap equation.
+ *  @E: pointer to the evaluation context of the gap equation.
  *  @N: pointer to the tuple of Nyquist grid sizes.
  *  @d: desired sampling density.
+ *  @opt: pointer to the options of sequence generation.
  *  @lst: pointer to the output tuple of indices.
  *
  * returns:
  *  integer indicating whether sequence generation succeeded (1) or not (0).
  */
-int seq (const char *fn, tuple_t *N, double d, tuple_t *lst) {
+int seq (evalctx_t *E, tuple_t *N, double d, const seqopt_t *opt,
+         tuple_t *lst) {
   /* declare required variables:
-   *  @origin: top-level origin tuple for recursion.
-   *  @mask: top-level mask tuple for recursion.
    *  @n: target number of generated sequence terms.
-   *  @nout: number of generated sequence terms.
+   *  @nout: number of generated sequence terms in each lane.
    *  @nerr: discrepancy between desired and generated point counts.
    *  @ntol: tolerable discrepancy value of schedules.
-   *  @ret: return value from the seqfn() call.
+   *  @ret: return value from the seqpass() call.
    *  @iter: optimization iteration counter.
-   *  @Tlst: binary search tree for index storage.
+   *  @nlines: number of grid lines in a complete pass.
+   *  @origin: top-level origin tuple for line enumeration.
+   *  @nref: point count of the last complete lane, up to the line at
+   *         which the current lane was aborted.
+   *  @nfull: total point count of the last complete lane.
+   *  @K: number of lanes advanced by each full pass.
+   *  @j, @b, @c: lane index, best lane index and reference lane index.
+   *  @jlo, @jhi: indices of the lanes in the current pass that most
+   *              closely bracket the desired point count.
+   *  @P: state of the current sequence generation pass.
+   *  @lane: pointer to the state of the current lane.
+   *  @swp: temporary tuple for exchanging point count records.
    *  @L: sequence term scaling factor to optimize.
    *  @w: weight applied to optimize the scaling factor.
+   *  @Lw: weighted scaling factor used in the current pass.
+   *  @Llo, @Lhi: bracket of scaling factors giving too many or
+   *              too few points.
+   *  @s: relative spread of the lane scaling factors.
+   *  @k: ratio of distinct points to terms extrapolated from the subset.
+   *  @nest: point count estimated from the subset at the current pass.
+   *  @guess: whether the scaling factor was predicted by a table or
+   *          a count model.
+   *  @npre: number of distinct points already sampled.
+   *  @ngap: estimated number of points placed by the gap equation.
+   *  @Lbest, @ebest: scaling factor and point count error of the lane
+   *                  closest to the desired point count over all passes.
+   *  @cur: whether that lane belongs to the current pass.
    */
-  int n, nout, nerr, ntol, ret;
-  tuple_t origin, mask;
-  unsigned int iter;
-  bst_t *Tlst;
-  double L, w;
+  unsigned int iter, nlines, nref, nfull, K, j, b, c, jlo, jhi, npre;
+  int n, nout[SEQ_MAX_LANES], nerr, ntol, nest, ret, guess, ebest, cur;
+  double L, w, Lw, Llo, Lhi, s, k, ngap, Lbest;
+  tuple_t swp, origin;
+  seqlane_t *lane;
+  seqpass_t P;
 
-  /* initialize the output tuple. */
+  /* initialize the output tuple, the enumeration tuples, and every array
+   * of the pass state, so that all failures may share the same cleanup.
+   */
   tupinit(lst);
+  tupinit(&swp);
+  tupinit(&origin);
+  tupinit(&P.ref);
+  P.lines = NULL;
+  P.gap = NULL;
+  P.work = NULL;
+  for (j = 0; j < SEQ_MAX_LANES; j++) {
+    tupinit(&P.lane[j].cnt);
+    setinit(&P.lane[j].S);
+  }
 
-  /* initialize the binary search tree. */
-  Tlst = NULL;
+  /* determine the number of lanes of each full pass. */
+  K = (opt->ncand < 1 ? 1 : opt->ncand > SEQ_MAX_LANES ?
+       SEQ_MAX_LANES : opt->ncand);
 
-  /* allocate the top-level tuples. */
-  if (!tupalloc(&origin, tupsize(N)) || !tupalloc(&mask, tupsize(N)))
-    return 0;
+  /* allocate the sets of the lanes in use. */
+  ret = 0;
+  for (j = 0; j < K; j++) {
+    if (!setalloc(&P.lane[j].S, tupprod(N)))
+      goto done;
+  }
 
-  /* initialize the gap equation evaluation environment. */
-  if (!evalinit(fn, EVAL_GAP)) {
-    /* output an error message and return failure. */
-    fprintf(stderr, "error: failed to compile gap equation\n");
-    return 0;
+  /* allocate tuples for enumerating lines, and count the lines in
+   * a complete pass.
+   */
+  nlines = 0;
+  P.nlines = 0;
+  ret = (tupalloc(&swp, tupsize(N)) && tupalloc(&origin, tupsize(N)));
+  if (ret) {
+    tupfill(&swp, 1);
+    nlines = seqlines(N, &swp);
+
+    /* allocate and enumerate the lines of a complete pass. */
+    P.lines = (seqline_t*) malloc((nlines ? nlines : 1) *
+                                  sizeof(seqline_t));
+    tupfill(&origin, 0);
+    ret = (P.lines && seqfn(N, &origin, &swp, &P));
   }
 
+  /* free the enumeration tuples. */
+  tupfree(&swp);
+  tupfree(&origin);
+  if (!ret)
+    goto done;
+
+  /* divide the lines into waves. */
+  P.wave = (nlines + SEQ_WAVES - 1) / SEQ_WAVES;
+  P.wave = (P.wave ? P.wave : 1);
+
+  /* choose an odd subset stride, so the subset lines alternate between
+   * directions, if the grid holds enough lines to make a subset worthwhile.
+   */
+  P.sub = (nlines >= SEQ_COARSE_MIN * SEQ_COARSE_LINES && !opt->pre ?
+           (nlines / SEQ_COARSE_LINES) | 1 : 0);
+  P.coarse = 0;
+  P.pre = opt->pre;
+  k = 0.0;
+
+  /* count the distinct points already sampled. */
+  for (j = 0; P.pre && j < tupsize(P.pre); j++)
+    setinsert(&P.lane[0].S, tupget(P.pre, j));
+
+  npre = P.lane[0].S.n;
+  setclear(&P.lane[0].S);
+
+  /* start the worker threads. calls into julia are made one at a time,
+   * so multiple threads require native evaluation.
+   */
+  P.E = E;
+  ret = seqstart(N, &P, evalnative(E) ? opt->nthr : 1, K);
+  if (!ret)
+    goto done;
+
   /* compute the desired number of sampled grid points. */
   n = (int) round(d * (double) tupprod(N));
 
   /* compute the tolerated point count error. */
-  ntol = (int) round(SEQ_EPSILON * (double) n);
+  ntol = (int) round((opt->exact ? SEQ_EXACT : SEQ_EPSILON) * (double) n);
   ntol = (ntol < 1 ? 1 : ntol);
 
-  /* compute an initial guess for the scaling factor, as one less
-   * the inverse of the sampling density.
+  /* estimate the number of points the gap equation must place, assuming
+   * that they fall onto the points already sampled at random.
+   */
+  ngap = (double) n;
+  if (npre && npre < tupprod(N))
+    ngap = (double) (n > (signed int) npre ? n - (signed int) npre : 1) /
+           (1.0 - (double) npre / (double) tupprod(N));
+
+  /* predict the scaling factor from the table of converged scaling factors,
+   * or from the count model of a preprogrammed gap equation. otherwise,
+   * compute an initial guess for the scaling factor, as one less the
+   * inverse of the sampling density.
    */
-  L = (1.0 / d) - 1.0;
+  guess = ((opt->T && !npre && tblguess(opt->T, E->str, N, d, &L)) ||
+           mdlguess(E->str, N, ngap, &L));
+  if (!guess)
+    L = (npre ? (double) tupprod(N) / ngap : 1.0 / d) - 1.0;
+
+  /* initialize the weight of the scaling factor and the lane spread. */
   w = 1.0;
+  s = SEQ_SPREAD;
+
+  /* initialize the scaling factor bracket as unknown. */
+  Llo = Lhi = 0.0;
 
-  /* initialize the iteration counter. */
+  /* initialize the iteration counter and the best lane. */
   iter = 0;
+  b = 0;
+  Lbest = 0.0;
+  ebest = cur = 0;
 
   /* loop until the sequence size matches the desired sample count. */
   do {
-    /* initialize the top-level tuples. */
-    tupfill(&origin, 0);
-    tupfill(&mask, 1);
+    /* converge the scaling factor on the line subset first. predicted
+     * scaling factors are only refined once a full pass has calibrated
+     * the subset estimate.
+     */
+    nest = 0;
+    if (P.sub && iter < SEQ_COARSE_ROUNDS && (k != 0.0 || !guess)) {
+      /* run the coarse estimation passes. */
+      ret = seqcoarse(N, n, L, &w, &k, &nest, &P);
+      if (ret != EVAL_OK) {
+        /* output an error message and return failure. */
+        fprintf(stderr, "error: failed to evaluate gap equation\n");
+        ret = 0;
+        goto done;
+      }
 
-    /* initialize the output tuple. */
-    tupfree(lst);
+      /* discard coarse results that leave the known bracket. */
+      if (Llo > 0.0 && Lhi > 0.0 && (L * w <= Llo || L * w >= Lhi)) {
+        w = 0.5 * (Llo + Lhi) / L;
+        nest = 0;
+      }
+    }
+
+    /* place the first lane at the weighted scaling factor, and the others
+     * alternately below and above it, but inside the known bracket. when
+     * more lanes than usual are advanced and both ends of the bracket are
+     * known, the others are instead spread evenly across the bracket, so
+     * that each pass narrows it by the number of lanes.
+     */
+    Lw = L * w;
+    P.K = K;
+    for (j = 0; j < P.K; j++) {
+      lane = P.lane + j;
+      if (j && K > SEQ_LANES && Llo > 0.0 && Lhi > 0.0)
+        lane->L = Llo + (Lhi - Llo) * (double) j / (double) K;
+      else
+        lane->L = Lw * (1.0 + (j % 2 ? -s : s) * (double) ((j + 1) / 2));
 
-    /* initialize the binary search tree. */
-    bstfree(Tlst);
-    Tlst = bstalloc();
+      if (Llo > 0.0 && lane->L <= Llo)
+        lane->L = 0.5 * (Lw + Llo);
+      else if (Lhi > 0.0 && lane->L >= Lhi)
+        lane->L = 0.5 * (Lw + Lhi);
+    }
 
-    /* call the recursive sequence generation function. */
-    ret = seqfn(N, L * w, &origin, &mask, Tlst);
+    /* run a full pass. only abort lanes once a complete lane
+     * is available to extrapolate from.
+     */
+    P.nmax = (tupsize(&P.ref) ? n + ntol : 0);
+    ret = seqpass(N, &P);
 
     /* check the function's return value. */
-    if (ret == EVAL_OK) {
-      /* the function succeeded: the sequence is well-behaved. */
-      nout = (signed int) Tlst->n;
+    if (ret == EVAL_EXCEPTION) {
+      /* the julia function call failed. */
+      fprintf(stderr, "error: failed to evaluate gap equation\n");
+      ret = 0;
+      goto done;
     }
-    else if (ret == EVAL_INVALID) {
-      /* the function failed: the sequence is poorly behaved. */
-      nout = (signed int) tupprod(N);
+    else if (ret != EVAL_OK && ret != SEQ_ABORT) {
+      /* unknown error. */
+      fprintf(stderr, "error: unknown failure\n");
+      ret = 0;
+      goto done;
     }
-    else if (ret == EVAL_EXCEPTION) {
+
+    /* determine the point count of each lane. */
+    for (j = 0, b = 0, c = P.K; j < P.K; j++) {
+      lane = P.lane + j;
+      if (lane->stat == EVAL_INVALID) {
+        /* the function failed: the sequence is poorly behaved. */
+        nout[j] = (signed int) tupprod(N);
+      }
+      else if (lane->stat == EVAL_OK) {
+        /* the lane is complete: the sequence is well-behaved. */
+        nout[j] = (signed int) lane->S.n;
+      }
+      else {
+        /* the lane was aborted: extrapolate its total point count from
+         * the last complete lane, scaled by the ratio of point counts
+         * after the wave where the lane was aborted.
+         */
+        nref = tupget(&P.ref, lane->nwaves - 1);
+        nfull = tupget(&P.ref, tupsize(&P.ref) - 1);
+        nout[j] = (signed int) round((double) lane->S.n * (double) nfull /
+                                     (double) (nref ? nref : 1));
+
+        /* the count is known to exceed the tolerance, and can never
+         * exceed the number of grid points.
+         */
+        nout[j] = (nout[j] <= n + ntol ? n + ntol + 1 : nout[j]);
+        nout[j] = (nout[j] > (signed int) tupprod(N) ?
+                   (signed int) tupprod(N) : nout[j]);
+      }
+
+      /* find the lane closest to the desired point count. */
+      if (abs(nout[j] - n) < abs(nout[b] - n))
+        b = j;
+
+      /* find the complete lane closest to the desired point count. */
+      if (lane->stat == EVAL_OK &&
+          (c == P.K || abs(nout[j] - n) < abs(nout[c] - n)))
+        c = j;
+    }
+
+    /* keep the running point counts of the closest complete lane
+     * for extrapolation.
+     */
+    if (c < P.K) {
+      swp = P.ref;
+      P.ref = P.lane[c].cnt;
+      P.lane[c].cnt = swp;
+    }
+
+    /* calibrate the subset estimate against the first lane, which ran at
+     * the estimated scaling factor: directly if the lane was complete, or
+     * from its extrapolated point count if it was aborted.
+     */
+    lane = P.lane;
+    if (lane->stat == EVAL_OK && P.sub && lane->hsub)
+      k = (double) lane->S.n * (double) lane->nsub /
+          ((double) lane->hsub * (double) nlines);
+    else if (lane->stat == SEQ_ABORT && nest > 0)
+      k *= (double) nout[0] / (double) nest;
+
+    /* update the bracket of scaling factors known to give too many
+     * or too few points, and find the lanes of the current pass that
+     * most closely bracket the desired point count.
+     */
+    for (j = 0, jlo = jhi = P.K; j < P.K; j++) {
+      lane = P.lane + j;
+      nerr = nout[j] - n;
+      if (nerr > ntol) {
+        Llo = (lane->L > Llo ? lane->L : Llo);
+        jlo = (jlo == P.K || lane->L > P.lane[jlo].L ? j : jlo);
+      }
+      else if (nerr < -ntol) {
+        Lhi = (Lhi == 0.0 || lane->L < Lhi ? lane->L : Lhi);
+        jhi = (jhi == P.K || lane->L < P.lane[jhi].L ? j : jhi);
+      }
+    }
+
+    /* the point count is not strictly monotonic in the scaling factor,
+     * and aborted lanes only yield estimates: if the bracket has been
+     * inverted, keep only the end sampled by the current pass.
+     */
+    if (Llo > 0.0 && Lhi > 0.0 && Llo >= Lhi) {
+      if (jlo < P.K && P.lane[jlo].L == Llo)
+        Lhi = 0.0;
+      else
+        Llo = 0.0;
+    }
+
+    /* compute the difference from the desired point count, and keep the
+     * closest lane of all passes, as the point count may jump over the
+     * tolerated range once the bracket collapses.
+     */
+    nerr = nout[b] - (signed int) n;
+    cur = (iter == 0 || abs(nerr) < abs(ebest));
+    if (cur) {
+      Lbest = P.lane[b].L;
+      ebest = nerr;
+    }
+
+    /* interpolate the scaling factor between lanes that bracket the
+     * desired count. otherwise, adjust it by an amount proportional to
+     * the error of the lane nearest to the desired count along the
+     * scaling factor axis.
+     */
+    if (jlo < P.K && jhi < P.K && P.lane[jlo].L < P.lane[jhi].L) {
+      w = (P.lane[jlo].L + (P.lane[jhi].L - P.lane[jlo].L) *
+           (double) (nout[jlo] - n) / (double) (nout[jlo] - nout[jhi])) / L;
+    }
+    else {
+      j = (jlo < P.K ? jlo : jhi < P.K ? jhi : b);
+      w = P.lane[j].L *
+          (1.0 + 0.5 * (double) (nout[j] - n) / (double) n) / L;
+    }
+
+    /* extrapolated point counts may overshoot: fall back to bisection
+     * if the adjusted scaling factor leaves the known bracket, or step
+     * just beyond its only known end.
+     */
+    if (Llo > 0.0 && L * w <= Llo)
+      w = (Lhi > 0.0 ? 0.5 * (Llo + Lhi) : Llo * (1.0 + SEQ_SPREAD)) / L;
+    else if (Lhi > 0.0 && L * w >= Lhi)
+      w = (Llo > 0.0 ? 0.5 * (Llo + Lhi) : Lhi * (1.0 - SEQ_SPREAD)) / L;
+
+    /* spread the next lanes over half of the adjustment. the loop ends
+     * early if the bracket collapses, as the point count then jumps over
+     * the tolerated range at a single scaling factor.
+     */
+    s = 0.5 * fabs(L * w / Lw - 1.0);
+    s = (s < SEQ_EPSILON ? SEQ_EPSILON : s > SEQ_SPREAD ? SEQ_SPREAD : s);
+  }
+  while (abs(nerr) > ntol && ++iter < SEQ_MAX_ITER &&
+         !(Llo > 0.0 && Lhi > 0.0 && Lhi - Llo < SEQ_NARROW * Lhi));
+
+  /* in exact-count mode, allocate and initialize the recorded steps. */
+  if (opt->exact) {
+    P.gap = (float*) malloc(tupprod(N) * sizeof(float));
+    if (!P.gap) {
+      ret = 0;
+      goto done;
+    }
+
+    for (j = 0; j < tupprod(N); j++)
+      P.gap[j] = HUGE_VALF;
+
+    for (j = 0; P.pre && j < tupsize(P.pre); j++) {
+      if (tupget(P.pre, j) < tupprod(N))
+        P.gap[tupget(P.pre, j)] = -HUGE_VALF;
+    }
+  }
+
+  /* if the closest lane was run by an earlier pass, or the iteration limit
+   * was reached on an aborted lane, or the steps of the final lane must be
+   * recorded, repeat the closest lane in full to obtain its complete set
+   * of indices.
+   */
+  nerr = ebest;
+  if (!cur || P.lane[b].stat == SEQ_ABORT || opt->exact) {
+    P.lane[0].L = Lbest;
+    P.K = 1;
+    P.nmax = 0;
+    ret = seqpass(N, &P);
+    b = 0;
+
+    /* check the function's return value. */
+    if (ret == EVAL_EXCEPTION) {
       /* the julia function call failed. */
       fprintf(stderr, "error: failed to evaluate gap equation\n");
-      return 0;
+      ret = 0;
+      goto done;
     }
-    else {
+    else if (ret != EVAL_OK) {
       /* unknown error. */
       fprintf(stderr, "error: unknown failure\n");
-      return 0;
+      ret = 0;
+      goto done;
     }
+  }
 
-    /* compute the difference from the desired point count. */
-    nerr = nout - (signed int) n;
+  /* stop the worker threads. */
+  seqstop(&P);
 
-    /* adjust the scaling factor by an amount proportional to the error. */
-    w *= (1.0 + 0.5 * (double) nerr / (double) n);
+  /* adjust the final lane to the exact desired point count. */
+  if (opt->exact) {
+    ret = seqexact(N, &P, (unsigned int) n);
+
+    /* check for failure. */
+    if (!ret) {
+      fprintf(stderr, "error: failed to adjust point count\n");
+      goto done;
+    }
   }
-  while (abs(nerr) > ntol && ++iter < SEQ_MAX_ITER);
 
-  /* dump the sorted indices from the search tree. */
-  bstsort(Tlst, lst);
-  bstfree(Tlst);
+  /* store the converged scaling factor in the table. factors converged
+   * in exact-count mode only meet a looser tolerance, and are not stored.
+   * the schedule remains valid if the factor cannot be stored.
+   */
+  if (opt->T && opt->store && !npre && !opt->exact && abs(nerr) <= ntol &&
+      !tblstore(opt->T, E->str, N, d, Lbest))
+    fprintf(stderr, "warning: failed to store scaling factor\n");
 
-  /* free the top-level tuples. */
-  tupfree(&origin);
-  tupfree(&mask);
+  /* dump the sorted indices from the closest lane of the final pass. */
+  ret = setsort(&P.lane[b].S, lst);
 
-  /* return success. */
-  return 1;
-}
+  /* stop the worker threads, if they still run, and free the recorded
+   * steps, the lane sets and point count records, the reference point
+   * count record and the lines. every failure returns through here.
+   */
+done:
+  seqstop(&P);
+  free(P.gap);
+  for (j = 0; j < SEQ_MAX_LANES; j++) {
+    setfree(&P.lane[j].S);
+    tupfree(&P.lane[j].cnt);
+  }
 
+  tupfree(&P.ref);
+  free(P.lines);
+
+  /* return the final status. */
+  return ret;
+}
@@ -29,14 +29,206 @@
 #include <stdlib.h>
 #include <math.h>
 
-/* include the tuple, search tree and evaluation headers. */
+/* include the posix threads header. */
+#include <pthread.h>
+
+/* include the tuple, set, count model, table and evaluation headers. */
 #include "tup.h"
-#include "bst.h"
+#include "set.h"
+#include "mdl.h"
+#include "tbl.h"
 #include "eval.h"
 
+/* define an additional return value for sequence generation passes:
+ *  SEQ_ABORT: every lane of the pass was stopped before its completion.
+ */
+#define SEQ_ABORT  -3
+
+/* define the default and maximum numbers of scaling factors advanced by
+ * a single sequence generation pass.
+ */
+#define SEQ_LANES      3
+#define SEQ_MAX_LANES  32
+
+/* define the number of waves into which the lines of a pass are divided.
+ * lanes are only counted and aborted at the end of each wave, so that
+ * the lines of a wave may be traversed in any order.
+ */
+#define SEQ_WAVES  256
+
+/* define the number of quasirandom sequence terms reserved for the
+ * poisson-distributed terms of each line. the value is prime, so the
+ * substreams of consecutive lines differ in their leading digits.
+ */
+#define SEQ_BLOCK  1048573UL
+
+/* seqline_t: type definition of a single line of a pass. */
+typedef struct {
+  /* @oridx: linear index value of the line origin.
+   * @dir: direction along which the line runs.
+   */
+  unsigned int oridx, dir;
+}
+seqline_t;
+
+/* seqlane_t: type definition of the state of a single gap sequence, at
+ * one scaling factor, advanced during a sequence generation pass.
+ */
+typedef struct {
+  /* @L: sequence term scaling factor of the lane. */
+  double L;
+
+  /* @S: set of distinct grid indices hit by the lane. */
+  set_t S;
+
+  /* @cnt: distinct point counts after each wave completed by the lane. */
+  tuple_t cnt;
+
+  /* @stat: status of the lane: 1 while running or once complete,
+   *        EVAL_INVALID once its sequence is poorly behaved, or
+   *        SEQ_ABORT once its point count limit has been exceeded.
+   * @nwaves: number of waves completed by the lane.
+   * @nsub: number of subset lines completed by the lane.
+   * @hsub: number of in-bounds terms on subset lines, duplicates included.
+   */
+  int stat;
+  unsigned int nwaves, nsub, hsub;
+}
+seqlane_t;
+
+/* seqwork_t: type definition of the state of a single worker thread of
+ * a sequence generation pass.
+ */
+typedef struct {
+  /* @P: pointer to the state of the pass.
+   * @thr: handle of the thread, unused by the calling thread.
+   */
+  struct seqpass *P;
+  pthread_t thr;
+
+  /* @rng: quasirandom number generators of each lane.
+   * @O: origin of the current line.
+   */
+  qrng_t rng[SEQ_MAX_LANES];
+  tuple_t O;
+
+  /* @nnew: number of distinct points inserted by the worker into each lane
+   *        during the current wave.
+   * @nsub, @hsub: subset counters of each lane during the current wave.
+   * @inv: whether each lane was found to be poorly behaved.
+   * @ret: status of the worker.
+   */
+  unsigned int nnew[SEQ_MAX_LANES], nsub[SEQ_MAX_LANES];
+  unsigned int hsub[SEQ_MAX_LANES];
+  int inv[SEQ_MAX_LANES], ret;
+}
+seqwork_t;
+
+/* seqpass_t: type definition of the state of a single sequence generation
+ * pass over the Nyquist grid.
+ */
+typedef struct seqpass {
+  /* @lane: array of sequences advanced along each line of the pass.
+   * @K: number of lanes in use.
+   */
+  seqlane_t lane[SEQ_MAX_LANES];
+  unsigned int K;
+
+  /* @ref: distinct point counts after each line of the last complete lane
+   *       that came closest to the desired point count.
+   */
+  tuple_t ref;
+
+  /* @E: pointer to the evaluation context of the gap equation.
+   * @N: pointer to the tuple of Nyquist grid sizes.
+   * @lines: array of the lines of a complete pass.
+   * @nlines: number of lines in a complete pass.
+   * @wave: number of lines in each wave.
+   */
+  evalctx_t *E;
+  tuple_t *N;
+  seqline_t *lines;
+  unsigned int nlines, wave;
+
+  /* @nmax: point count beyond which a lane is aborted, or zero.
+   * @next: index of the next line to traverse in the current wave.
+   * @end: index of the line that ends the current wave.
+   * @done: whether the pass is complete.
+   * @ret: status of the pass.
+   */
+  unsigned int nmax, next, end;
+  int done, ret;
+
+  /* @work: array of the states of each worker thread.
+   * @nthr: number of worker threads, including the calling thread.
+   * @quit: whether the worker threads must exit.
+   */
+  seqwork_t *work;
+  unsigned int nthr;
+  int quit;
+
+  /* @mtx, @cond: synchronization primitives of the worker threads.
+   * @nsync: number of threads waiting to synchronize.
+   * @gen: number of completed synchronizations.
+   */
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  unsigned int nsync, gen;
+
+  /* @sub: stride between lines in the subset used for coarse point count
+   *       estimates, or zero if no subset is used.
+   * @coarse: whether lines outside of the subset are skipped.
+   */
+  unsigned int sub, coarse;
+
+  /* @gap: smallest sequence step that reached or passed over each grid
+   *       point during a single-lane pass, or NULL if not recorded.
+   *       points that were already sampled hold a negative step.
+   */
+  float *gap;
+
+  /* @pre: pointer to the tuple of points inserted into every lane before
+   *       each pass, or NULL.
+   */
+  tuple_t *pre;
+}
+seqpass_t;
+
+/* seqrank_t: type definition of a grid point ranked by the smallest
+ * sequence step that reached or passed over it.
+ */
+typedef struct {
+  /* @g: smallest recorded step size.
+   * @idx: linear grid index.
+   */
+  float g;
+  unsigned int idx;
+}
+seqrank_t;
+
+/* seqopt_t: type definition of the options of gap sequence generation. */
+typedef struct {
+  /* @exact: whether to return exactly the desired number of points.
+   * @nthr: number of threads to traverse the lines of each pass with.
+   * @ncand: number of scaling factors advanced by each pass.
+   * @T: pointer to a table of converged scaling factors, or NULL.
+   * @store: whether converged scaling factors are stored into the table,
+   *         or it is only read.
+   * @pre: pointer to the tuple of packed indices already sampled, which
+   *       the schedule is extended from, or NULL.
+   */
+  int exact;
+  unsigned int nthr, ncand;
+  tbl_t *T;
+  int store;
+  tuple_t *pre;
+}
+seqopt_t;
+
 /* function declarations: */
 
-int seq (const char *fn, tuple_t *N, double d, tuple_t *lst);
+int seq (evalctx_t *E, tuple_t *N, double d, const seqopt_t *opt,
+         tuple_t *lst);
 
 #endif /* !__NUSUTILS_SEQ_H__ */
 
@@ -0,0 +1,275 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the set header. */
+#include "set.h"
+
+/* SET_BITS: number of membership bits held by each word of a set.
+ */
+#define SET_BITS (8 * sizeof(unsigned long))
+
+/* setalloc(): allocate memory for an empty set of indices.
+ *
+ * arguments:
+ *  @s: pointer to the set to allocate.
+ *  @sz: size of the universe of indices.
+ *
+ * returns:
+ *  integer indicating whether allocation succeeded (1) or failed (0).
+ */
+int setalloc (set_t *s, unsigned int sz) {
+  /* declare required variables:
+   *  @nw: number of words in the bit array.
+   */
+  unsigned int nw;
+
+  /* ensure the set pointer is valid. */
+  if (!s)
+    return 0;
+
+  /* allocate the bit array. */
+  nw = sz / SET_BITS + 1;
+  s->bits = (unsigned long*) calloc(nw, sizeof(unsigned long));
+  if (!s->bits)
+    return 0;
+
+  /* store the universe size and initialize the element count. */
+  s->sz = sz;
+  s->n = 0;
+
+  /* return success. */
+  return 1;
+}
+
+/* setinit(): initialize the fields of a set structure.
+ *
+ * arguments:
+ *  @s: pointer to the set to initialize.
+ */
+void setinit (set_t *s) {
+  /* ensure the set pointer is valid. */
+  if (!s)
+    return;
+
+  /* initialize the set structure members. */
+  s->bits = NULL;
+  s->sz = 0;
+  s->n = 0;
+}
+
+/* setfree(): free allocated memory from a set.
+ *
+ * arguments:
+ *  @s: pointer to the set to free.
+ */
+void setfree (set_t *s) {
+  /* ensure the set pointer is valid. */
+  if (!s)
+    return;
+
+  /* free the bit array, if it is allocated. */
+  if (s->bits)
+    free(s->bits);
+
+  /* re-initialize the set. */
+  setinit(s);
+}
+
+/* setclear(): remove all elements from a set, without releasing its
+ * allocated memory.
+ *
+ * arguments:
+ *  @s: pointer to the set to clear.
+ */
+void setclear (set_t *s) {
+  /* ensure the set is allocated. */
+  if (!s || !s->bits)
+    return;
+
+  /* zero the bit array and the element count. */
+  memset(s->bits, 0, (s->sz / SET_BITS + 1) * sizeof(unsigned long));
+  s->n = 0;
+}
+
+/* setinsert(): insert a linear index into a set. if the index already
+ * exists in the set, the set remains unaltered.
+ *
+ * arguments:
+ *  @s: pointer to the set to modify.
+ *  @idx: index to insert into the set.
+ *
+ * returns:
+ *  integer indicating whether the index was newly inserted (1) or was
+ *  already present or out of bounds (0).
+ */
+int setinsert (set_t *s, unsigned int idx) {
+  /* declare required variables:
+   *  @w: pointer to the word holding the index.
+   *  @m: bit mask of the index within its word.
+   */
+  unsigned long *w, m;
+
+  /* ensure the index is in bounds. */
+  if (idx >= s->sz)
+    return 0;
+
+  /* locate the membership bit. */
+  w = s->bits + idx / SET_BITS;
+  m = 1UL << (idx % SET_BITS);
+
+  /* check if the index is already present. */
+  if (*w & m)
+    return 0;
+
+  /* insert the index and increment the set size. */
+  *w |= m;
+  s->n++;
+
+  /* return success. */
+  return 1;
+}
+
+/* setinsertmt(): insert a linear index into a set that may be modified
+ * by several threads at once. the set size is left unaltered, and must be
+ * updated by the caller from the number of successful insertions.
+ *
+ * arguments:
+ *  @s: pointer to the set to modify.
+ *  @idx: index to insert into the set.
+ *
+ * returns:
+ *  integer indicating whether the index was inserted (1) or was already
+ *  present or out of bounds (0).
+ */
+int setinsertmt (set_t *s, unsigned int idx) {
+  /* declare required variables:
+   *  @w: pointer to the word holding the index.
+   *  @m: bit mask of the index within its word.
+   */
+  unsigned long *w, m;
+
+  /* ensure the index is in bounds. */
+  if (idx >= s->sz)
+    return 0;
+
+  /* locate the membership bit. */
+  w = s->bits + idx / SET_BITS;
+  m = 1UL << (idx % SET_BITS);
+
+  /* skip the atomic update if the index is already present. */
+  if (__atomic_load_n(w, __ATOMIC_RELAXED) & m)
+    return 0;
+
+  /* atomically insert the index, checking whether another thread
+   * inserted it first.
+   */
+  return !(__atomic_fetch_or(w, m, __ATOMIC_RELAXED) & m);
+}
+
+/* setremove(): remove a linear index from a set. if the index does not
+ * exist in the set, the set remains unaltered.
+ *
+ * arguments:
+ *  @s: pointer to the set to modify.
+ *  @idx: index to remove from the set.
+ *
+ * returns:
+ *  integer indicating whether the index was removed (1) or was absent
+ *  or out of bounds (0).
+ */
+int setremove (set_t *s, unsigned int idx) {
+  /* declare required variables:
+   *  @w: pointer to the word holding the index.
+   *  @m: bit mask of the index within its word.
+   */
+  unsigned long *w, m;
+
+  /* ensure the index is in bounds. */
+  if (idx >= s->sz)
+    return 0;
+
+  /* locate the membership bit. */
+  w = s->bits + idx / SET_BITS;
+  m = 1UL << (idx % SET_BITS);
+
+  /* check if the index is absent. */
+  if (!(*w & m))
+    return 0;
+
+  /* remove the index and decrement the set size. */
+  *w &= ~m;
+  s->n--;
+
+  /* return success. */
+  return 1;
+}
+
+/* setget(): check whether a linear index is present in a set.
+ *
+ * arguments:
+ *  @s: pointer to the set to query.
+ *  @idx: index to check for.
+ *
+ * returns:
+ *  integer indicating whether the index is present (1) or not (0).
+ */
+int setget (set_t *s, unsigned int idx) {
+  /* return the membership bit, or zero if the index is out of bounds. */
+  return (idx < s->sz && (s->bits[idx / SET_BITS] >> (idx % SET_BITS)) & 1);
+}
+
+/* setsort(): write the elements of a set out into a linear tuple pointer,
+ * whose values will be sorted.
+ *
+ * arguments:
+ *  @s: pointer to the set to traverse.
+ *  @tout: pointer to the tuple to fill, should be initialized as empty.
+ *
+ * returns:
+ *  integer indicating whether the tuple was filled (1) or not (0).
+ */
+int setsort (set_t *s, tuple_t *tout) {
+  /* declare required variables:
+   *  @i: word index within the bit array.
+   *  @k: output tuple element index.
+   *  @w: copy of the current word.
+   */
+  unsigned int i, k;
+  unsigned long w;
+
+  /* allocate the output tuple, if the set is non-empty. */
+  if (s->n == 0)
+    return 1;
+  if (!tupalloc(tout, s->n))
+    return 0;
+
+  /* loop over the words of the bit array. */
+  for (i = 0, k = 0; i <= s->sz / SET_BITS; i++) {
+    /* pop each set bit of the current word, lowest first. */
+    for (w = s->bits[i]; w; w &= w - 1)
+      tout->elem[k++] = i * SET_BITS + __builtin_ctzl(w);
+  }
+
+  /* return success. */
+  return 1;
+}
+
@@ -0,0 +1,71 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_SET_H__
+#define __NUSUTILS_SET_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* include the tuple header. */
+#include "tup.h"
+
+/* set_t: type definition of a fixed-universe set of linear indices,
+ * stored as a bit array. unlike a search tree, a set may be cleared
+ * and refilled without any further allocation.
+ */
+typedef struct {
+  /* @sz: size of the universe of indices, [0, sz).
+   * @n: total number of unique elements in the set.
+   */
+  unsigned int sz, n;
+
+  /* @bits: array of membership bits. */
+  unsigned long *bits;
+}
+set_t;
+
+/* function declarations: */
+
+int setalloc (set_t *s, unsigned int sz);
+
+void setinit (set_t *s);
+
+void setfree (set_t *s);
+
+void setclear (set_t *s);
+
+int setinsert (set_t *s, unsigned int idx);
+
+int setinsertmt (set_t *s, unsigned int idx);
+
+int setremove (set_t *s, unsigned int idx);
+
+int setget (set_t *s, unsigned int idx);
+
+int setsort (set_t *s, tuple_t *tout);
+
+#endif /* !__NUSUTILS_SET_H__ */
+
@@ -0,0 +1,525 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* include the table header. */
+#include "tbl.h"
+
+/* include the posix header for process identifiers. */
+#include <unistd.h>
+
+/* TBL_HEADER: first line of every table file. tables having any other
+ * first line, including those written by older versions, are ignored.
+ */
+#define TBL_HEADER  "# nusutils scaling factor table, version 3\n"
+
+/* define constants that determine the behavior of the table:
+ *  TBL_MAX_ENTRIES: maximum number of entries kept in a table.
+ *  TBL_MAX_LINE: maximum length of a single line of a table file.
+ *  TBL_MAX_EQN: maximum length of a stored gap equation.
+ *  TBL_MATCH: density difference below which two entries match.
+ */
+#define TBL_MAX_ENTRIES  4096
+#define TBL_MAX_LINE     1024
+#define TBL_MAX_EQN      768
+#define TBL_MATCH        1.0e-9
+
+/* tblhash(): compute the hash of the program version and a gap equation
+ * string, as it was written, using the 64-bit fnv-1a algorithm.
+ *
+ * arguments:
+ *  @fn: string representation of the gap equation.
+ *
+ * returns:
+ *  hash value of the string.
+ */
+unsigned long long tblhash (const char *fn) {
+  /* declare required variables:
+   *  @h: running hash value.
+   *  @v: pointer into the program version.
+   */
+  unsigned long long h = 14695981039346656037ULL;
+  const char *v;
+
+  /* hash the program version, which separates the entries of versions
+   * whose searches may converge differently.
+   */
+  for (v = CACHE_VERSION; *v; v++)
+    h = (h ^ (unsigned char) *v) * 1099511628211ULL;
+
+  /* hash each character of the string. */
+  for (; *fn; fn++)
+    h = (h ^ (unsigned char) *fn) * 1099511628211ULL;
+
+  /* return the computed result. */
+  return h;
+}
+
+/* tblkey(): determine whether a table entry belongs to a given gap
+ * equation and grid size.
+ *
+ * arguments:
+ *  @e: pointer to the table entry.
+ *  @h: hash of the gap equation.
+ *  @fn: string representation of the gap equation.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *
+ * returns:
+ *  integer indicating whether the entry matches (1) or not (0).
+ */
+int tblkey (tblent_t *e, unsigned long long h, const char *fn,
+            tuple_t *N) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   */
+  unsigned int i;
+
+  /* check the hash and the dimensionality. */
+  if (e->hash != h || e->D != tupsize(N))
+    return 0;
+
+  /* check the grid sizes. */
+  for (i = 0; i < e->D; i++) {
+    if (e->N[i] != tupget(N, i))
+      return 0;
+  }
+
+  /* confirm the match against the gap equation itself. */
+  return (strcmp(e->fn, fn) == 0);
+}
+
+/* tblappend(): append an entry to the end of a table, dropping the least
+ * recently stored entry if the table is full. the table takes ownership
+ * of the equation string of the entry.
+ *
+ * arguments:
+ *  @T: pointer to the table.
+ *  @e: pointer to the entry to append.
+ *
+ * returns:
+ *  integer indicating whether the append succeeded (1) or not (0).
+ */
+int tblappend (tbl_t *T, tblent_t *e) {
+  /* declare required variables:
+   *  @ent: reallocated entry array.
+   */
+  tblent_t *ent;
+
+  /* drop the oldest entry of a full table. */
+  if (T->n >= TBL_MAX_ENTRIES) {
+    free(T->ent[0].fn);
+    memmove(T->ent, T->ent + 1, (T->n - 1) * sizeof(tblent_t));
+    T->n--;
+  }
+
+  /* grow the entry array by a single entry. */
+  ent = (tblent_t*) realloc(T->ent, (T->n + 1) * sizeof(tblent_t));
+  if (!ent)
+    return 0;
+
+  /* store the new entry. */
+  T->ent = ent;
+  T->ent[T->n++] = *e;
+
+  /* return success. */
+  return 1;
+}
+
+/* tblparse(): parse a single line of a table file into an entry. the
+ * gap equation fills the remainder of the line, and must match the hash.
+ *
+ * arguments:
+ *  @line: string holding the line, including its newline.
+ *  @e: pointer to the output entry, whose equation string is allocated.
+ *
+ * returns:
+ *  integer indicating whether the line held a valid entry (1) or not (0).
+ */
+int tblparse (const char *line, tblent_t *e) {
+  /* declare required variables:
+   *  @p, @q: current and next parsing positions.
+   *  @v: parsed unsigned integer value.
+   *  @i: dimension loop counter.
+   *  @len: length of the gap equation.
+   */
+  const char *p;
+  char *q;
+  unsigned long v;
+  unsigned int i;
+  size_t len;
+
+  /* parse the hash. */
+  p = line;
+  e->hash = strtoull(p, &q, 16);
+  if (q == p)
+    return 0;
+
+  /* parse the density and scaling factor. */
+  p = q;
+  e->d = strtod(p, &q);
+  if (q == p || !(e->d > 0.0 && e->d < 1.0))
+    return 0;
+
+  p = q;
+  e->L = strtod(p, &q);
+  if (q == p || !(e->L > 0.0) || isinf(e->L))
+    return 0;
+
+  /* parse the dimensionality. */
+  p = q;
+  v = strtoul(p, &q, 10);
+  if (q == p || v < 1 || v > TBL_MAX_DIMS)
+    return 0;
+
+  e->D = (unsigned int) v;
+
+  /* parse the grid sizes. */
+  for (i = 0; i < e->D; i++) {
+    p = q;
+    v = strtoul(p, &q, 10);
+    if (q == p || v < 1 || v > UINT_MAX)
+      return 0;
+
+    e->N[i] = (unsigned int) v;
+  }
+
+  /* require a single space before the gap equation, and a newline after
+   * it, which is not part of it.
+   */
+  len = strlen(q);
+  if (*q != ' ' || len < 3 || q[len - 1] != '\n')
+    return 0;
+
+  /* store the gap equation, and check it against the hash. */
+  e->fn = (char*) malloc(len - 1);
+  if (!e->fn)
+    return 0;
+
+  memcpy(e->fn, q + 1, len - 2);
+  e->fn[len - 2] = '\0';
+  if (tblhash(e->fn) != e->hash) {
+    free(e->fn);
+    return 0;
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* tblload(): load a table of converged scaling factors from a file. a
+ * missing file or a file written by another table version yields an empty
+ * table, and lines that do not hold valid entries are skipped.
+ *
+ * arguments:
+ *  @T: pointer to the table to initialize.
+ *  @fname: filename that the table is loaded from and saved to.
+ *
+ * returns:
+ *  integer indicating whether the table was initialized (1) or not (0).
+ */
+int tblload (tbl_t *T, const char *fname) {
+  /* declare required variables:
+   *  @fh: file handle for reading.
+   *  @line: buffer holding the current line of the file.
+   *  @e: entry parsed from the current line.
+   *  @skip: whether the current line is too long, and is skipped.
+   *  @len: length of the read part of the current line.
+   */
+  char line[TBL_MAX_LINE];
+  tblent_t e;
+  size_t len;
+  int skip;
+  FILE *fh;
+
+  /* initialize the table. */
+  pthread_mutex_init(&T->lock, NULL);
+  T->ent = NULL;
+  T->n = 0;
+
+  /* store the filename. */
+  T->fname = (char*) malloc(strlen(fname) + 1);
+  if (!T->fname)
+    return 0;
+
+  strcpy(T->fname, fname);
+
+  /* open the file, returning an empty table if it does not exist. */
+  fh = fopen(fname, "r");
+  if (!fh)
+    return 1;
+
+  /* check the file header. */
+  if (!fgets(line, TBL_MAX_LINE, fh) || strcmp(line, TBL_HEADER) != 0) {
+    fclose(fh);
+    return 1;
+  }
+
+  /* read the entries. */
+  for (skip = 0; fgets(line, TBL_MAX_LINE, fh);) {
+    /* skip every part of lines that are too long, and lines that do not
+     * hold valid entries.
+     */
+    len = strlen(line);
+    if (!len || skip || line[len - 1] != '\n') {
+      skip = (!len || line[len - 1] != '\n');
+      continue;
+    }
+    else if (!tblparse(line, &e))
+      continue;
+
+    /* append the entry. */
+    if (!tblappend(T, &e)) {
+      free(e.fn);
+      fclose(fh);
+      return 0;
+    }
+  }
+
+  /* close the file and return success. */
+  fclose(fh);
+  return 1;
+}
+
+/* tblsave(): save a table of converged scaling factors to its file. the
+ * table is first written to a temporary file, which then replaces the
+ * table file, so concurrent readers never see a partially written table.
+ *
+ * arguments:
+ *  @T: pointer to the table to save.
+ *
+ * returns:
+ *  integer indicating whether the table was saved (1) or not (0).
+ */
+int tblsave (tbl_t *T) {
+  /* declare required variables:
+   *  @fh: file handle for writing.
+   *  @tmp: temporary filename.
+   *  @i, @j: entry and dimension loop counters.
+   *  @ok: whether every write succeeded.
+   */
+  unsigned int i, j;
+  char *tmp;
+  FILE *fh;
+  int ok;
+
+  /* build the temporary filename. */
+  tmp = (char*) malloc(strlen(T->fname) + 32);
+  if (!tmp)
+    return 0;
+
+  sprintf(tmp, "%s.%ld.tmp", T->fname, (long) getpid());
+
+  /* open the temporary file. */
+  fh = fopen(tmp, "w");
+  if (!fh) {
+    free(tmp);
+    return 0;
+  }
+
+  /* write the header and each entry, ending with its gap equation. */
+  pthread_mutex_lock(&T->lock);
+  ok = (fputs(TBL_HEADER, fh) >= 0);
+  for (i = 0; i < T->n && ok; i++) {
+    ok = (fprintf(fh, "%016llx %.17g %.17g %u", T->ent[i].hash,
+                  T->ent[i].d, T->ent[i].L, T->ent[i].D) > 0);
+
+    for (j = 0; j < T->ent[i].D && ok; j++)
+      ok = (fprintf(fh, " %u", T->ent[i].N[j]) > 0);
+
+    ok = (ok && fprintf(fh, " %s\n", T->ent[i].fn) > 0);
+  }
+
+  pthread_mutex_unlock(&T->lock);
+
+  /* close the temporary file and move it over the table file. */
+  ok = (fclose(fh) == 0 && ok);
+  ok = (ok && rename(tmp, T->fname) == 0);
+
+  /* remove the temporary file on failure. */
+  if (!ok)
+    remove(tmp);
+
+  /* free the temporary filename and return. */
+  free(tmp);
+  return ok;
+}
+
+/* tblfree(): free the memory held by a table.
+ *
+ * arguments:
+ *  @T: pointer to the table to free.
+ */
+void tblfree (tbl_t *T) {
+  /* declare required variables:
+   *  @i: entry loop counter.
+   */
+  unsigned int i;
+
+  /* free the entries and the filename. */
+  for (i = 0; i < T->n; i++)
+    free(T->ent[i].fn);
+
+  free(T->ent);
+  free(T->fname);
+
+  /* reinitialize the table. */
+  pthread_mutex_destroy(&T->lock);
+  T->ent = NULL;
+  T->fname = NULL;
+  T->n = 0;
+}
+
+/* tblguess(): predict the scaling factor for a gap equation, grid size
+ * and density from the converged scaling factors of neighboring densities.
+ * scaling factors are interpolated linearly in the inverse density, or
+ * scaled from a single neighbor by the ratio of the default guesses,
+ * 1/d - 1, at the two densities. a stored density is returned directly.
+ *
+ * arguments:
+ *  @T: pointer to the table.
+ *  @fn: string representation of the gap equation.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @d: desired sampling density.
+ *  @L: pointer to the output scaling factor.
+ *
+ * returns:
+ *  integer indicating whether a prediction was made (1) or not (0).
+ */
+int tblguess (tbl_t *T, const char *fn, tuple_t *N, double d, double *L) {
+  /* declare required variables:
+   *  @h: hash of the gap equation.
+   *  @i: entry loop counter.
+   *  @e: pointer to the current entry.
+   *  @lo, @hi: nearest entries having lower and higher densities.
+   *  @t: interpolation weight.
+   *  @ret: whether a prediction was made.
+   */
+  tblent_t *e, *lo, *hi;
+  unsigned long long h;
+  unsigned int i;
+  int ret = 1;
+  double t;
+
+  /* find the nearest entries on either side of the density. */
+  h = tblhash(fn);
+  pthread_mutex_lock(&T->lock);
+  for (i = 0, lo = hi = NULL; i < T->n; i++) {
+    e = T->ent + i;
+    if (!tblkey(e, h, fn, N))
+      continue;
+
+    /* return matching densities directly. */
+    if (fabs(e->d - d) < TBL_MATCH) {
+      *L = e->L;
+      pthread_mutex_unlock(&T->lock);
+      return 1;
+    }
+
+    /* update the nearest entries. */
+    if (e->d < d && (!lo || e->d > lo->d))
+      lo = e;
+    else if (e->d > d && (!hi || e->d < hi->d))
+      hi = e;
+  }
+
+  /* interpolate or scale the neighboring scaling factors. */
+  if (lo && hi) {
+    t = (1.0 / d - 1.0 / lo->d) / (1.0 / hi->d - 1.0 / lo->d);
+    *L = lo->L + t * (hi->L - lo->L);
+  }
+  else if (lo || hi) {
+    e = (lo ? lo : hi);
+    *L = e->L * (1.0 / d - 1.0) / (1.0 / e->d - 1.0);
+  }
+  else
+    ret = 0;
+
+  /* return the status of the prediction. */
+  pthread_mutex_unlock(&T->lock);
+  return ret;
+}
+
+/* tblstore(): store the converged scaling factor of a gap equation, grid
+ * size and density in a table, replacing any matching entry. equations
+ * that cannot be written on a single line of the table are not stored.
+ *
+ * arguments:
+ *  @T: pointer to the table.
+ *  @fn: string representation of the gap equation.
+ *  @N: pointer to the tuple of Nyquist grid sizes.
+ *  @d: sampling density.
+ *  @L: converged scaling factor.
+ *
+ * returns:
+ *  integer indicating whether the entry was stored (1) or not (0).
+ */
+int tblstore (tbl_t *T, const char *fn, tuple_t *N, double d, double L) {
+  /* declare required variables:
+   *  @e: new table entry.
+   *  @i: entry and dimension loop counter.
+   *  @ok: whether the entry was appended.
+   */
+  unsigned int i;
+  tblent_t e;
+  int ok;
+
+  /* check that the entry can be written. */
+  if (tupsize(N) > TBL_MAX_DIMS || !*fn || strlen(fn) > TBL_MAX_EQN ||
+      strchr(fn, '\n'))
+    return 0;
+
+  /* build the new entry. */
+  e.fn = (char*) malloc(strlen(fn) + 1);
+  if (!e.fn)
+    return 0;
+
+  strcpy(e.fn, fn);
+  e.hash = tblhash(fn);
+  e.D = tupsize(N);
+  e.d = d;
+  e.L = L;
+
+  for (i = 0; i < e.D; i++)
+    e.N[i] = tupget(N, i);
+
+  /* remove any matching entry. */
+  pthread_mutex_lock(&T->lock);
+  for (i = 0; i < T->n; i++) {
+    if (tblkey(T->ent + i, e.hash, fn, N) &&
+        fabs(T->ent[i].d - d) < TBL_MATCH) {
+      free(T->ent[i].fn);
+      memmove(T->ent + i, T->ent + i + 1,
+              (T->n - i - 1) * sizeof(tblent_t));
+      T->n--;
+      break;
+    }
+  }
+
+  /* append the new entry as the most recent one. */
+  ok = tblappend(T, &e);
+  pthread_mutex_unlock(&T->lock);
+
+  /* free the equation string if it was not appended. */
+  if (!ok)
+    free(e.fn);
+
+  return ok;
+}
@@ -0,0 +1,99 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_TBL_H__
+#define __NUSUTILS_TBL_H__
+
+/* include standard c library headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+/* include the posix threads header. */
+#include <pthread.h>
+
+/* include the tuple and cache headers. */
+#include "tup.h"
+#include "cache.h"
+
+/* define the maximum number of grid dimensions of a table entry.
+ */
+#define TBL_MAX_DIMS  8
+
+/* tblent_t: type definition of a single converged scaling factor, keyed
+ * by the program version, its gap equation, grid size and sampling
+ * density.
+ */
+typedef struct {
+  /* @hash: hash of the program version and the gap equation string.
+   * @fn: gap equation string, as it was written.
+   * @D: number of grid dimensions.
+   * @N: grid sizes along each dimension.
+   */
+  unsigned long long hash;
+  char *fn;
+  unsigned int D, N[TBL_MAX_DIMS];
+
+  /* @d: sampling density.
+   * @L: converged sequence term scaling factor.
+   */
+  double d, L;
+}
+tblent_t;
+
+/* tbl_t: type definition of a file-backed table of converged scaling
+ * factors, ordered from least to most recently stored.
+ */
+typedef struct {
+  /* @fname: filename that the table is loaded from and saved to. */
+  char *fname;
+
+  /* @ent: array of table entries.
+   * @n: number of entries in the table.
+   */
+  tblent_t *ent;
+  unsigned int n;
+
+  /* @lock: lock held while the entries are read or modified, so that
+   *        schedules built concurrently may share the table.
+   */
+  pthread_mutex_t lock;
+}
+tbl_t;
+
+/* function declarations: */
+
+int tblload (tbl_t *T, const char *fname);
+
+int tblsave (tbl_t *T);
+
+void tblfree (tbl_t *T);
+
+int tblguess (tbl_t *T, const char *fn, tuple_t *N, double d, double *L);
+
+int tblstore (tbl_t *T, const char *fn, tuple_t *N, double d, double L);
+
+#endif /* !__NUSUTILS_TBL_H__ */
+
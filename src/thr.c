@@ -0,0 +1,60 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+
+/* include the thread header. */
+#include "thr.h"
+
+/* thrrun(): run a thread function on the calling thread and on several
+ * additional threads that share its argument, and wait for all of them
+ * to return. the function is expected to claim work from its argument
+ * until none remains, so the calling thread finishes any work left over
+ * by threads that could not be started.
+ *
+ * arguments:
+ *  @fn: thread function to run.
+ *  @arg: argument shared by every thread.
+ *  @nthr: total number of threads, including the calling thread.
+ */
+void thrrun (void *(*fn) (void*), void *arg, unsigned int nthr) {
+  /* declare required variables:
+   *  @thr: array of thread handles.
+   *  @t, @nt: thread loop counter and number of started threads.
+   */
+  pthread_t *thr;
+  unsigned int t, nt;
+
+  /* start the additional threads. */
+  thr = (nthr > 1 ? (pthread_t*) malloc((nthr - 1) * sizeof(pthread_t)) :
+         NULL);
+  for (nt = 0; thr && nt < nthr - 1; nt++) {
+    if (pthread_create(thr + nt, NULL, fn, arg))
+      break;
+  }
+
+  /* run the function on the calling thread, and wait for the others. */
+  fn(arg);
+  for (t = 0; t < nt; t++)
+    pthread_join(thr[t], NULL);
+
+  free(thr);
+}
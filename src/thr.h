@@ -0,0 +1,38 @@
+
+/* nusutils: generalized deterministic nonuniform sampling utilities.
+ * Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ *
+ *   Free Software Foundation, Inc.
+ *   51 Franklin Street, Fifth Floor
+ *   Boston, MA  02110-1301, USA.
+ */
+
+
+/* ensure once-only inclusion. */
+#ifndef __NUSUTILS_THR_H__
+#define __NUSUTILS_THR_H__
+
+/* include standard c library headers. */
+#include <stdlib.h>
+
+/* include the posix threads header. */
+#include <pthread.h>
+
+/* function declarations: */
+
+void thrrun (void *(*fn) (void*), void *arg, unsigned int nthr);
+
+#endif /* !__NUSUTILS_THR_H__ */
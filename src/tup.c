@@ -456,3 +456,260 @@ int tupappend (tuple_t *t, unsigned int newelem) {
   return 1;
 }
 
+
+/* tupread(): read a list of grid indices from a file, as written by
+ * tupprint(), and append their packed linear indices to a tuple.
+ *
+ * arguments:
+ *  @fh: input file handle.
+ *  @n: pointer to the tuple of sizes.
+ *  @lst: pointer to the tuple to append the packed indices to.
+ *
+ * returns:
+ *  integer indicating whether every index was read (1) or not (0).
+ */
+int tupread (FILE *fh, tuple_t *n, tuple_t *lst) {
+  /* declare required variables:
+   *  @x: unpacked grid index.
+   *  @i: dimension loop counter.
+   *  @idx: packed linear index.
+   *  @v: currently read index element.
+   *  @ret: return value of each conversion.
+   */
+  unsigned int i, idx, v;
+  tuple_t x;
+  int ret;
+
+  /* ensure the pointers are valid. */
+  if (!fh || !n || !lst)
+    return 0;
+
+  /* allocate the unpacked index. */
+  if (!tupalloc(&x, n->n))
+    return 0;
+
+  /* read indices until the file ends. */
+  for (i = 0; (ret = fscanf(fh, "%u", &v)) == 1;) {
+    /* check that the element lies on the grid. */
+    if (v >= n->elem[i])
+      break;
+
+    /* store the element, and pack every complete index. */
+    x.elem[i++] = v;
+    if (i == n->n) {
+      if (!tuppack(&x, n, &idx) || !tupappend(lst, idx))
+        break;
+
+      i = 0;
+    }
+  }
+
+  /* free the unpacked index, and check that the file ended on
+   * a complete index.
+   */
+  tupfree(&x);
+  return (ret == EOF && i == 0);
+}
+
+/* tupdiv(): divide an index by the size of a leading grid dimension.
+ *
+ * arguments:
+ *  @G: pointer to the index kernels of the grid.
+ *  @i: dimension index.
+ *  @idx: index to divide.
+ *
+ * returns:
+ *  quotient of the index and the size of the dimension.
+ */
+unsigned int tupdiv (tupgrid_t *G, unsigned int i, unsigned int idx) {
+#ifdef __SIZEOF_INT128__
+  /* multiply by the reciprocal, which is exact for all 32-bit indices. */
+  return (G->M[i] ? (unsigned int) (((unsigned __int128) G->M[i] * idx)
+                                    >> 64) : idx);
+#else
+  /* divide directly. */
+  return idx / G->n[i];
+#endif
+}
+
+/* TUP_KERNELS(): define the index kernels of grids with a fixed number of
+ * dimensions. the final grid index needs no division, as linear indices
+ * never exceed the grid.
+ */
+#define TUP_KERNELS(D) \
+unsigned int tuppack##D (tupgrid_t *G, const unsigned int *x) { \
+  unsigned int i, idx; \
+  for (i = 1, idx = x[0]; i < D; i++) \
+    idx += x[i] * G->st[i]; \
+  return idx; \
+} \
+void tupunpack##D (tupgrid_t *G, unsigned int idx, unsigned int *x) { \
+  unsigned int i, q; \
+  for (i = 0; i + 1 < D; i++, idx = q) { \
+    q = tupdiv(G, i, idx); \
+    x[i] = idx - q * G->n[i]; \
+  } \
+  x[D - 1] = idx; \
+} \
+void tupunpackv##D (tupgrid_t *G, const unsigned int *idx, unsigned int n, \
+                    unsigned int *x) { \
+  unsigned int j; \
+  for (j = 0; j < n; j++) \
+    tupunpack##D(G, idx[j], x + j * D); \
+}
+
+/* define the specialized index kernels. */
+TUP_KERNELS(1)
+TUP_KERNELS(2)
+TUP_KERNELS(3)
+TUP_KERNELS(4)
+
+/* tuppackn(): pack an array of grid indices of any grid into a linear
+ * index.
+ */
+unsigned int tuppackn (tupgrid_t *G, const unsigned int *x) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   *  @idx, @stride: linear index and current stride.
+   */
+  unsigned int i, idx, stride;
+
+  /* accumulate the strided grid indices. */
+  for (i = 0, idx = 0, stride = 1; i < G->D; i++) {
+    idx += x[i] * stride;
+    stride *= tupget(G->N, i);
+  }
+
+  return idx;
+}
+
+/* tupunpackn(): unpack a linear index of any grid into an array of grid
+ * indices.
+ */
+void tupunpackn (tupgrid_t *G, unsigned int idx, unsigned int *x) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   */
+  unsigned int i;
+
+  /* peel off the grid index of each dimension. */
+  for (i = 0; i < G->D; i++) {
+    x[i] = idx % tupget(G->N, i);
+    idx /= tupget(G->N, i);
+  }
+}
+
+/* tupunpackvn(): unpack an array of linear indices of any grid.
+ */
+void tupunpackvn (tupgrid_t *G, const unsigned int *idx, unsigned int n,
+                  unsigned int *x) {
+  /* declare required variables:
+   *  @j: index loop counter.
+   */
+  unsigned int j;
+
+  /* unpack each index. */
+  for (j = 0; j < n; j++)
+    tupunpackn(G, idx[j], x + j * G->D);
+}
+
+/* tupgridinit(): choose the index kernels of a grid.
+ *
+ * arguments:
+ *  @G: pointer to the output index kernels.
+ *  @N: pointer to the tuple of grid sizes, which must outlive @G.
+ *
+ * returns:
+ *  integer indicating success (1) or failure (0).
+ */
+int tupgridinit (tupgrid_t *G, tuple_t *N) {
+  /* declare required variables:
+   *  @i: dimension loop counter.
+   */
+  unsigned int i;
+
+  /* ensure the pointers are valid. */
+  if (!G || !N || !N->elem || !N->n)
+    return 0;
+
+  /* store the grid sizes. */
+  G->N = N;
+  G->D = tupsize(N);
+
+  /* precompute the sizes, strides and reciprocals of the leading
+   * dimensions.
+   */
+  for (i = 0; i < G->D && i < TUP_FAST_MAX; i++) {
+    G->n[i] = tupget(N, i);
+    G->st[i] = tupstride(N, i);
+    G->M[i] = (G->n[i] > 1 ? UINT64_MAX / G->n[i] + 1 : 0);
+  }
+
+  /* choose the kernels for the number of dimensions. */
+  switch (G->D) {
+#define TUP_CASE(D) \
+    case D: \
+      G->pack = tuppack##D; \
+      G->unpack = tupunpack##D; \
+      G->unpackv = tupunpackv##D; \
+      break;
+
+    TUP_CASE(1)
+    TUP_CASE(2)
+    TUP_CASE(3)
+    TUP_CASE(4)
+#undef TUP_CASE
+
+    default:
+      G->pack = tuppackn;
+      G->unpack = tupunpackn;
+      G->unpackv = tupunpackvn;
+  }
+
+  /* return success. */
+  return 1;
+}
+
+/* tupwrite(): write a list of packed linear indices to a file, one grid
+ * point per line, in the format of tupprint(). indices are unpacked in
+ * batches of TUP_BATCH.
+ *
+ * arguments:
+ *  @fh: output file handle.
+ *  @N: pointer to the tuple of sizes.
+ *  @lst: pointer to the tuple of packed indices.
+ *
+ * returns:
+ *  integer indicating success (1) or failure (0).
+ */
+int tupwrite (FILE *fh, tuple_t *N, tuple_t *lst) {
+  /* declare required variables:
+   *  @G: index kernels of the grid.
+   *  @x: unpacked grid indices of the batch.
+   *  @i, @j, @n: batch offset, element index and batch size.
+   */
+  unsigned int i, j, n, *x;
+  tupgrid_t G;
+
+  /* ensure the pointers are valid. */
+  if (!fh || !lst || !tupgridinit(&G, N))
+    return 0;
+
+  /* allocate the unpacked indices of a batch. */
+  x = (unsigned int*) malloc(TUP_BATCH * G.D * sizeof(unsigned int));
+  if (!x)
+    return 0;
+
+  /* unpack and print each batch. */
+  for (i = 0; i < tupsize(lst); i += n) {
+    n = (tupsize(lst) - i < TUP_BATCH ? tupsize(lst) - i : TUP_BATCH);
+    G.unpackv(&G, lst->elem + i, n, x);
+
+    for (j = 0; j < n * G.D; j++)
+      fprintf(fh, "%u%c", x[j], (j + 1) % G.D ? ' ' : '\n');
+  }
+
+  /* free the unpacked indices. */
+  free(x);
+  return 1;
+}
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 /* tuple_t: type definition of an n-tuple of unsigned integers.
  */
@@ -40,6 +41,44 @@ typedef struct {
 }
 tuple_t;
 
+/* define the largest number of dimensions that receive specialized index
+ * kernels, and the number of indices unpacked per batch.
+ */
+#define TUP_FAST_MAX  4
+#define TUP_BATCH     1024
+
+/* tupgrid_t: type definition of the index kernels of a grid, which are
+ * chosen once for its number of dimensions. grids with up to TUP_FAST_MAX
+ * dimensions use unrolled kernels with precomputed strides, and divide by
+ * multiplying with precomputed reciprocals.
+ */
+typedef struct tupgrid tupgrid_t;
+struct tupgrid {
+  /* @N: pointer to the tuple of grid sizes.
+   * @D: number of grid dimensions.
+   */
+  tuple_t *N;
+  unsigned int D;
+
+  /* @n: grid sizes of the leading dimensions.
+   * @st: strides of the leading dimensions.
+   * @M: reciprocals of the grid sizes, scaled by 2^64, or zero for
+   *     dimensions of size one.
+   */
+  unsigned int n[TUP_FAST_MAX], st[TUP_FAST_MAX];
+  uint64_t M[TUP_FAST_MAX];
+
+  /* @pack: packs an array of grid indices into a linear index.
+   * @unpack: unpacks a linear index into an array of grid indices.
+   * @unpackv: unpacks an array of linear indices into consecutive arrays
+   *           of grid indices.
+   */
+  unsigned int (*pack) (tupgrid_t *G, const unsigned int *x);
+  void (*unpack) (tupgrid_t *G, unsigned int idx, unsigned int *x);
+  void (*unpackv) (tupgrid_t *G, const unsigned int *idx, unsigned int n,
+                   unsigned int *x);
+};
+
 /* function declarations: */
 
 int tupalloc (tuple_t *t, unsigned int n);
@@ -76,5 +115,11 @@ unsigned int tupsearch (tuple_t *t, unsigned int idx);
 
 int tupappend (tuple_t *t, unsigned int newelem);
 
+int tupread (FILE *fh, tuple_t *n, tuple_t *lst);
+
+int tupgridinit (tupgrid_t *G, tuple_t *N);
+
+int tupwrite (FILE *fh, tuple_t *N, tuple_t *lst);
+
 #endif /* !__NUSUTILS_TUP_H__ */
 
@@ -0,0 +1,104 @@
+#!/bin/sh
+# nusutils: generalized deterministic nonuniform sampling utilities.
+# Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to:
+#
+#   Free Software Foundation, Inc.
+#   51 Franklin Street, Fifth Floor
+#   Boston, MA  02110-1301, USA.
+
+# batch.sh: check that the schedules of a batch do not depend on the
+# number of threads, and match the schedules of the corresponding single
+# runs. the utilities are run from the directory given as the first
+# argument (default: bin).
+
+# locate the utilities and create a scratch directory.
+BIN=$(cd "${1:-bin}" && pwd) || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 1
+
+# never read or store cached schedules.
+unset NUSUTILS_CACHE
+
+# fail: report a failed check and exit.
+fail () {
+  echo " FAIL $*"
+  exit 1
+}
+
+# write the jobs of each method. the gap jobs revisit densities, so that
+# any table entry written by one job would be read by a later one.
+cat > gap.jobs << EOF
+64,64 0.05 poissongap(x,d,O,N,L)
+64,64 0.08 poissongap(x,d,O,N,L)
+64,64 0.14 poissongap(x,d,O,N,L)
+64,64 0.2 poissongap(x,d,O,N,L)
+64,64 0.3 poissongap(x,d,O,N,L)
+64,64 0.08 poissongap(x,d,O,N,L)
+64,64 0.2 poissongap(x,d,O,N,L)
+32,16,8 0.1 sinegap(x,d,O,N,L)
+EOF
+
+cat > pdf.jobs << EOF
+64,64 0.1 exp(-sum(x./N))
+64,64 0.3 exp(-sum(x./N))
+30,20,10 0.05 exp(-sum(x./N))
+128 0.2 1.0
+EOF
+
+# fill a table of scaling factors for some of the gap jobs.
+for d in 0.08 0.2; do
+  "$BIN/gaputil" -K --table gap.tbl $d 64 64 'poissongap(x,d,O,N,L)' \
+    > /dev/null || fail "gaputil --table"
+done
+
+# run each utility on its jobs with several thread counts.
+for util in gaputil rejutil jitutil; do
+  jobs=pdf.jobs
+  [ $util = gaputil ] && jobs=gap.jobs
+
+  # build the batch with each thread count, from a copy of the table for
+  # gap jobs.
+  for j in 1 2 8; do
+    opts=""
+    [ $util = gaputil ] && cp gap.tbl gap.$j.tbl && opts="--table gap.$j.tbl"
+    "$BIN/$util" -K $opts -j $j -o $util.$j --batch $jobs > /dev/null ||
+      fail "$util --batch -j $j"
+  done
+
+  # compare every schedule across the thread counts.
+  k=1
+  while read -r grid d fn; do
+    for j in 2 8; do
+      cmp -s $util.1.$k $util.$j.$k ||
+        fail "$util job $k differs between -j 1 and -j $j"
+    done
+
+    # compare the schedule to a single run of the same job, which starts
+    # from the same table as the batch.
+    opts=""
+    [ $util = gaputil ] && cp gap.tbl gap.s.tbl && opts="--table gap.s.tbl"
+    "$BIN/$util" -K $opts -j 1 $d $(echo $grid | tr , ' ') "$fn" \
+      > $util.s.$k || fail "$util job $k single run"
+
+    cmp -s $util.1.$k $util.s.$k ||
+      fail "$util job $k differs from its single run"
+
+    k=$((k + 1))
+  done < $jobs
+
+  echo " PASS $util --batch"
+done
@@ -0,0 +1,86 @@
+#!/bin/sh
+# nusutils: generalized deterministic nonuniform sampling utilities.
+# Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to:
+#
+#   Free Software Foundation, Inc.
+#   51 Franklin Street, Fifth Floor
+#   Boston, MA  02110-1301, USA.
+
+
+# cache.sh: check that schedules read back from the cache match the
+# schedules built without it, and that corrupted cache entries are
+# rejected and rebuilt rather than read. the utilities are run from the
+# directory given as the first argument (default: bin).
+
+# locate the utilities and create a scratch directory.
+BIN=$(cd "${1:-bin}" && pwd) || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 1
+
+# only use the cache directories given on the command line.
+unset NUSUTILS_CACHE
+
+# fail: report a failed check and exit.
+fail () {
+  echo " FAIL $*"
+  exit 1
+}
+
+# corrupt: flip one bit of the last byte of each file given as an
+# argument, which lies in the data of a cache entry.
+corrupt () {
+  for f in "$@"; do
+    off=$(($(wc -c < "$f") - 1))
+    b=$(od -An -tu1 -j $off -N1 "$f" | tr -d ' ')
+    printf "\\$(printf %o $((b ^ 1)))" |
+      dd of="$f" bs=1 seek=$off conv=notrunc 2> /dev/null
+  done
+}
+
+# run each utility with and without a cache.
+for util in gaputil rejutil jitutil; do
+  fn='exp(-sum(x./N))'
+  [ $util = gaputil ] && fn='poissongap(x,d,O,N,L)'
+  set -- 0.2 64 64 "$fn"
+
+  # build the reference schedule without the cache.
+  "$BIN/$util" -K -j 2 "$@" > ref || fail "$util without cache"
+
+  # fill the cache, and read the schedule back from it.
+  mkdir $util.c
+  for run in fill hit; do
+    "$BIN/$util" -k $util.c -j 2 "$@" > $run ||
+      fail "$util cache $run"
+
+    cmp -s ref $run || fail "$util cache $run differs"
+  done
+
+  ls $util.c/*.nus > /dev/null 2>&1 || fail "$util stored no entries"
+  mkdir $util.o
+  cp $util.c/*.nus $util.o/
+
+  # corrupt every entry, which must then be rebuilt.
+  corrupt $util.c/*.nus
+  "$BIN/$util" -k $util.c -j 2 "$@" > bad || fail "$util corrupt cache"
+  cmp -s ref bad || fail "$util read a corrupted entry"
+
+  for f in $util.o/*.nus; do
+    cmp -s "$f" $util.c/${f##*/} || fail "$util entry not rebuilt"
+  done
+
+  echo " PASS $util --cache"
+done
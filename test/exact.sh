@@ -0,0 +1,66 @@
+#!/bin/sh
+# nusutils: generalized deterministic nonuniform sampling utilities.
+# Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to:
+#
+#   Free Software Foundation, Inc.
+#   51 Franklin Street, Fifth Floor
+#   Boston, MA  02110-1301, USA.
+
+
+# exact.sh: check that schedules built in exact-count mode hold exactly
+# the desired number of points, round(d * N1 * N2 * ...), for any number
+# of threads. the utilities are run from the directory given as the
+# first argument (default: bin).
+
+# locate the utilities and create a scratch directory.
+BIN=$(cd "${1:-bin}" && pwd) || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 1
+
+# never read or store cached schedules.
+unset NUSUTILS_CACHE
+
+# fail: report a failed check and exit.
+fail () {
+  echo " FAIL $*"
+  exit 1
+}
+
+# build each job with each gap equation and thread count.
+for fn in 'sinegap(x,d,O,N,L)' 'poissongap(x,d,O,N,L)'; do
+  while read -r grid d; do
+    # compute the desired point count.
+    n=$(echo $grid | awk -v d=$d -F, '{
+      p = d; for (i = 1; i <= NF; i++) p *= $i; printf "%d", p + 0.5 }')
+
+    for j in 1 7; do
+      "$BIN/gaputil" -K -x -j $j $d $(echo $grid | tr , ' ') "$fn" \
+        > sched || fail "$fn $grid $d -j $j"
+
+      [ $(wc -l < sched) -eq $n ] ||
+        fail "$fn $grid $d -j $j holds $(wc -l < sched) of $n points"
+    done
+  done << EOF2
+64,64 0.05
+64,64 0.2
+100,37 0.13
+30,20,10 0.1
+128 0.3
+EOF2
+
+  echo " PASS gaputil -x ${fn%%(*}"
+done
@@ -0,0 +1,70 @@
+#!/bin/sh
+# nusutils: generalized deterministic nonuniform sampling utilities.
+# Copyright (C) 2015 Bradley Worley <geekysuavo@gmail.com>.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to:
+#
+#   Free Software Foundation, Inc.
+#   51 Franklin Street, Fifth Floor
+#   Boston, MA  02110-1301, USA.
+
+
+# shard.sh: check that schedules built in shards and merged hold as many
+# points as the schedule of the whole grid, unless a shard failed, and
+# that the merge reports the number of merged points. the utilities are
+# run from the directory given as the first argument (default: bin).
+
+# locate the utilities and create a scratch directory.
+BIN=$(cd "${1:-bin}" && pwd) || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 1
+
+# never read or store cached schedules.
+unset NUSUTILS_CACHE
+
+# fail: report a failed check and exit.
+fail () {
+  echo " FAIL $*"
+  exit 1
+}
+
+# shard and merge each job with each utility. the densest job exhausts
+# the most probable shard of a jittered grid.
+for util in rejutil jitutil; do
+  for d in 0.1 0.3; do
+    set -- $d 64 64 'exp(-sum(x./N))'
+    "$BIN/$util" -K -j 2 "$@" > whole || fail "$util $d whole grid"
+
+    # build each shard, noting whether any of them failed.
+    ok=1
+    for k in 1 2 3 4; do
+      "$BIN/$util" -K -j 2 -s $k/4 "$@" > part.$k 2> /dev/null || ok=0
+    done
+
+    # merge the shards, and check the reported point count.
+    "$BIN/mrgutil" part.1 part.2 part.3 part.4 > merged 2> report ||
+      fail "$util $d merge"
+
+    n=$(wc -l < merged)
+    grep -q "^merged $n points from 4 schedules$" report ||
+      fail "$util $d merge misreports $n points"
+
+    # a merge of successful shards must match the whole grid.
+    [ $ok = 0 ] || [ $n -eq $(wc -l < whole) ] ||
+      fail "$util $d merges $n of $(wc -l < whole) points"
+  done
+
+  echo " PASS $util --shard"
+done